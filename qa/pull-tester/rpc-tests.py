@@ -170,6 +170,7 @@ testScripts = [
     # 'rpcnamedargs.py',
     'listsinceblock.py',
     'p2p-leaktests.py',
+    'socketevents.py',
     'notifications.py',
 
     # Index-specific tests
@@ -24,6 +24,16 @@ def deser_uint256(f):
         r += t << (i * 32)
     return r
 
+def deser_compact_size(f):
+    nit = unpack("<B", f.read(1))[0]
+    if nit == 253:
+        nit = unpack("<H", f.read(2))[0]
+    elif nit == 254:
+        nit = unpack("<I", f.read(4))[0]
+    elif nit == 255:
+        nit = unpack("<Q", f.read(8))[0]
+    return nit
+
 #allows simple http get calls
 def http_get_call(host, port, path, response_object = 0):
     conn = http.client.HTTPConnection(host, port)
@@ -50,13 +60,15 @@ class RESTTest (BitcoinTestFramework):
     def __init__(self):
         super().__init__()
         self.setup_clean_chain = True
-        self.num_nodes = 3
+        self.num_nodes = 4
 
     def setup_network(self, split=False):
-        self.nodes = start_nodes(self.num_nodes, self.options.tmpdir)
+        #node 3 serves the address index routes
+        self.nodes = start_nodes(self.num_nodes, self.options.tmpdir, [[], [], [], ["-addressindex"]])
         connect_nodes_bi(self.nodes,0,1)
         connect_nodes_bi(self.nodes,1,2)
         connect_nodes_bi(self.nodes,0,2)
+        connect_nodes_bi(self.nodes,0,3)
         self.is_network_split=False
         self.sync_all()
 
@@ -331,5 +343,152 @@ class RESTTest (BitcoinTestFramework):
         json_obj = json.loads(json_string)
         assert_equal(json_obj['bestblockhash'], bb_hash)
 
+        #no sigma spends yet, the used serials are empty but report the tip they were read at
+        json_string = http_get_call(url.hostname, url.port, '/rest/sigma/usedserials/0'+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        assert_equal(json_obj['chaintipHash'], bb_hash)
+        assert_equal(json_obj['chainHeight'], self.nodes[0].getblockcount())
+        assert_equal(len(json_obj['serials']), 0)
+        assert_equal(json_obj['nextHeight'], None)
+
+        response = http_get_call(url.hostname, url.port, '/rest/sigma/usedserials/0'+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response.status, 200)
+        output = BytesIO(response.read())
+        assert_equal(unpack("<i", output.read(4))[0], self.nodes[0].getblockcount())
+        assert_equal(deser_uint256(output), int(bb_hash, 16))
+        assert_equal(unpack("B", output.read(1))[0], 0)
+        assert_equal(unpack("<i", output.read(4))[0], -1)
+
+        #a bounded walk still reports the tip it was read at
+        json_string = http_get_call(url.hostname, url.port, '/rest/sigma/usedserials/0'+self.FORMAT_SEPARATOR+'json?end=10&limit=5')
+        json_obj = json.loads(json_string)
+        assert_equal(json_obj['chaintipHash'], bb_hash)
+        assert_equal(len(json_obj['serials']), 0)
+
+        response = http_get_call(url.hostname, url.port, '/rest/sigma/usedserials/10'+self.FORMAT_SEPARATOR+'json?end=5', True)
+        assert_equal(response.status, 400)
+
+        response = http_get_call(url.hostname, url.port, '/rest/sigma/usedserials/abc'+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 400)
+
+        #the address index isn't enabled on these nodes
+        response = http_get_call(url.hostname, url.port, '/rest/address/deltas/'+self.nodes[0].getnewaddress()+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 404)
+
+        #############################
+        # /rest/sigma/anonymityset/ #
+        #############################
+
+        #nothing is minted, the set is empty
+        json_string = http_get_call(url.hostname, url.port, '/rest/sigma/anonymityset/100000000/1'+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        assert_equal(json_obj['blockHash'], '0'*64)
+        assert_equal(len(json_obj['serializedCoins']), 0)
+
+        response = http_get_call(url.hostname, url.port, '/rest/sigma/anonymityset/100000000/1'+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response.status, 200)
+        output = BytesIO(response.read())
+        assert_equal(deser_uint256(output), 0)
+        assert_equal(deser_compact_size(output), 0)
+        assert_equal(output.read(), b'')
+
+        response = http_get_call(url.hostname, url.port, '/rest/sigma/anonymityset/12345/1'+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 400) #not a denomination
+        response = http_get_call(url.hostname, url.port, '/rest/sigma/anonymityset/100000000/0'+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 400) #groups start at 1
+        response = http_get_call(url.hostname, url.port, '/rest/sigma/anonymityset/100000000'+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 400)
+
+        ##################
+        # /rest/address/ #
+        ##################
+
+        url = urllib.parse.urlparse(self.nodes[3].url)
+        address = self.nodes[3].getnewaddress()
+        other_address = self.nodes[3].getnewaddress()
+        amounts = [Decimal("0.1"), Decimal("0.2"), Decimal("0.3")]
+        for amount in amounts:
+            self.nodes[2].sendtoaddress(address, amount)
+        self.nodes[2].sendtoaddress(other_address, Decimal("0.4"))
+        self.sync_all()
+        self.nodes[2].generate(1)
+        self.sync_all()
+
+        #the whole history in one page
+        json_string = http_get_call(url.hostname, url.port, '/rest/address/deltas/'+address+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        assert_equal(json_obj['address'], address)
+        assert_equal(json_obj['cursor'], None)
+        all_deltas = json_obj['deltas']
+        assert_equal(sorted(delta['satoshis'] for delta in all_deltas), [int(amount * 100000000) for amount in amounts])
+
+        #two pages, the cursor of the first one resumes right after its last entry
+        json_string = http_get_call(url.hostname, url.port, '/rest/address/deltas/'+address+self.FORMAT_SEPARATOR+'json?limit=2')
+        json_obj = json.loads(json_string)
+        assert_equal(json_obj['deltas'], all_deltas[:2])
+        cursor = json_obj['cursor']
+        assert(cursor is not None)
+        json_string = http_get_call(url.hostname, url.port, '/rest/address/deltas/'+address+self.FORMAT_SEPARATOR+'json?limit=2&cursor='+cursor)
+        json_obj = json.loads(json_string)
+        assert_equal(json_obj['deltas'], all_deltas[2:])
+        assert_equal(json_obj['cursor'], None)
+
+        #a cursor only pages the address it was handed out for
+        response = http_get_call(url.hostname, url.port, '/rest/address/deltas/'+other_address+self.FORMAT_SEPARATOR+'json?cursor='+cursor, True)
+        assert_equal(response.status, 400)
+        response = http_get_call(url.hostname, url.port, '/rest/address/deltas/'+address+self.FORMAT_SEPARATOR+'json?cursor=zz', True)
+        assert_equal(response.status, 400)
+
+        #binary: the deltas, then the cursor as a byte vector
+        response = http_get_call(url.hostname, url.port, '/rest/address/deltas/'+address+self.FORMAT_SEPARATOR+'bin?limit=2', True)
+        assert_equal(response.status, 200)
+        output = BytesIO(response.read())
+        assert_equal(deser_compact_size(output), 2)
+        for delta in all_deltas[:2]:
+            assert_equal(deser_uint256(output), int(delta['txid'], 16))
+            assert_equal(unpack("<I", output.read(4))[0], delta['index'])
+            assert_equal(unpack("<I", output.read(4))[0], delta['blockindex'])
+            assert_equal(unpack("<i", output.read(4))[0], delta['height'])
+            assert_equal(unpack("<q", output.read(8))[0], delta['satoshis'])
+        cursor_len = deser_compact_size(output)
+        assert_equal(bytes_to_hex_str(output.read(cursor_len)), cursor)
+        assert_equal(output.read(), b'')
+
+        #utxos page the same way
+        json_string = http_get_call(url.hostname, url.port, '/rest/address/utxos/'+address+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        assert_equal(json_obj['cursor'], None)
+        all_utxos = json_obj['utxos']
+        assert_equal(len(all_utxos), len(amounts))
+
+        json_string = http_get_call(url.hostname, url.port, '/rest/address/utxos/'+address+self.FORMAT_SEPARATOR+'json?limit=2')
+        json_obj = json.loads(json_string)
+        assert_equal(json_obj['utxos'], all_utxos[:2])
+        cursor = json_obj['cursor']
+        assert(cursor is not None)
+        json_string = http_get_call(url.hostname, url.port, '/rest/address/utxos/'+address+self.FORMAT_SEPARATOR+'json?limit=2&cursor='+cursor)
+        json_obj = json.loads(json_string)
+        assert_equal(json_obj['utxos'], all_utxos[2:])
+        assert_equal(json_obj['cursor'], None)
+
+        response = http_get_call(url.hostname, url.port, '/rest/address/utxos/'+other_address+self.FORMAT_SEPARATOR+'json?cursor='+cursor, True)
+        assert_equal(response.status, 400)
+
+        #binary: the utxos, then the cursor as a byte vector
+        response = http_get_call(url.hostname, url.port, '/rest/address/utxos/'+address+self.FORMAT_SEPARATOR+'bin?limit=2', True)
+        assert_equal(response.status, 200)
+        output = BytesIO(response.read())
+        assert_equal(deser_compact_size(output), 2)
+        for utxo in all_utxos[:2]:
+            assert_equal(deser_uint256(output), int(utxo['txid'], 16))
+            assert_equal(unpack("<I", output.read(4))[0], utxo['outputIndex'])
+            assert_equal(unpack("<i", output.read(4))[0], utxo['height'])
+            assert_equal(unpack("<q", output.read(8))[0], utxo['satoshis'])
+            script_len = deser_compact_size(output)
+            assert_equal(bytes_to_hex_str(output.read(script_len)), utxo['script'])
+        cursor_len = deser_compact_size(output)
+        assert_equal(bytes_to_hex_str(output.read(cursor_len)), cursor)
+        assert_equal(output.read(), b'')
+
 if __name__ == '__main__':
     RESTTest ().main ()
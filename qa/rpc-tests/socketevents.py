@@ -0,0 +1,52 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Zcoin Core Developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#
+# Test block relay between nodes using the epoll and select socket events modes.
+# Nodes 0 and 2 run the build's default (epoll where it is available), node 1 uses select.
+#
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import *
+from test_framework.mininode import wait_until
+
+class SocketEventsTest(BitcoinTestFramework):
+    def __init__(self):
+        super().__init__()
+        self.num_nodes = 3
+        self.setup_clean_chain = True
+
+    def setup_network(self):
+        self.nodes = start_nodes(self.num_nodes, self.options.tmpdir,
+                                 [[], ["-socketevents=select"], []])
+        connect_nodes_bi(self.nodes, 0, 1)
+        connect_nodes_bi(self.nodes, 1, 2)
+        self.is_network_split = False
+
+    def run_test(self):
+        mode = self.nodes[0].getnetworkinfo()["socketevents"]
+        assert(mode in ("epoll", "select"))
+        assert_equal(self.nodes[1].getnetworkinfo()["socketevents"], "select")
+        assert_equal(self.nodes[2].getnetworkinfo()["socketevents"], mode)
+
+        # Blocks have to cross the select node in both directions
+        self.nodes[0].generate(10)
+        sync_blocks(self.nodes)
+        self.nodes[2].generate(10)
+        sync_blocks(self.nodes)
+        assert_equal(self.nodes[0].getblockcount(), 20)
+
+        # Dropping and reconnecting peers must leave the event sets usable. Node 1 is connected to both others.
+        for peer in self.nodes[1].getpeerinfo():
+            self.nodes[1].disconnectnode(peer["addr"])
+        wait_until(lambda: all(node.getconnectioncount() == 0 for node in self.nodes))
+        connect_nodes_bi(self.nodes, 0, 1)
+        connect_nodes_bi(self.nodes, 1, 2)
+        self.nodes[1].generate(5)
+        sync_blocks(self.nodes)
+        assert_equal(self.nodes[2].getblockcount(), 25)
+
+if __name__ == '__main__':
+    SocketEventsTest().main()
@@ -0,0 +1,77 @@
+// Copyright (c) 2019 The Zcoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "random.h"
+#include "util.h"
+
+#include <cassert>
+
+#include <boost/filesystem.hpp>
+
+// Log into debug.log in a scratch datadir, which is unlinked right away so the
+// benchmarks don't leave anything behind.
+static void OpenScratchDebugLog()
+{
+    static bool fOpened = false;
+    if (fOpened)
+        return;
+    fOpened = true;
+
+    boost::filesystem::path pathTemp = boost::filesystem::temp_directory_path() / strprintf("bench_logging_%lu", (unsigned long)GetRand(1ULL << 32));
+    boost::filesystem::create_directories(pathTemp);
+    ForceSetArg("-datadir", pathTemp.string());
+    ClearDatadirCache();
+    OpenDebugLog();
+    boost::filesystem::remove_all(pathTemp);
+}
+
+// Returns the number of characters LogPrintStr reported as written or queued
+static uint64_t LogMessages(benchmark::State& state)
+{
+    uint64_t n = 0;
+    uint64_t nWritten = 0;
+    while (state.KeepRunning()) {
+        nWritten += LogPrintStr(tfm::format("%s: block %d, %d transactions, hash=%s\n", __func__, n, n % 3000, "0000000000000000000000000000000000000000000000000000000000000000"));
+        ++n;
+    }
+    return nWritten;
+}
+
+static void LoggingDirect(benchmark::State& state)
+{
+    // Set on every run, the other benchmarks turn it off again when they're done
+    fPrintToDebugLog = true;
+    OpenScratchDebugLog();
+    uint64_t nWritten = LogMessages(state);
+    fPrintToDebugLog = false;
+    assert(nWritten > 0);
+}
+
+static void LoggingQueued(benchmark::State& state)
+{
+    fPrintToDebugLog = true;
+    OpenScratchDebugLog();
+    StartLogWriter();
+    uint64_t nWritten = LogMessages(state);
+    StopLogWriter();
+    fPrintToDebugLog = false;
+    assert(nWritten > 0);
+}
+
+static void LoggingRateLimited(benchmark::State& state)
+{
+    // What LogPrint costs for an enabled category once everything past the first
+    // message each second is dropped
+    nLogRateLimit = 1;
+    while (state.KeepRunning()) {
+        if (LogAcceptRate("bench"))
+            LogPrintStr(tfm::format("%s: suppressed\n", __func__));
+    }
+    nLogRateLimit = DEFAULT_DEBUG_RATE_LIMIT;
+}
+
+BENCHMARK(LoggingDirect);
+BENCHMARK(LoggingQueued);
+BENCHMARK(LoggingRateLimited);
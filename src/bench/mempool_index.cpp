@@ -0,0 +1,79 @@
+// Copyright (c) 2019 The Zcoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "coins.h"
+#include "policy/policy.h"
+#include "random.h"
+#include "txmempool.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Transaction acceptance into a pool with -addressindex/-spentindex while other threads keep
+// polling the indexes, the way getaddressmempool/getspentinfo clients do.
+static void MempoolIndexAcceptWithReaders(benchmark::State& state)
+{
+    const size_t addressesNum = 64;
+    const size_t readersNum = 2;
+
+    std::vector<uint160> addresses(addressesNum);
+    for (uint160 &address : addresses)
+        GetRandBytes(address.begin(), address.size());
+
+    std::vector<CTransactionRef> txs;
+    for (size_t i = 0; i < 1000; ++i) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+        tx.vin[0].scriptSig = CScript() << OP_1;
+        tx.vout.resize(2);
+        for (size_t j = 0; j < tx.vout.size(); ++j) {
+            const uint160 &address = addresses[(i + j) % addressesNum];
+            tx.vout[j].scriptPubKey = CScript() << OP_DUP << OP_HASH160 << ToByteVector(address) << OP_EQUALVERIFY << OP_CHECKSIG;
+            tx.vout[j].nValue = COIN;
+        }
+        txs.push_back(MakeTransactionRef(tx));
+    }
+
+    CCoinsView coinsDummy;
+    CCoinsViewCache view(&coinsDummy);
+    CTxMemPool pool(CFeeRate(1000));
+    LockPoints lp;
+
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> readers;
+    for (size_t r = 0; r < readersNum; ++r) {
+        readers.emplace_back([&pool, &addresses, &stop, &txs, r]() {
+            size_t n = r;
+            while (!stop) {
+                std::vector<std::pair<uint160, AddressType> > query(1, std::make_pair(addresses[n % addresses.size()], AddressType::payToPubKeyHash));
+                std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > results;
+                pool.getAddressIndex(query, results);
+                CSpentIndexKey key(txs[n % txs.size()]->vin[0].prevout.hash, 0);
+                CSpentIndexValue value;
+                pool.getSpentIndex(key, value);
+                ++n;
+            }
+        });
+    }
+
+    while (state.KeepRunning()) {
+        for (const CTransactionRef &tx : txs) {
+            CTxMemPoolEntry entry(tx, 1000, 0, 1, tx->GetValueOut(), false, 4, lp);
+            pool.addUnchecked(tx->GetHash(), entry);
+            pool.addAddressIndex(entry, view);
+            pool.addSpentIndex(entry, view);
+        }
+        for (const CTransactionRef &tx : txs)
+            pool.removeRecursive(*tx);
+    }
+
+    stop = true;
+    for (std::thread &reader : readers)
+        reader.join();
+}
+
+BENCHMARK(MempoolIndexAcceptWithReaders);
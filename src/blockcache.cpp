@@ -0,0 +1,99 @@
+// Copyright (c) 2019 The Zcoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockcache.h"
+
+#include "core_memusage.h"
+#include "memusage.h"
+
+CBlockCache blockCache(DEFAULT_BLOCK_CACHE_SIZE << 20);
+
+CBlockCache::CBlockCache(size_t nMaxUsageIn) :
+    nUsage(0), nMaxUsage(nMaxUsageIn), nHits(0), nMisses(0), nEvictions(0)
+{
+}
+
+void CBlockCache::EvictToSize(size_t nTargetUsage)
+{
+    while (nUsage > nTargetUsage && !entries.empty()) {
+        const Entry& entry = entries.back();
+        nUsage -= entry.nUsage;
+        mapEntries.erase(entry.hash);
+        entries.pop_back();
+        ++nEvictions;
+    }
+}
+
+void CBlockCache::SetMaxUsage(size_t nMaxUsageIn)
+{
+    LOCK(cs);
+    nMaxUsage = nMaxUsageIn;
+    EvictToSize(nMaxUsage);
+}
+
+std::shared_ptr<const CBlock> CBlockCache::Get(const uint256& hash)
+{
+    LOCK(cs);
+    auto it = mapEntries.find(hash);
+    if (it == mapEntries.end()) {
+        ++nMisses;
+        return nullptr;
+    }
+    ++nHits;
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->block;
+}
+
+void CBlockCache::Insert(const uint256& hash, const std::shared_ptr<const CBlock>& block)
+{
+    // The usage is an estimate of what the deserialized block keeps alive; measure it before locking
+    size_t nBlockUsage = sizeof(CBlock) + RecursiveDynamicUsage(*block) + sizeof(Entry) + 4 * sizeof(void*);
+
+    LOCK(cs);
+    if (nBlockUsage > nMaxUsage)
+        return;
+
+    auto it = mapEntries.find(hash);
+    if (it != mapEntries.end()) {
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+
+    EvictToSize(nMaxUsage - nBlockUsage);
+    entries.push_front(Entry{hash, block, nBlockUsage});
+    mapEntries.emplace(hash, entries.begin());
+    nUsage += nBlockUsage;
+}
+
+void CBlockCache::Erase(const uint256& hash)
+{
+    LOCK(cs);
+    auto it = mapEntries.find(hash);
+    if (it == mapEntries.end())
+        return;
+    nUsage -= it->second->nUsage;
+    entries.erase(it->second);
+    mapEntries.erase(it);
+}
+
+void CBlockCache::Clear()
+{
+    LOCK(cs);
+    entries.clear();
+    mapEntries.clear();
+    nUsage = 0;
+}
+
+CBlockCache::Stats CBlockCache::GetStats() const
+{
+    LOCK(cs);
+    Stats stats;
+    stats.nBlocks = mapEntries.size();
+    stats.nUsage = nUsage;
+    stats.nMaxUsage = nMaxUsage;
+    stats.nHits = nHits;
+    stats.nMisses = nMisses;
+    stats.nEvictions = nEvictions;
+    return stats;
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2019 The Zcoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef ZCOIN_BLOCKCACHE_H
+#define ZCOIN_BLOCKCACHE_H
+
+#include "primitives/block.h"
+#include "saltedhasher.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+/** Default for -blockcachesize, in MiB. 0 disables the cache */
+static const int64_t DEFAULT_BLOCK_CACHE_SIZE = 32;
+
+/**
+ * Memory bounded LRU cache of deserialized blocks keyed by block hash. Blocks are handed out as
+ * shared_ptr<const CBlock> so getdata, RPC and index code serving the same block share one copy
+ * instead of each reading and deserializing it from disk.
+ */
+class CBlockCache
+{
+public:
+    struct Stats {
+        size_t nBlocks;
+        size_t nUsage;
+        size_t nMaxUsage;
+        uint64_t nHits;
+        uint64_t nMisses;
+        uint64_t nEvictions;
+    };
+
+private:
+    struct Entry {
+        uint256 hash;
+        std::shared_ptr<const CBlock> block;
+        size_t nUsage;
+    };
+    typedef std::list<Entry> EntryList;
+
+    mutable CCriticalSection cs;
+    //! Most recently used entries first
+    EntryList entries;
+    std::unordered_map<uint256, EntryList::iterator, StaticSaltedHasher> mapEntries;
+    size_t nUsage;
+    size_t nMaxUsage;
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nEvictions;
+
+    void EvictToSize(size_t nTargetUsage);
+
+public:
+    CBlockCache(size_t nMaxUsageIn = 0);
+
+    /** Change the memory limit, evicting the least recently used blocks if needed */
+    void SetMaxUsage(size_t nMaxUsageIn);
+
+    /** Return the block with the given hash or nullptr if it is not cached */
+    std::shared_ptr<const CBlock> Get(const uint256& hash);
+    /** Add a block, hash must be its block hash. Blocks larger than the whole cache are ignored */
+    void Insert(const uint256& hash, const std::shared_ptr<const CBlock>& block);
+    void Erase(const uint256& hash);
+    void Clear();
+
+    Stats GetStats() const;
+};
+
+extern CBlockCache blockCache;
+
+#endif // ZCOIN_BLOCKCACHE_H
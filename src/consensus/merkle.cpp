@@ -185,3 +185,78 @@ std::vector<uint256> BlockMerkleBranch(const CBlock& block, uint32_t position)
     }
     return ComputeMerkleBranch(leaves, position);
 }
+
+static uint256 HashMerklePair(const std::vector<uint256>& level, size_t pair)
+{
+    const uint256& left = level[pair * 2];
+    const uint256& right = pair * 2 + 1 < level.size() ? level[pair * 2 + 1] : left;
+    uint256 h;
+    CHash256().Write(left.begin(), 32).Write(right.begin(), 32).Finalize(h.begin());
+    return h;
+}
+
+bool CMerkleTreeCache::IsMutatedPair(size_t level, size_t pair) const
+{
+    // MerkleComputation only checks pairs whose right subtree is made of real leaves, the
+    // self-paired nodes on the rightmost branch of the tree are not considered
+    size_t right = pair * 2 + 1;
+    if (((uint64_t)(right + 1) << level) > levels[0].size()) {
+        return false;
+    }
+    return levels[level][right - 1] == levels[level][right];
+}
+
+void CMerkleTreeCache::Build(std::vector<uint256> leaves)
+{
+    Clear();
+    if (leaves.empty()) {
+        return;
+    }
+    levels.emplace_back(std::move(leaves));
+    while (levels.back().size() > 1) {
+        size_t level = levels.size() - 1;
+        std::vector<uint256> next((levels[level].size() + 1) / 2);
+        for (size_t i = 0; i < next.size(); i++) {
+            if (IsMutatedPair(level, i)) {
+                nMutatedPairs++;
+            }
+            next[i] = HashMerklePair(levels[level], i);
+        }
+        levels.emplace_back(std::move(next));
+    }
+}
+
+void CMerkleTreeCache::UpdateLeaf(size_t pos, const uint256& leaf)
+{
+    assert(pos < GetLeafCount());
+
+    uint256 h = leaf;
+    for (size_t level = 0; level + 1 < levels.size(); level++) {
+        size_t pair = pos / 2;
+        if (IsMutatedPair(level, pair)) {
+            nMutatedPairs--;
+        }
+        levels[level][pos] = h;
+        if (IsMutatedPair(level, pair)) {
+            nMutatedPairs++;
+        }
+        h = HashMerklePair(levels[level], pair);
+        pos = pair;
+    }
+    levels.back()[0] = h;
+}
+
+void CMerkleTreeCache::Clear()
+{
+    levels.clear();
+    nMutatedPairs = 0;
+}
+
+uint256 CMerkleTreeCache::GetRoot(bool* mutated) const
+{
+    if (mutated) *mutated = nMutatedPairs != 0;
+    if (levels.empty()) {
+        return uint256();
+    }
+    return levels.back()[0];
+}
@@ -35,4 +35,30 @@ uint256 BlockWitnessMerkleRoot(const CBlock& block, bool* mutated = NULL);
  */
 std::vector<uint256> BlockMerkleBranch(const CBlock& block, uint32_t position);
 
+/**
+ * Keeps every level of a merkle tree built with the same rules as ComputeMerkleRoot (odd nodes
+ * are paired with themselves, duplicated subtrees are reported as mutated), so that replacing a
+ * leaf only re-hashes the path from that leaf to the root.
+ * Inserting or removing leaves shifts all following pairs and requires a Build() of the tree.
+ */
+class CMerkleTreeCache
+{
+private:
+    // levels[0] are the leaves, levels.back() holds the root
+    std::vector<std::vector<uint256>> levels;
+    // number of sibling pairs that ComputeMerkleRoot would consider a mutation
+    size_t nMutatedPairs{0};
+
+    bool IsMutatedPair(size_t level, size_t pair) const;
+
+public:
+    void Build(std::vector<uint256> leaves);
+    void UpdateLeaf(size_t pos, const uint256& leaf);
+    void Clear();
+
+    size_t GetLeafCount() const { return levels.empty() ? 0 : levels[0].size(); }
+    const uint256& GetLeaf(size_t pos) const { return levels[0][pos]; }
+    uint256 GetRoot(bool* mutated = NULL) const;
+};
+
 #endif
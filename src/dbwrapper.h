@@ -194,6 +194,14 @@ public:
         return true;
     }
 
+    /** Returns the (deobfuscated) serialized value so it can be deserialized later, possibly on another thread */
+    CDataStream GetValue() {
+        leveldb::Slice slValue = piter->value();
+        CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+        ssValue.Xor(dbwrapper_private::GetObfuscateKey(parent));
+        return ssValue;
+    }
+
     unsigned int GetValueSize() {
         return piter->value().size();
     }
@@ -1178,12 +1178,12 @@ static int elysium_initial_scan(int nFirstBlock)
             nNow = GetTime();
         }
 
-        // Get block to parse.
-        CBlock block;
-
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus())) {
+        // Get block to parse. Recent blocks may be cached, but don't let the scan evict them
+        std::shared_ptr<const CBlock> pblock = ReadBlockFromDiskCached(pblockindex, Params().GetConsensus(), false);
+        if (!pblock) {
             break;
         }
+        const CBlock& block = *pblock;
 
         // Parse block.
         unsigned parsed = 0;
@@ -116,30 +116,71 @@ bool CalcCbTxMerkleRootMNList(const CBlock& block, const CBlockIndex* pindexPrev
     int64_t nTime2 = GetTimeMicros(); nTimeDMN += nTime2 - nTime1;
     LogPrint("bench", "            - BuildNewListFromBlock: %.2fms [%.2fs]\n", 0.001 * (nTime2 - nTime1), nTimeDMN * 0.000001);
 
-    CSimplifiedMNList sml(tmpMNList);
+    // The SML merkle tree of the last list we calculated a root for is kept around. Only entries whose
+    // deterministic MN changed need to be re-hashed, and if no MN was added or removed only their paths
+    // up to the root are re-hashed as well. Leaves are ordered by proRegTxHash, same as in CSimplifiedMNList.
+    static CDeterministicMNList mnListCached;
+    static std::vector<uint256> proTxHashesCached;
+    static CMerkleTreeCache merkleTreeCached;
+    static bool fMerkleTreeCached{false};
+
+    std::map<uint256, uint256> updatedLeaves;
+    size_t nAdded = 0;
+    tmpMNList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
+        auto oldDmn = fMerkleTreeCached ? mnListCached.GetMN(dmn->proTxHash) : nullptr;
+        if (oldDmn == nullptr) {
+            nAdded++;
+        } else if (oldDmn == dmn && oldDmn->pdmnState == dmn->pdmnState) {
+            return;
+        }
+        updatedLeaves.emplace(dmn->proTxHash, CSimplifiedMNListEntry(*dmn).CalcHash());
+    });
+    bool fRemoved = fMerkleTreeCached && mnListCached.GetAllMNsCount() + nAdded != tmpMNList.GetAllMNsCount();
 
     int64_t nTime3 = GetTimeMicros(); nTimeSMNL += nTime3 - nTime2;
-    LogPrint("bench", "            - CSimplifiedMNList: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeSMNL * 0.000001);
+    LogPrint("bench", "            - CSimplifiedMNListEntry: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeSMNL * 0.000001);
+
+    auto findCachedLeaf = [&](const uint256& proTxHash) {
+        auto it = std::lower_bound(proTxHashesCached.begin(), proTxHashesCached.end(), proTxHash);
+        assert(it != proTxHashesCached.end() && *it == proTxHash);
+        return (size_t)(it - proTxHashesCached.begin());
+    };
 
-    static CSimplifiedMNList smlCached;
-    static uint256 merkleRootCached;
-    static bool mutatedCached{false};
+    if (fMerkleTreeCached && nAdded == 0 && !fRemoved) {
+        for (const auto& p : updatedLeaves) {
+            merkleTreeCached.UpdateLeaf(findCachedLeaf(p.first), p.second);
+        }
+    } else {
+        std::vector<uint256> proTxHashes;
+        proTxHashes.reserve(tmpMNList.GetAllMNsCount());
+        tmpMNList.ForEachMN(false, [&](const CDeterministicMNCPtr& dmn) {
+            proTxHashes.emplace_back(dmn->proTxHash);
+        });
+        std::sort(proTxHashes.begin(), proTxHashes.end());
+
+        std::vector<uint256> leaves;
+        leaves.reserve(proTxHashes.size());
+        for (const auto& proTxHash : proTxHashes) {
+            auto it = updatedLeaves.find(proTxHash);
+            if (it != updatedLeaves.end()) {
+                leaves.emplace_back(it->second);
+            } else {
+                leaves.emplace_back(merkleTreeCached.GetLeaf(findCachedLeaf(proTxHash)));
+            }
+        }
 
-    if (sml.mnList == smlCached.mnList) {
-        merkleRootRet = merkleRootCached;
-        return !mutatedCached;
+        merkleTreeCached.Build(std::move(leaves));
+        proTxHashesCached = std::move(proTxHashes);
     }
+    mnListCached = tmpMNList;
+    fMerkleTreeCached = true;
 
     bool mutated = false;
-    merkleRootRet = sml.CalcMerkleRoot(&mutated);
+    merkleRootRet = merkleTreeCached.GetRoot(&mutated);
 
     int64_t nTime4 = GetTimeMicros(); nTimeMerkle += nTime4 - nTime3;
     LogPrint("bench", "            - CalcMerkleRoot: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTime3), nTimeMerkle * 0.000001);
 
-    smlCached = std::move(sml);
-    merkleRootCached = merkleRootRet;
-    mutatedCached = mutated;
-
     return !mutated;
 }
 
@@ -152,34 +193,39 @@ bool CalcCbTxMerkleRootQuorums(const CBlock& block, const CBlockIndex* pindexPre
 
     int64_t nTime1 = GetTimeMicros();
 
-    static std::map<Consensus::LLMQType, std::vector<const CBlockIndex*>> quorumsCached;
-    static std::map<Consensus::LLMQType, std::vector<uint256>> qcHashesCached;
+    // commitment hashes of the active quorums, only commitments of newly mined quorums need to be loaded
+    static std::map<std::pair<Consensus::LLMQType, uint256>, uint256> qcHashesCached;
 
     auto quorums = llmq::quorumBlockProcessor->GetMinedAndActiveCommitmentsUntilBlock(pindexPrev);
     std::map<Consensus::LLMQType, std::vector<uint256>> qcHashes;
+    std::map<std::pair<Consensus::LLMQType, uint256>, uint256> qcHashesNew;
     size_t hashCount = 0;
 
     int64_t nTime2 = GetTimeMicros(); nTimeMinedAndActive += nTime2 - nTime1;
     LogPrint("bench", "            - GetMinedAndActiveCommitmentsUntilBlock: %.2fms [%.2fs]\n", 0.001 * (nTime2 - nTime1), nTimeMinedAndActive * 0.000001);
 
-    if (quorums == quorumsCached) {
-        qcHashes = qcHashesCached;
-    } else {
-        for (const auto& p : quorums) {
-            auto& v = qcHashes[p.first];
-            v.reserve(p.second.size());
-            for (const auto& p2 : p.second) {
+    for (const auto& p : quorums) {
+        auto& v = qcHashes[p.first];
+        v.reserve(p.second.size());
+        for (const auto& p2 : p.second) {
+            auto key = std::make_pair(p.first, p2->GetBlockHash());
+            auto it = qcHashesCached.find(key);
+            uint256 qcHash;
+            if (it != qcHashesCached.end()) {
+                qcHash = it->second;
+            } else {
                 llmq::CFinalCommitment qc;
                 uint256 minedBlockHash;
                 bool found = llmq::quorumBlockProcessor->GetMinedCommitment(p.first, p2->GetBlockHash(), qc, minedBlockHash);
                 assert(found);
-                v.emplace_back(::SerializeHash(qc));
-                hashCount++;
+                qcHash = ::SerializeHash(qc);
             }
+            qcHashesNew.emplace(key, qcHash);
+            v.emplace_back(qcHash);
+            hashCount++;
         }
-        quorumsCached = quorums;
-        qcHashesCached = qcHashes;
     }
+    qcHashesCached = std::move(qcHashesNew);
 
     int64_t nTime3 = GetTimeMicros(); nTimeMined += nTime3 - nTime2;
     LogPrint("bench", "            - GetMinedCommitment: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeMined * 0.000001);
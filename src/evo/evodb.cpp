@@ -14,16 +14,46 @@ CEvoDB::CEvoDB(size_t nCacheSize, bool fMemory, bool fWipe) :
 {
 }
 
-bool CEvoDB::CommitRootTransaction()
+bool CEvoDB::CommitRootTransaction(bool fWriteBestBlock)
 {
     LOCK(cs);
     assert(curDBTransaction.IsClean());
+    uint256 hashBestBlock;
+    bool fDeferBestBlock = !fWriteBestBlock && rootDBTransaction.Read(EVODB_BEST_BLOCK, hashBestBlock);
     rootDBTransaction.Commit();
+    if (fDeferBestBlock) {
+        // Later writes in the batch win, so this keeps the best block on disk. The transaction keeps the new one
+        // for our own reads.
+        uint256 hashDiskBestBlock;
+        if (db.Read(EVODB_BEST_BLOCK, hashDiskBestBlock))
+            rootBatch.Write(EVODB_BEST_BLOCK, hashDiskBestBlock);
+        else
+            rootBatch.Erase(EVODB_BEST_BLOCK);
+        rootBatch.Write(EVODB_PENDING_BEST_BLOCK, hashBestBlock);
+        rootDBTransaction.Write(EVODB_BEST_BLOCK, hashBestBlock);
+    } else {
+        rootBatch.Erase(EVODB_PENDING_BEST_BLOCK);
+    }
     bool ret = db.WriteBatch(rootBatch);
     rootBatch.Clear();
     return ret;
 }
 
+bool CEvoDB::CommitPendingBestBlock(const uint256& hashCoinsBestBlock)
+{
+    LOCK(cs);
+    uint256 hashPendingBlock;
+    if (!db.Read(EVODB_PENDING_BEST_BLOCK, hashPendingBlock))
+        return true;
+    // If the coins database didn't get there (we crashed while writing it) the data of the pending blocks stays
+    // behind unreferenced, reconnecting them writes it again
+    CDBBatch batch(db);
+    if (hashPendingBlock == hashCoinsBestBlock)
+        batch.Write(EVODB_BEST_BLOCK, hashPendingBlock);
+    batch.Erase(EVODB_PENDING_BEST_BLOCK);
+    return db.WriteBatch(batch);
+}
+
 bool CEvoDB::VerifyBestBlock(const uint256& hash)
 {
     // Make sure evodb is consistent.
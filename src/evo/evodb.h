@@ -12,6 +12,8 @@
 // "b_b" was used in the initial version of deterministic MN storage
 // "b_b2" was used after compact diffs were introduced
 static const std::string EVODB_BEST_BLOCK = "b_b2";
+// Best block that EVODB_BEST_BLOCK moves to once the coins database has been written up to it
+static const std::string EVODB_PENDING_BEST_BLOCK = "b_p";
 
 class CEvoDB
 {
@@ -80,7 +82,13 @@ public:
         return rootDBTransaction.GetMemoryUsage();
     }
 
-    bool CommitRootTransaction();
+    /**
+     * Writes the root transaction to disk. Without fWriteBestBlock the best block stored on disk stays where it is
+     * and the new one is only recorded as pending, see CommitPendingBestBlock.
+     */
+    bool CommitRootTransaction(bool fWriteBestBlock = true);
+    //! Moves the best block on disk to the pending one if the coins database is at it, and clears the pending one
+    bool CommitPendingBestBlock(const uint256& hashCoinsBestBlock);
 
     bool VerifyBestBlock(const uint256& hash);
     void WriteBestBlock(const uint256& hash);
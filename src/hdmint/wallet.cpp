@@ -16,6 +16,9 @@
 #include "keystore.h"
 #include <boost/optional.hpp>
 #include "indexnodesync-interface.h"
+#include "ctpl.h"
+
+#include <future>
 
 /**
  * Constructor for CHDMintWallet object.
@@ -131,12 +134,14 @@ std::pair<uint256,uint256> CHDMintWallet::RegenerateMintPoolEntry(CWalletDB& wal
  *
  * only runs if the current mintpool is exhausted and we need new mints (ie. the next mint to
  * generate is the same as the one last used)
- * Generates 20 mints at a time.
+ * Generates nWindow mints at a time.
+ * Keys and mint seeds are derived in order, the mints themselves (which are the expensive part) in parallel.
  * Makes the appropriate database entries.
  *
- * @param nIndex The number of mints to generate. Defaults to 20 if no param passed.
+ * @param nIndex The count to generate from. Defaults to the last generated count if no param passed.
+ * @param nWindow The number of mints to generate. Defaults to 20.
  */
-void CHDMintWallet::GenerateMintPool(CWalletDB& walletdb, int32_t nIndex)
+void CHDMintWallet::GenerateMintPool(CWalletDB& walletdb, int32_t nIndex, int32_t nWindow)
 {
     //Is locked
     if (pwalletMain->IsLocked())
@@ -148,31 +153,71 @@ void CHDMintWallet::GenerateMintPool(CWalletDB& walletdb, int32_t nIndex)
     }
 
     int32_t nLastCount = nCountNextGenerate;
-    int32_t nStop = nLastCount + 20;
+    int32_t nStop = nLastCount + nWindow;
     if(nIndex > 0 && nIndex >= nLastCount)
-        nStop = nIndex + 20;
+        nStop = nIndex + nWindow;
     LogPrintf("%s : nLastCount=%d nStop=%d\n", __func__, nLastCount, nStop - 1);
+
+    struct PendingMint {
+        int32_t nCount;
+        CKeyID seedId;
+        uint512 mintSeed;
+        bool fValid;
+        GroupElement commitmentValue;
+        uint256 hashSerial;
+    };
+
+    std::vector<PendingMint> pending;
     for (; nLastCount <= nStop; ++nLastCount) {
         if (ShutdownRequested())
             return;
 
-        CKeyID seedId;
-        uint512 mintSeed;
-        if(!CreateMintSeed(walletdb, mintSeed, nLastCount, seedId, false))
+        PendingMint mint;
+        mint.nCount = nLastCount;
+        mint.fValid = false;
+        if(!CreateMintSeed(walletdb, mint.mintSeed, nLastCount, mint.seedId, false))
             continue;
+        pending.push_back(mint);
+    }
 
-        GroupElement commitmentValue;
+    auto deriveMint = [this](PendingMint &mint) {
         sigma::PrivateCoin coin(sigma::Params::get_default(), sigma::CoinDenomination::SIGMA_DENOM_1);
-        if(!SeedToMint(mintSeed, commitmentValue, coin))
+        mint.fValid = SeedToMint(mint.mintSeed, mint.commitmentValue, coin);
+        if (mint.fValid)
+            mint.hashSerial = primitives::GetSerialHash(coin.getSerialNumber());
+    };
+
+    int nThreads = std::min<int>(GetNumCores(), pending.size() / 8);
+    if (nThreads > 1) {
+        ctpl::thread_pool pool(nThreads);
+        RenameThreadPool(pool, "mintpool");
+        std::vector<std::future<void>> futures;
+        size_t const nChunkSize = (pending.size() + nThreads - 1) / nThreads;
+        for (size_t nBegin = 0; nBegin < pending.size(); nBegin += nChunkSize) {
+            size_t const nEnd = std::min(pending.size(), nBegin + nChunkSize);
+            futures.push_back(pool.push([&pending, &deriveMint, nBegin, nEnd](int) {
+                for (size_t i = nBegin; i < nEnd; ++i)
+                    deriveMint(pending[i]);
+            }));
+        }
+        for (auto &future : futures)
+            future.get();
+    } else {
+        for (PendingMint &mint : pending)
+            deriveMint(mint);
+    }
+
+    for (const PendingMint &mint : pending) {
+        if (!mint.fValid)
             continue;
 
-        uint256 hashPubcoin = primitives::GetPubCoinValueHash(commitmentValue);
+        uint256 hashPubcoin = primitives::GetPubCoinValueHash(mint.commitmentValue);
 
-        MintPoolEntry mintPoolEntry(hashSeedMaster, seedId, nLastCount);
+        MintPoolEntry mintPoolEntry(hashSeedMaster, mint.seedId, mint.nCount);
         mintPool.Add(make_pair(hashPubcoin, mintPoolEntry));
-        walletdb.WritePubcoin(primitives::GetSerialHash(coin.getSerialNumber()), commitmentValue);
+        walletdb.WritePubcoin(mint.hashSerial, mint.commitmentValue);
         walletdb.WriteMintPoolPair(hashPubcoin, mintPoolEntry);
-        LogPrintf("%s : hashSeedMaster=%s hashPubcoin=%s seedId=%d count=%d\n", __func__, hashSeedMaster.GetHex(), hashPubcoin.GetHex(), seedId.GetHex(), nLastCount);
+        LogPrintf("%s : hashSeedMaster=%s hashPubcoin=%s seedId=%d count=%d\n", __func__, hashSeedMaster.GetHex(), hashPubcoin.GetHex(), mint.seedId.GetHex(), mint.nCount);
     }
 
     // write hdchain back to database
@@ -243,6 +288,8 @@ void CHDMintWallet::SetWalletTransactionBlock(CWalletTx &wtx, const CBlockIndex
  * Mints are created deterministically so we can completely regenerate all mints and transaction data for them from chain data.
  * Rather than a single pass of listMints, we wrap each pass in an outer while loop, that continues until no updates are found.
  * The reason for this is to allow the mint counter in the wallet to update and regenerate more of the mint pool should it need to.
+ * Each pass looks all unchecked mints up in the sigma state at once and reads every block containing some of them once.
+ * While mints keep being found the mint pool window grows, so that restoring a wallet with many mints takes few passes.
  *
  * @param fGenerateMintPool whether or not to call GenerateMintPool. defaults to true
  * @param listMints An optional value. If passed, only sync the mints in this list. Else get all mints in the mintpool
@@ -252,89 +299,101 @@ void CHDMintWallet::SyncWithChain(bool fGenerateMintPool, boost::optional<std::l
     LOCK(pwalletMain->cs_wallet);
     CWalletDB walletdb(strWalletFile);
     bool found = true;
+    int32_t nWindow = MINTPOOL_WINDOW_DEFAULT;
+    // Only a full sync is worth a progress dialog, block connection passes just a few mints
+    bool const fShowProgress = fGenerateMintPool && listMints == boost::none;
 
     set<uint256> setAddedTx;
     std::set<uint256> setChecked;
     while (found) {
         found = false;
-        if (fGenerateMintPool)
-            GenerateMintPool(walletdb);
+        // Extending the pool is a no-op until the mints in it are used up
+        GenerateMintPool(walletdb, 0, fGenerateMintPool ? nWindow : MINTPOOL_WINDOW_DEFAULT);
         LogPrintf("%s: Mintpool size=%d\n", __func__, mintPool.size());
 
         if(listMints==boost::none){
             listMints = list<pair<uint256, MintPoolEntry>>();
             mintPool.List(listMints.get());
         }
+
+        std::list<std::pair<uint256, MintPoolEntry>> listPending;
+        std::set<uint256> setPending;
         for (pair<uint256, MintPoolEntry>& pMint : listMints.get()) {
             if (setChecked.count(pMint.first))
                 continue;
             setChecked.insert(pMint.first);
 
-            if (ShutdownRequested())
-                return;
-
-            uint160& mintHashSeedMaster = get<0>(pMint.second);
-            int32_t& mintCount = get<2>(pMint.second);
-
             // halt processing if mint already in tracker
             if (tracker.HasPubcoinHash(pMint.first))
                 continue;
 
-            COutPoint outPoint;
-            if (sigma::GetOutPoint(outPoint, pMint.first)) {
-                const uint256& txHash = outPoint.hash;
-                //this mint has already occurred on the chain, increment counter's state to reflect this
-                LogPrintf("%s : Found wallet coin mint=%s count=%d tx=%s\n", __func__, pMint.first.GetHex(), mintCount, txHash.GetHex());
-                found = true;
+            listPending.push_back(pMint);
+            setPending.insert(pMint.first);
+        }
 
-                uint256 hashBlock;
-                CTransactionRef tx;
-                if (!GetTransaction(txHash, tx, Params().GetConsensus(), hashBlock, true)) {
-                    LogPrintf("%s : failed to get transaction for mint %s!\n", __func__, pMint.first.GetHex());
-                    found = false;
-                    continue;
-                }
+        std::map<uint256, std::pair<sigma::PublicCoin, sigma::CMintedCoinInfo>> mapMinted;
+        sigma::CSigmaState::GetState()->GetMintedCoinsByHash(setPending, mapMinted);
+
+        // Group the mints found on chain by the block they are in
+        std::map<int, std::vector<std::pair<uint256, MintPoolEntry>>> mapMintsByHeight;
+        for (pair<uint256, MintPoolEntry>& pMint : listPending) {
+            auto it = mapMinted.find(pMint.first);
+            if (it != mapMinted.end())
+                mapMintsByHeight[it->second.second.nHeight].push_back(pMint);
+        }
 
-                //Find the denomination
-                boost::optional<sigma::CoinDenomination> denomination = boost::none;
-                bool fFoundMint = false;
-                GroupElement bnValue;
+        size_t nBlocksDone = 0;
+        for (auto& heightMints : mapMintsByHeight) {
+            if (ShutdownRequested()) {
+                if (fShowProgress)
+                    pwalletMain->ShowProgress("", 100);
+                return;
+            }
+            if (fShowProgress)
+                pwalletMain->ShowProgress(_("Restoring mints..."), std::max(1, std::min(99, (int)(nBlocksDone++ * 100 / mapMintsByHeight.size()))));
+
+            CBlockIndex* pindex = chainActive[heightMints.first];
+            CBlock block;
+            if (!pindex || !ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+                LogPrintf("%s : failed to read block at height %d\n", __func__, heightMints.first);
+                continue;
+            }
+
+            // pubcoin hash -> transaction for all sigma mints in the block
+            std::map<uint256, CTransactionRef> mapBlockMints;
+            for (const CTransactionRef& tx : block.vtx) {
                 for (const CTxOut& out : tx->vout) {
                     if (!out.scriptPubKey.IsSigmaMint())
                         continue;
 
                     sigma::PublicCoin pubcoin;
                     CValidationState state;
-                    if (!TxOutToPublicCoin(out, pubcoin, state)) {
-                        LogPrintf("%s : failed to get mint from txout for %s!\n", __func__, pMint.first.GetHex());
+                    if (!TxOutToPublicCoin(out, pubcoin, state))
                         continue;
-                    }
-
-                    // See if this is the mint that we are looking for
-                    uint256 hashPubcoin = primitives::GetPubCoinValueHash(pubcoin.getValue());
-                    if (pMint.first == hashPubcoin) {
-                        denomination = pubcoin.getDenomination();
-                        bnValue = pubcoin.getValue();
-                        fFoundMint = true;
-                        break;
-                    }
+                    mapBlockMints.insert(std::make_pair(primitives::GetPubCoinValueHash(pubcoin.getValue()), tx));
                 }
+            }
+
+            for (pair<uint256, MintPoolEntry>& pMint : heightMints.second) {
+                uint160& mintHashSeedMaster = get<0>(pMint.second);
+                int32_t& mintCount = get<2>(pMint.second);
 
-                if (!fFoundMint || denomination == boost::none) {
-                    LogPrintf("%s : failed to get mint %s from tx %s!\n", __func__, pMint.first.GetHex(), tx->GetHash().GetHex());
-                    found = false;
-                    break;
+                auto txIt = mapBlockMints.find(pMint.first);
+                if (txIt == mapBlockMints.end()) {
+                    LogPrintf("%s : failed to get mint %s from block %s!\n", __func__, pMint.first.GetHex(), pindex->GetBlockHash().GetHex());
+                    continue;
                 }
+                const CTransactionRef& tx = txIt->second;
+                const uint256& txHash = tx->GetHash();
+                sigma::CoinDenomination denomination = mapMinted[pMint.first].second.denomination;
 
-                CBlockIndex* pindex = nullptr;
-                if (mapBlockIndex.count(hashBlock))
-                    pindex = mapBlockIndex.at(hashBlock);
+                //this mint has already occurred on the chain, increment counter's state to reflect this
+                LogPrintf("%s : Found wallet coin mint=%s count=%d tx=%s\n", __func__, pMint.first.GetHex(), mintCount, txHash.GetHex());
+                found = true;
 
                 if (!setAddedTx.count(txHash)) {
-                    CBlock block;
                     CWalletTx wtx(pwalletMain, tx);
-                    if (pindex && ReadBlockFromDisk(block, pindex, Params().GetConsensus()))
-                        SetWalletTransactionBlock(wtx, pindex, block);
+                    SetWalletTransactionBlock(wtx, pindex, block);
 
                     //Fill out wtx so that a transaction record can be created
                     wtx.nTimeReceived = pindex->GetBlockTime();
@@ -342,21 +401,27 @@ void CHDMintWallet::SyncWithChain(bool fGenerateMintPool, boost::optional<std::l
                     setAddedTx.insert(txHash);
                 }
 
-                if(!SetMintSeedSeen(walletdb, pMint, pindex->nHeight, txHash, denomination.get()))
+                if(!SetMintSeedSeen(walletdb, pMint, pindex->nHeight, txHash, denomination))
                     continue;
 
-                // Only update if the current hashSeedMaster matches the mints'
+                // Only update if the current hashSeedMaster matches the mints'. The mint pool is extended by the next
+                // pass rather than after every mint.
                 if(hashSeedMaster == mintHashSeedMaster && mintCount >= GetCount()){
                     SetCount(++mintCount);
-                    UpdateCountDB(walletdb);
+                    walletdb.WriteMintCount(nCountNextUse);
                     LogPrint("zero", "%s: updated count to %d\n", __func__, nCountNextUse);
                 }
             }
         }
         // Clear listMints to allow it to be repopulated by the mintPool on the next iteration
-        if(found)
+        if(found) {
             listMints = boost::none;
+            nWindow = std::min(nWindow * 4, MINTPOOL_WINDOW_MAX);
+        }
     }
+
+    if (fShowProgress)
+        pwalletMain->ShowProgress("", 100);
 }
 
 /**
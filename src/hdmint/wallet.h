@@ -27,6 +27,10 @@ private:
 
 public:
     int static const COUNT_DEFAULT = 0;
+    //! Number of mints the mint pool is extended by
+    int32_t static const MINTPOOL_WINDOW_DEFAULT = 20;
+    //! Upper bound for the window SyncWithChain grows to while it keeps finding mints
+    int32_t static const MINTPOOL_WINDOW_MAX = 1000;
 
     CHDMintWallet(const std::string& strWalletFile, bool resetCount=false);
 
@@ -40,7 +44,7 @@ public:
     bool IsSerialInBlockchain(const uint256& hashSerial, int& nHeightTx, uint256& txidSpend, CTransactionRef tx);
     bool TxOutToPublicCoin(const CTxOut& txout, sigma::PublicCoin& pubCoin, CValidationState& state);
     std::pair<uint256,uint256> RegenerateMintPoolEntry(CWalletDB& walletdb, const uint160& mintHashSeedMaster, CKeyID& seedId, const int32_t& nCount);
-    void GenerateMintPool(CWalletDB& walletdb, int32_t nIndex = 0);
+    void GenerateMintPool(CWalletDB& walletdb, int32_t nIndex = 0, int32_t nWindow = MINTPOOL_WINDOW_DEFAULT);
     bool SetMintSeedSeen(CWalletDB& walletdb, std::pair<uint256,MintPoolEntry> mintPoolEntryPair, const int& nHeight, const uint256& txid, const sigma::CoinDenomination& denom);
     bool SeedToMint(const uint512& mintSeed, GroupElement& bnValue, sigma::PrivateCoin& coin);
     // Count updating functions
@@ -28,6 +28,9 @@ static bool fSanitizeResponse = true;
 /** WWW-Authenticate to present with 401 Unauthorized response */
 static const char* WWW_AUTH_HEADER_DATA = "Basic realm=\"jsonrpc\"";
 
+/** Batch replies of at least this size are sent as a chunked reply while the batch is executing */
+static const size_t MIN_CHUNKED_REPLY_SIZE = 1024 * 1024;
+
 /** Simple one-shot callback timer to be used by the RPC mechanism to e.g.
  * re-lock the wallet.
  */
@@ -202,14 +205,47 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
                 strReply = SanitizeInvalidUTF8(strReply);
             }
 
-        // array of requests
-        } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(valRequest.get_array());
-        else
+        // array of requests, read-only ones also run on other worker threads of the lane serving the URI
+        } else if (valRequest.isArray()) {
+            HTTPWorkLane lane = GetHTTPWorkLane(jreq.URI);
+            int nHelpers = std::max(GetHTTPWorkLaneThreads(lane), 1) - 1;
+            // Once the replies add up to a large body, send it in chunks while the rest
+            // of the batch is still executing instead of holding all of it in memory
+            bool fChunked = false;
+            try {
+                JSONRPCWriteBatch(valRequest.get_array(), [req, &strReply, &fChunked](std::string&& strPart) {
+                    if (strReply.empty())
+                        strReply = std::move(strPart);
+                    else
+                        strReply += strPart;
+                    if (strReply.size() < MIN_CHUNKED_REPLY_SIZE)
+                        return;
+                    if (!fChunked) {
+                        req->WriteHeader("Content-Type", "application/json");
+                        req->WriteReplyStart(HTTP_OK);
+                        fChunked = true;
+                    }
+                    req->WriteReplyChunk(std::move(strReply));
+                    strReply.clear();
+                }, std::bind(QueueHTTPWork, lane, std::placeholders::_1), nHelpers);
+            } catch (...) {
+                if (!fChunked)
+                    throw;
+                // Too late for an error reply, end the truncated one
+                req->WriteReplyEnd();
+                return false;
+            }
+            if (fChunked) {
+                req->WriteReplyChunk(std::move(strReply));
+                req->WriteReplyEnd();
+                return true;
+            }
+        } else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
+        valRequest = UniValue();
 
         req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strReply);
+        req->WriteReply(HTTP_OK, std::move(strReply));
     } catch (const UniValue& objError) {
         JSONErrorReply(req, objError, jreq.id);
         return false;
@@ -248,6 +284,8 @@ bool StartHTTPRPC()
     fSanitizeResponse = GetBoolArg("-rpcforceutf8", true);
 
     RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    // Same JSON-RPC interface, served from the wallet work queue lane
+    RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC);
 
     assert(EventBase());
     httpRPCTimerInterface = new HTTPRPCTimerInterface(EventBase());
@@ -264,6 +302,7 @@ void StopHTTPRPC()
 {
     LogPrint("rpc", "Stopping HTTP RPC server\n");
     UnregisterHTTPHandler("/", true);
+    UnregisterHTTPHandler("/wallet/", false);
     if (httpRPCTimerInterface) {
         RPCUnsetTimerInterface(httpRPCTimerInterface);
         delete httpRPCTimerInterface;
@@ -58,6 +58,22 @@ private:
     HTTPRequestHandler func;
 };
 
+/** Work queued with QueueHTTPWork */
+class HTTPFunctionClosure : public HTTPClosure
+{
+public:
+    HTTPFunctionClosure(const std::function<void()>& _func): func(_func)
+    {
+    }
+    void operator()()
+    {
+        func();
+    }
+
+private:
+    std::function<void()> func;
+};
+
 /** Simple work queue for distributing work over multiple threads.
  * Work items are simply callable objects.
  */
@@ -65,13 +81,22 @@ template <typename WorkItem>
 class WorkQueue
 {
 private:
+    struct QueuedItem
+    {
+        std::unique_ptr<WorkItem> item;
+        int64_t nTimeQueued;
+    };
+
     /** Mutex protects entire object */
     std::mutex cs;
     std::condition_variable cond;
-    std::deque<std::unique_ptr<WorkItem>> queue;
+    std::deque<QueuedItem> queue;
     bool running;
     size_t maxDepth;
     int numThreads;
+    uint64_t nRejected;
+    CLatencyHistogram queueWait;
+    CLatencyHistogram exec;
 
     /** RAII object to keep track of number of running worker threads */
     class ThreadCounter
@@ -94,7 +119,8 @@ private:
 public:
     WorkQueue(size_t _maxDepth) : running(true),
                                  maxDepth(_maxDepth),
-                                 numThreads(0)
+                                 numThreads(0),
+                                 nRejected(0)
     {
     }
     /** Precondition: worker threads have all stopped
@@ -108,9 +134,10 @@ public:
     {
         std::unique_lock<std::mutex> lock(cs);
         if (queue.size() >= maxDepth) {
+            nRejected++;
             return false;
         }
-        queue.emplace_back(std::unique_ptr<WorkItem>(item));
+        queue.push_back(QueuedItem{std::unique_ptr<WorkItem>(item), GetTimeMicros()});
         cond.notify_one();
         return true;
     }
@@ -120,16 +147,22 @@ public:
         ThreadCounter count(*this);
         while (true) {
             std::unique_ptr<WorkItem> i;
+            int64_t nTimeStart;
             {
                 std::unique_lock<std::mutex> lock(cs);
                 while (running && queue.empty())
                     cond.wait(lock);
                 if (!running)
                     break;
-                i = std::move(queue.front());
+                i = std::move(queue.front().item);
+                nTimeStart = GetTimeMicros();
+                queueWait.Add(nTimeStart - queue.front().nTimeQueued);
                 queue.pop_front();
             }
             (*i)();
+            int64_t nTimeExec = GetTimeMicros() - nTimeStart;
+            std::unique_lock<std::mutex> lock(cs);
+            exec.Add(nTimeExec);
         }
     }
     /** Interrupt and exit loops */
@@ -153,18 +186,39 @@ public:
         std::unique_lock<std::mutex> lock(cs);
         return queue.size();
     }
+
+    void GetStats(HTTPWorkQueueStats& stats)
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        stats.nThreads = numThreads;
+        stats.nDepth = queue.size();
+        stats.nMaxDepth = maxDepth;
+        stats.nRejected = nRejected;
+        stats.queueWait = queueWait;
+        stats.exec = exec;
+    }
 };
 
+HTTPWorkLane GetHTTPWorkLane(const std::string& uri)
+{
+    if (uri.compare(0, 8, "/wallet/") == 0)
+        return HTTP_LANE_WALLET;
+    if (uri.compare(0, 6, "/rest/") == 0)
+        return HTTP_LANE_REST;
+    return HTTP_LANE_RPC;
+}
+
 struct HTTPPathHandler
 {
     HTTPPathHandler() {}
     HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler):
-        prefix(_prefix), exactMatch(_exactMatch), handler(_handler)
+        prefix(_prefix), exactMatch(_exactMatch), handler(_handler), lane(GetHTTPWorkLane(_prefix))
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    HTTPWorkLane lane;
 };
 
 /** HTTP module state */
@@ -175,8 +229,11 @@ static struct event_base* eventBase = 0;
 struct evhttp* eventHTTP = 0;
 //! List of subnets to allow RPC connections from
 static std::vector<CSubNet> rpc_allow_subnets;
-//! Work queue for handling longer requests off the event loop thread
-static WorkQueue<HTTPClosure>* workQueue = 0;
+//! Work queues for handling longer requests off the event loop thread, one per HTTPWorkLane
+static WorkQueue<HTTPClosure>* workQueues[HTTP_LANE_MAX] = {};
+static const char* const workLaneNames[HTTP_LANE_MAX] = {"rpc", "wallet", "rest"};
+//! Worker threads started for each lane
+static int workLaneThreads[HTTP_LANE_MAX] = {};
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
@@ -285,11 +342,12 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
     // Dispatch to worker thread
     if (i != iend) {
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
+        WorkQueue<HTTPClosure>* workQueue = workQueues[i->lane];
         assert(workQueue);
         if (workQueue->Enqueue(item.get()))
             item.release(); /* if true, queue took ownership */
         else {
-            LogPrintf("WARNING: request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n");
+            LogPrintf("WARNING: request rejected because http %s work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n", workLaneNames[i->lane]);
             item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
         }
     } else {
@@ -297,6 +355,36 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
     }
 }
 
+bool QueueHTTPWork(HTTPWorkLane lane, const std::function<void()>& func)
+{
+    WorkQueue<HTTPClosure>* workQueue = workQueues[lane];
+    if (!workQueue)
+        return false;
+    std::unique_ptr<HTTPFunctionClosure> item(new HTTPFunctionClosure(func));
+    if (!workQueue->Enqueue(item.get()))
+        return false;
+    item.release(); /* queue took ownership */
+    return true;
+}
+
+int GetHTTPWorkLaneThreads(HTTPWorkLane lane)
+{
+    return workLaneThreads[lane];
+}
+
+void GetHTTPWorkQueueStats(std::vector<HTTPWorkQueueStats>& vStatsRet)
+{
+    vStatsRet.clear();
+    for (int lane = 0; lane < HTTP_LANE_MAX; lane++) {
+        if (!workQueues[lane])
+            continue;
+        HTTPWorkQueueStats stats;
+        stats.name = workLaneNames[lane];
+        workQueues[lane]->GetStats(stats);
+        vStatsRet.push_back(stats);
+    }
+}
+
 /** Callback to reject HTTP requests after shutdown. */
 static void http_reject_request_cb(struct evhttp_request* req, void*)
 {
@@ -433,9 +521,10 @@ bool InitHTTPServer()
 
     LogPrint("http", "Initialized HTTP server\n");
     int workQueueDepth = std::max((long)GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
-    LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
+    LogPrintf("HTTP: creating work queues of depth %d\n", workQueueDepth);
 
-    workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
+    for (int lane = 0; lane < HTTP_LANE_MAX; lane++)
+        workQueues[lane] = new WorkQueue<HTTPClosure>(workQueueDepth);
     eventBase = base;
     eventHTTP = http;
     return true;
@@ -447,15 +536,19 @@ std::future<bool> threadResult;
 bool StartHTTPServer()
 {
     LogPrint("http", "Starting HTTP server\n");
-    int rpcThreads = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
-    LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
+    workLaneThreads[HTTP_LANE_RPC] = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
+    workLaneThreads[HTTP_LANE_WALLET] = std::max((long)GetArg("-rpcwalletthreads", DEFAULT_HTTP_WALLET_THREADS), 1L);
+    workLaneThreads[HTTP_LANE_REST] = std::max((long)GetArg("-restthreads", DEFAULT_HTTP_REST_THREADS), 1L);
+    LogPrintf("HTTP: starting %d rpc, %d wallet and %d rest worker threads\n", workLaneThreads[HTTP_LANE_RPC], workLaneThreads[HTTP_LANE_WALLET], workLaneThreads[HTTP_LANE_REST]);
     std::packaged_task<bool(event_base*, evhttp*)> task(ThreadHTTP);
     threadResult = task.get_future();
     threadHTTP = std::thread(std::move(task), eventBase, eventHTTP);
 
-    for (int i = 0; i < rpcThreads; i++) {
-        std::thread rpc_worker(HTTPWorkQueueRun, workQueue);
-        rpc_worker.detach();
+    for (int lane = 0; lane < HTTP_LANE_MAX; lane++) {
+        for (int i = 0; i < workLaneThreads[lane]; i++) {
+            std::thread rpc_worker(HTTPWorkQueueRun, workQueues[lane]);
+            rpc_worker.detach();
+        }
     }
     return true;
 }
@@ -471,17 +564,22 @@ void InterruptHTTPServer()
         // Reject requests on current connections
         evhttp_set_gencb(eventHTTP, http_reject_request_cb, NULL);
     }
-    if (workQueue)
-        workQueue->Interrupt();
+    for (WorkQueue<HTTPClosure>* workQueue : workQueues) {
+        if (workQueue)
+            workQueue->Interrupt();
+    }
 }
 
 void StopHTTPServer()
 {
     LogPrint("http", "Stopping HTTP server\n");
-    if (workQueue) {
-        LogPrint("http", "Waiting for HTTP worker threads to exit\n");
-        workQueue->WaitExit();
-        delete workQueue;
+    LogPrint("http", "Waiting for HTTP worker threads to exit\n");
+    for (WorkQueue<HTTPClosure>*& workQueue : workQueues) {
+        if (workQueue) {
+            workQueue->WaitExit();
+            delete workQueue;
+            workQueue = 0;
+        }
     }
     if (eventBase) {
         LogPrint("http", "Waiting for HTTP event thread to exit\n");
@@ -549,6 +647,9 @@ HTTPRequest::~HTTPRequest()
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
         WriteReply(HTTP_INTERNAL, "Unhandled request");
+    } else if (chunkedReply) {
+        // Finish a chunked reply that was left open, so the request isn't leaked
+        WriteReplyEnd();
     }
     // evhttpd cleans up the request, as long as a reply was sent.
 }
@@ -610,6 +711,123 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = 0; // transferred back to main thread
 }
 
+static void FreeReplyString(const void* /*data*/, size_t /*datalen*/, void* extra)
+{
+    delete static_cast<std::string*>(extra);
+}
+
+// Below this, copying is cheaper than the extra allocation
+static const size_t MIN_REFERENCE_REPLY_SIZE = 64 * 1024;
+
+/** Add strReply to evb, handing large strings to libevent without copying them */
+static void AddReplyString(struct evbuffer* evb, std::string&& strReply)
+{
+    if (strReply.size() < MIN_REFERENCE_REPLY_SIZE) {
+        evbuffer_add(evb, strReply.data(), strReply.size());
+        return;
+    }
+    std::string* pstrReply = new std::string(std::move(strReply));
+    if (evbuffer_add_reference(evb, pstrReply->data(), pstrReply->size(), FreeReplyString, pstrReply) != 0) {
+        evbuffer_add(evb, pstrReply->data(), pstrReply->size());
+        delete pstrReply;
+    }
+}
+
+void HTTPRequest::WriteReply(int nStatus, std::string&& strReply)
+{
+    if (strReply.size() < MIN_REFERENCE_REPLY_SIZE) {
+        WriteReply(nStatus, static_cast<const std::string&>(strReply));
+        return;
+    }
+
+    assert(!replySent && req);
+    struct evbuffer* evb = evhttp_request_get_output_buffer(req);
+    assert(evb);
+    AddReplyString(evb, std::move(strReply));
+    HTTPEvent* ev = new HTTPEvent(eventBase, true,
+        std::bind(evhttp_send_reply, req, nStatus, (const char*)NULL, (struct evbuffer *)NULL));
+    ev->trigger(0);
+    replySent = true;
+    req = 0; // transferred back to main thread
+}
+
+/** Chunks of a chunked reply, queued by a worker until the main thread passes them to libevent */
+struct HTTPChunkedReply
+{
+    struct evhttp_request* req;
+    int nStatus;
+    bool fStarted; // only used by the main thread
+
+    std::mutex cs;
+    std::deque<std::string> chunks;
+    bool fEnd;
+    bool fDone;
+
+    HTTPChunkedReply(struct evhttp_request* _req, int _nStatus) : req(_req), nStatus(_nStatus), fStarted(false), fEnd(false), fDone(false) {}
+};
+
+/** Runs in the main thread. Events may run in any order, so each one sends everything queued so far. */
+static void SendReplyChunks(const std::shared_ptr<HTTPChunkedReply>& reply)
+{
+    std::deque<std::string> chunks;
+    bool fEnd;
+    {
+        std::lock_guard<std::mutex> lock(reply->cs);
+        if (reply->fDone)
+            return;
+        chunks.swap(reply->chunks);
+        fEnd = reply->fDone = reply->fEnd;
+    }
+    if (!reply->fStarted) {
+        evhttp_send_reply_start(reply->req, reply->nStatus, NULL);
+        reply->fStarted = true;
+    }
+    for (std::string& strChunk : chunks) {
+        struct evbuffer* evb = evbuffer_new();
+        assert(evb);
+        AddReplyString(evb, std::move(strChunk));
+        evhttp_send_reply_chunk(reply->req, evb);
+        evbuffer_free(evb);
+    }
+    if (fEnd)
+        evhttp_send_reply_end(reply->req); // also frees req
+}
+
+void HTTPRequest::WriteReplyStart(int nStatus)
+{
+    assert(!replySent && req);
+    chunkedReply = std::make_shared<HTTPChunkedReply>(req, nStatus);
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, std::bind(SendReplyChunks, chunkedReply));
+    ev->trigger(0);
+    replySent = true;
+}
+
+void HTTPRequest::WriteReplyChunk(std::string&& strChunk)
+{
+    assert(chunkedReply && req);
+    if (strChunk.empty())
+        return; // libevent 2.0 would send an empty chunk as the end of the reply
+    {
+        std::lock_guard<std::mutex> lock(chunkedReply->cs);
+        chunkedReply->chunks.push_back(std::move(strChunk));
+    }
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, std::bind(SendReplyChunks, chunkedReply));
+    ev->trigger(0);
+}
+
+void HTTPRequest::WriteReplyEnd()
+{
+    assert(chunkedReply && req);
+    {
+        std::lock_guard<std::mutex> lock(chunkedReply->cs);
+        chunkedReply->fEnd = true;
+    }
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, std::bind(SendReplyChunks, chunkedReply));
+    ev->trigger(0);
+    chunkedReply.reset();
+    req = 0; // transferred back to main thread
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
@@ -5,18 +5,53 @@
 #ifndef BITCOIN_HTTPSERVER_H
 #define BITCOIN_HTTPSERVER_H
 
+#include "latencystats.h"
+
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <memory>
+#include <vector>
 
 static const int DEFAULT_HTTP_THREADS=4;
+static const int DEFAULT_HTTP_WALLET_THREADS=2;
+static const int DEFAULT_HTTP_REST_THREADS=2;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
 
+/**
+ * Requests are queued and executed per lane, each with its own queue depth and worker
+ * threads, so slow requests in one lane can't starve the others. The lane follows from
+ * the path a handler is registered for: /wallet/ and /rest/ have their own lanes,
+ * everything else, including JSON-RPC on /, goes to the rpc lane.
+ */
+enum HTTPWorkLane
+{
+    HTTP_LANE_RPC,
+    HTTP_LANE_WALLET,
+    HTTP_LANE_REST,
+    HTTP_LANE_MAX
+};
+
+struct HTTPWorkQueueStats
+{
+    std::string name;
+    int nThreads = 0;
+    size_t nDepth = 0;
+    size_t nMaxDepth = 0;
+    //! Requests turned away because the queue was full
+    uint64_t nRejected = 0;
+    //! Time requests waited for a worker
+    CLatencyHistogram queueWait;
+    //! Time requests took to execute
+    CLatencyHistogram exec;
+};
+
 struct evhttp_request;
 struct event_base;
 class CService;
 class HTTPRequest;
+struct HTTPChunkedReply;
 
 /** Initialize HTTP server.
  * Call this before RegisterHTTPHandler or EventBase().
@@ -42,6 +77,16 @@ void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPR
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
+/** Lane whose worker threads serve requests for uri */
+HTTPWorkLane GetHTTPWorkLane(const std::string& uri);
+/** Run func on one of lane's HTTP worker threads. Returns false if the work queue is full. */
+bool QueueHTTPWork(HTTPWorkLane lane, const std::function<void()>& func);
+/** Number of worker threads serving lane, zero before the HTTP server is started */
+int GetHTTPWorkLaneThreads(HTTPWorkLane lane);
+
+/** Get depth, rejections and timings of each work queue lane */
+void GetHTTPWorkQueueStats(std::vector<HTTPWorkQueueStats>& vStatsRet);
+
 /** Return evhttp event base. This can be used by submodules to
  * queue timers or custom events.
  */
@@ -55,6 +100,7 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    std::shared_ptr<HTTPChunkedReply> chunkedReply;
 
 public:
     HTTPRequest(struct evhttp_request* req);
@@ -110,6 +156,20 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+    /** Same, but large replies are handed to libevent without copying them */
+    void WriteReply(int nStatus, std::string&& strReply);
+
+    /**
+     * Start a chunked HTTP reply, for bodies that are sent while they are still
+     * being produced. The body is passed in with WriteReplyChunk and the reply
+     * is finished with WriteReplyEnd.
+     *
+     * @note Use instead of WriteReply. After WriteReplyEnd, do not call any
+     * other HTTPRequest methods.
+     */
+    void WriteReplyStart(int nStatus);
+    void WriteReplyChunk(std::string&& strChunk);
+    void WriteReplyEnd();
 };
 
 /** Event handler closure.
@@ -30,6 +30,8 @@ static const int MIN_INDEXNODE_PAYMENT_PROTO_VERSION_2 = LEGACY_INDEXNODES_PROTO
 extern CCriticalSection cs_vecPayees;
 extern CCriticalSection cs_mapZnodeBlocks;
 extern CCriticalSection cs_mapZnodePayeeVotes;
+//! Guards znpayments.mapZnodePaymentVotes
+extern CCriticalSection cs_mapZnodePaymentVotes;
 
 extern CZnodePayments znpayments;
 
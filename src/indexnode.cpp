@@ -169,7 +169,11 @@ bool CZnode::UpdateFromNewBroadcast(CZnodeBroadcast &mnb) {
 // and get paid this block
 //
 arith_uint256 CZnode::CalculateScore(const uint256 &blockHash) {
-    uint256 aux = ArithToUint256(UintToArith256(vin.prevout.hash) + vin.prevout.n);
+    return CalculateScore(vin.prevout, blockHash);
+}
+
+arith_uint256 CZnode::CalculateScore(const COutPoint &outpoint, const uint256 &blockHash) {
+    uint256 aux = ArithToUint256(UintToArith256(outpoint.hash) + outpoint.n);
 
     CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
     ss << blockHash;
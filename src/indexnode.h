@@ -255,6 +255,7 @@ public:
 
     // CALCULATE A RANK AGAINST OF GIVEN BLOCK
     arith_uint256 CalculateScore(const uint256& blockHash);
+    static arith_uint256 CalculateScore(const COutPoint& outpoint, const uint256& blockHash);
 
     bool UpdateFromNewBroadcast(CZnodeBroadcast& mnb);
 
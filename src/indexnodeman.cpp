@@ -81,10 +81,10 @@ struct CompareLastPaidBlock
 
 struct CompareScoreMN
 {
-    bool operator()(const std::pair<int64_t, CZnode*>& t1,
-                    const std::pair<int64_t, CZnode*>& t2) const
+    bool operator()(const std::pair<int64_t, COutPoint>& t1,
+                    const std::pair<int64_t, COutPoint>& t2) const
     {
-        return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->vin < t2.second->vin);
+        return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second < t2.second);
     }
 };
 
@@ -168,7 +168,8 @@ CZnodeMan::CZnodeMan() : cs(),
   nLastWatchdogVoteTime(0),
   mapSeenZnodeBroadcast(),
   mapSeenZnodePing(),
-  nDsqCount(0)
+  nDsqCount(0),
+  nScoresCacheVersion(0)
 {}
 
 bool CZnodeMan::Add(CZnode &mn)
@@ -179,6 +180,8 @@ bool CZnodeMan::Add(CZnode &mn)
     if (pmn == NULL) {
         LogPrint("indexnode", "CZnodeMan::Add -- Adding new Znode: addr=%s, %i now\n", mn.addr.ToString(), size() + 1);
         vIndexnodes.push_back(mn);
+        AddToLookupMaps(vIndexnodes.size() - 1);
+        InvalidateScoresCache();
         indexIndexnodes.AddZnodeVIN(mn.vin);
         fIndexnodesAdded = true;
         return true;
@@ -260,6 +263,7 @@ void CZnodeMan::CheckAndRemove()
 //                it->FlagGovernanceItemsAsDirty();
                 it = vIndexnodes.erase(it);
                 fIndexnodesRemoved = true;
+                InvalidateScoresCache();
             } else {
                 bool fAsk = pCurrentBlockIndex &&
                             (nAskForMnbRecovery > 0) &&
@@ -295,6 +299,10 @@ void CZnodeMan::CheckAndRemove()
                 ++it;
             }
         }
+        // Positions shifted with every erase, the Find functions cope with that until the maps are rebuilt here
+        if(fIndexnodesRemoved) {
+            RebuildLookupMaps();
+        }
 
         // proces replies for INDEXNODE_NEW_START_REQUIRED indexnodes
         LogPrint("indexnode", "CZnodeMan::CheckAndRemove -- mMnbRecoveryGoodReplies size=%d\n", (int)mMnbRecoveryGoodReplies.size());
@@ -419,6 +427,8 @@ void CZnodeMan::Clear()
 {
     LOCK(cs);
     vIndexnodes.clear();
+    RebuildLookupMaps();
+    InvalidateScoresCache();
     mAskedUsForZnodeList.clear();
     mWeAskedForZnodeList.clear();
     mWeAskedForZnodeListEntry.clear();
@@ -496,18 +506,48 @@ void CZnodeMan::DsegUpdate(CNode* pnode)
     LogPrint("indexnode", "CZnodeMan::DsegUpdate -- asked %s for the list\n", pnode->addr.ToString());
 }
 
-CZnode* CZnodeMan::Find(const std::string &txHash, const std::string &outputIndex)
+void CZnodeMan::AddToLookupMaps(size_t nPos)
 {
-    LOCK(cs);
+    AssertLockHeld(cs);
 
-    BOOST_FOREACH(CZnode& mn, vIndexnodes)
-    {
-        COutPoint outpoint = mn.vin.prevout;
+    const CZnode& mn = vIndexnodes[nPos];
+    mapOutpointToPos[mn.vin.prevout] = nPos;
+
+    // keep pointing to the first entry with this key, as the linear scans did before
+    CKeyID keyID = mn.pubKeyZnode.GetID();
+    auto it = mapPubKeyToPos.find(keyID);
+    if (it == mapPubKeyToPos.end() || it->second > nPos || vIndexnodes[it->second].pubKeyZnode.GetID() != keyID) {
+        mapPubKeyToPos[keyID] = nPos;
+    }
+    CKeyID payeeID = mn.pubKeyCollateralAddress.GetID();
+    it = mapPayeeToPos.find(payeeID);
+    if (it == mapPayeeToPos.end() || it->second > nPos || vIndexnodes[it->second].pubKeyCollateralAddress.GetID() != payeeID) {
+        mapPayeeToPos[payeeID] = nPos;
+    }
+}
 
-        if(txHash==outpoint.hash.ToString().substr(0,64) &&
-           outputIndex==to_string(outpoint.n))
-            return &mn;
+void CZnodeMan::RebuildLookupMaps()
+{
+    AssertLockHeld(cs);
+
+    mapOutpointToPos.clear();
+    mapPubKeyToPos.clear();
+    mapPayeeToPos.clear();
+    mapOutpointToPos.reserve(vIndexnodes.size());
+    for (size_t i = 0; i < vIndexnodes.size(); i++) {
+        AddToLookupMaps(i);
     }
+}
+
+CZnode* CZnodeMan::Find(const std::string &txHash, const std::string &outputIndex)
+{
+    LOCK(cs);
+
+    CZnode* pmn = Find(COutPoint(uint256S(txHash), (uint32_t)atoi(outputIndex)));
+    // only exact string representations match
+    if(pmn && txHash == pmn->vin.prevout.hash.ToString().substr(0,64) &&
+       outputIndex == to_string(pmn->vin.prevout.n))
+        return pmn;
     return NULL;
 }
 
@@ -515,23 +555,54 @@ CZnode* CZnodeMan::Find(const CScript &payee)
 {
     LOCK(cs);
 
-    BOOST_FOREACH(CZnode& mn, vIndexnodes)
-    {
-        if(GetScriptForDestination(mn.pubKeyCollateralAddress.GetID()) == payee)
-            return &mn;
+    CTxDestination dest;
+    if(!ExtractDestination(payee, dest) || !boost::get<CKeyID>(&dest))
+        return NULL;
+    CKeyID keyID = boost::get<CKeyID>(dest);
+
+    auto it = mapPayeeToPos.find(keyID);
+    if(it == mapPayeeToPos.end())
+        return NULL;
+    if(it->second >= vIndexnodes.size() || vIndexnodes[it->second].pubKeyCollateralAddress.GetID() != keyID) {
+        // the entry is stale (removed or moved since the maps were built), look for the first one with this key
+        size_t i = 0;
+        while(i < vIndexnodes.size() && vIndexnodes[i].pubKeyCollateralAddress.GetID() != keyID)
+            i++;
+        if(i == vIndexnodes.size()) {
+            mapPayeeToPos.erase(it);
+            return NULL;
+        }
+        it->second = i;
     }
-    return NULL;
+
+    // the key is known, but payee may be another script form for it (e.g. P2PK), which doesn't match
+    CZnode* pmn = &vIndexnodes[it->second];
+    return GetScriptForDestination(pmn->pubKeyCollateralAddress.GetID()) == payee ? pmn : NULL;
 }
 
 CZnode* CZnodeMan::Find(const CTxIn &vin)
+{
+    return Find(vin.prevout);
+}
+
+CZnode* CZnodeMan::Find(const COutPoint &outpoint)
 {
     LOCK(cs);
 
-    BOOST_FOREACH(CZnode& mn, vIndexnodes)
-    {
-        if(mn.vin.prevout == vin.prevout)
-            return &mn;
+    auto it = mapOutpointToPos.find(outpoint);
+    if(it == mapOutpointToPos.end())
+        return NULL;
+    if(it->second < vIndexnodes.size() && vIndexnodes[it->second].vin.prevout == outpoint)
+        return &vIndexnodes[it->second];
+
+    // the entry moved since the maps were built
+    for(size_t i = 0; i < vIndexnodes.size(); i++) {
+        if(vIndexnodes[i].vin.prevout == outpoint) {
+            it->second = i;
+            return &vIndexnodes[i];
+        }
     }
+    mapOutpointToPos.erase(it);
     return NULL;
 }
 
@@ -539,11 +610,20 @@ CZnode* CZnodeMan::Find(const CPubKey &pubKeyZnode)
 {
     LOCK(cs);
 
-    BOOST_FOREACH(CZnode& mn, vIndexnodes)
-    {
-        if(mn.pubKeyZnode == pubKeyZnode)
-            return &mn;
+    auto it = mapPubKeyToPos.find(pubKeyZnode.GetID());
+    if(it == mapPubKeyToPos.end())
+        return NULL;
+    if(it->second < vIndexnodes.size() && vIndexnodes[it->second].pubKeyZnode == pubKeyZnode)
+        return &vIndexnodes[it->second];
+
+    // the entry we pointed to got a new key from a broadcast, look for another one still using this key
+    for(size_t i = 0; i < vIndexnodes.size(); i++) {
+        if(vIndexnodes[i].pubKeyZnode == pubKeyZnode) {
+            it->second = i;
+            return &vIndexnodes[i];
+        }
     }
+    mapPubKeyToPos.erase(it);
     return NULL;
 }
 
@@ -797,36 +877,76 @@ CZnode* CZnodeMan::FindRandomNotInVec(const std::vector<CTxIn> &vecToExclude, in
     return NULL;
 }
 
-int CZnodeMan::GetZnodeRank(const CTxIn& vin, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
+void CZnodeMan::InvalidateScoresCache()
 {
-    std::vector<std::pair<int64_t, CZnode*> > vecZnodeScores;
+    LOCK(cs_scores);
+    mapScoresCache.clear();
+    nScoresCacheVersion++;
+}
 
+CZnodeMan::score_pair_vec_cptr CZnodeMan::GetZnodeScores(const uint256& blockHash)
+{
+    score_pair_vec_cptr scores;
+    uint64_t nVersion;
+    {
+        LOCK(cs_scores);
+        if (mapScoresCache.get(blockHash, scores)) {
+            return scores;
+        }
+        nVersion = nScoresCacheVersion;
+    }
+
+    std::vector<COutPoint> vecOutpoints;
+    {
+        LOCK(cs);
+        vecOutpoints.reserve(vIndexnodes.size());
+        for (const CZnode& mn : vIndexnodes) {
+            vecOutpoints.emplace_back(mn.vin.prevout);
+        }
+    }
+
+    // hash outside of any lock
+    auto vecScores = std::make_shared<score_pair_vec_t>();
+    vecScores->reserve(vecOutpoints.size());
+    for (const COutPoint& outpoint : vecOutpoints) {
+        vecScores->emplace_back(CZnode::CalculateScore(outpoint, blockHash).GetCompact(false), outpoint);
+    }
+    sort(vecScores->rbegin(), vecScores->rend(), CompareScoreMN());
+    scores = vecScores;
+
+    {
+        LOCK(cs_scores);
+        // the list changed while we were calculating, let the next call redo it
+        if (nVersion == nScoresCacheVersion) {
+            mapScoresCache.insert(blockHash, scores);
+        }
+    }
+    return scores;
+}
+
+int CZnodeMan::GetZnodeRank(const CTxIn& vin, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
+{
     //make sure we know about this block
     uint256 blockHash = uint256();
     if(!GetBlockHash(blockHash, nBlockHeight)) return -1;
 
+    score_pair_vec_cptr scores = GetZnodeScores(blockHash);
+
     LOCK(cs);
 
-    // scan for winner
-    BOOST_FOREACH(CZnode& mn, vIndexnodes) {
-        if(mn.nProtocolVersion < nMinProtocol) continue;
+    int nRank = 0;
+    for (const auto& scorePair : *scores) {
+        CZnode* pmn = Find(scorePair.second);
+        if(!pmn) continue;
+        if(pmn->nProtocolVersion < nMinProtocol) continue;
         if(fOnlyActive) {
-            if(!mn.IsEnabled()) continue;
+            if(!pmn->IsEnabled()) continue;
         }
         else {
-            if(!mn.IsValidForPayment()) continue;
+            if(!pmn->IsValidForPayment()) continue;
         }
-        int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
-
-        vecZnodeScores.push_back(std::make_pair(nScore, &mn));
-    }
-
-    sort(vecZnodeScores.rbegin(), vecZnodeScores.rend(), CompareScoreMN());
-
-    int nRank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CZnode*)& scorePair, vecZnodeScores) {
         nRank++;
-        if(scorePair.second->vin.prevout == vin.prevout) return nRank;
+        if(scorePair.second == vin.prevout) return nRank;
     }
 
     return -1;
@@ -834,31 +954,23 @@ int CZnodeMan::GetZnodeRank(const CTxIn& vin, int nBlockHeight, int nMinProtocol
 
 std::vector<std::pair<int, CZnode> > CZnodeMan::GetZnodeRanks(int nBlockHeight, int nMinProtocol)
 {
-    std::vector<std::pair<int64_t, CZnode*> > vecZnodeScores;
     std::vector<std::pair<int, CZnode> > vecZnodeRanks;
 
     //make sure we know about this block
     uint256 blockHash = uint256();
     if(!GetBlockHash(blockHash, nBlockHeight)) return vecZnodeRanks;
 
-    LOCK(cs);
-
-    // scan for winner
-    BOOST_FOREACH(CZnode& mn, vIndexnodes) {
-
-        if(mn.nProtocolVersion < nMinProtocol || !mn.IsEnabled()) continue;
-
-        int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
-
-        vecZnodeScores.push_back(std::make_pair(nScore, &mn));
-    }
+    score_pair_vec_cptr scores = GetZnodeScores(blockHash);
 
-    sort(vecZnodeScores.rbegin(), vecZnodeScores.rend(), CompareScoreMN());
+    LOCK(cs);
 
     int nRank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CZnode*)& s, vecZnodeScores) {
+    for (const auto& scorePair : *scores) {
+        CZnode* pmn = Find(scorePair.second);
+        if(!pmn) continue;
+        if(pmn->nProtocolVersion < nMinProtocol || !pmn->IsEnabled()) continue;
         nRank++;
-        vecZnodeRanks.push_back(std::make_pair(nRank, *s.second));
+        vecZnodeRanks.push_back(std::make_pair(nRank, *pmn));
     }
 
     return vecZnodeRanks;
@@ -866,34 +978,25 @@ std::vector<std::pair<int, CZnode> > CZnodeMan::GetZnodeRanks(int nBlockHeight,
 
 CZnode* CZnodeMan::GetZnodeByRank(int nRank, int nBlockHeight, int nMinProtocol, bool fOnlyActive)
 {
-    std::vector<std::pair<int64_t, CZnode*> > vecZnodeScores;
-
-    LOCK(cs);
-
     uint256 blockHash;
     if(!GetBlockHash(blockHash, nBlockHeight)) {
         LogPrintf("CZnode::GetZnodeByRank -- ERROR: GetBlockHash() failed at nBlockHeight %d\n", nBlockHeight);
         return NULL;
     }
 
-    // Fill scores
-    BOOST_FOREACH(CZnode& mn, vIndexnodes) {
-
-        if(mn.nProtocolVersion < nMinProtocol) continue;
-        if(fOnlyActive && !mn.IsEnabled()) continue;
-
-        int64_t nScore = mn.CalculateScore(blockHash).GetCompact(false);
+    score_pair_vec_cptr scores = GetZnodeScores(blockHash);
 
-        vecZnodeScores.push_back(std::make_pair(nScore, &mn));
-    }
-
-    sort(vecZnodeScores.rbegin(), vecZnodeScores.rend(), CompareScoreMN());
+    LOCK(cs);
 
     int rank = 0;
-    BOOST_FOREACH (PAIRTYPE(int64_t, CZnode*)& s, vecZnodeScores){
+    for (const auto& scorePair : *scores) {
+        CZnode* pmn = Find(scorePair.second);
+        if(!pmn) continue;
+        if(pmn->nProtocolVersion < nMinProtocol) continue;
+        if(fOnlyActive && !pmn->IsEnabled()) continue;
         rank++;
         if(rank == nRank) {
-            return s.second;
+            return pmn;
         }
     }
 
@@ -1579,6 +1682,7 @@ void CZnodeMan::UpdateZnodeList(CZnodeBroadcast mnb)
         } else {
             CZnodeBroadcast mnbOld = mapSeenZnodeBroadcast[CZnodeBroadcast(*pmn).GetHash()].second;
             if (pmn->UpdateFromNewBroadcast(mnb)) {
+                AddToLookupMaps(pmn - &vIndexnodes[0]);
                 indexnodeSync.AddedZnodeList();
                 mapSeenZnodeBroadcast.erase(mnbOld.GetHash());
             }
@@ -1643,7 +1747,10 @@ bool CZnodeMan::CheckMnbAndUpdateZnodeList(CNode* pfrom, CZnodeBroadcast mnb, in
         CZnode *pmn = Find(mnb.vin);
         if (pmn) {
             CZnodeBroadcast mnbOld = mapSeenZnodeBroadcast[CZnodeBroadcast(*pmn).GetHash()].second;
-            if (!mnb.Update(pmn, nDos)) {
+            bool fUpdated = mnb.Update(pmn, nDos);
+            // pubKeyZnode might have been replaced by the new broadcast
+            AddToLookupMaps(pmn - &vIndexnodes[0]);
+            if (!fUpdated) {
                 LogPrint("indexnode", "CZnodeMan::CheckMnbAndUpdateZnodeList -- Update() failed, indexnode=%s\n", mnb.vin.prevout.ToStringShort());
                 return false;
             }
@@ -6,7 +6,12 @@
 #define INDEXNODEMAN_H
 
 #include "indexnode.h"
+#include "saltedhasher.h"
 #include "sync.h"
+#include "unordered_lru_cache.h"
+
+#include <memory>
+#include <unordered_map>
 
 using namespace std;
 
@@ -110,6 +115,8 @@ private:
     static const int MNB_RECOVERY_WAIT_SECONDS      = 60;
     static const int MNB_RECOVERY_RETRY_SECONDS     = 3 * 60 * 60;
 
+    typedef std::vector<std::pair<int64_t, COutPoint> > score_pair_vec_t;
+    typedef std::shared_ptr<const score_pair_vec_t> score_pair_vec_cptr;
 
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -119,6 +126,19 @@ private:
 
     // map to hold all MNs
     std::vector<CZnode> vIndexnodes;
+    // lookup maps into vIndexnodes, rebuilt after entries are removed; Find verifies an entry before using it
+    std::unordered_map<COutPoint, size_t, SaltedOutpointHasher> mapOutpointToPos;
+    // keyed by pubKeyZnode.GetID() and pubKeyCollateralAddress.GetID(), point to the first matching entry
+    std::unordered_map<uint160, size_t, StaticSaltedHasher> mapPubKeyToPos;
+    std::unordered_map<uint160, size_t, StaticSaltedHasher> mapPayeeToPos;
+
+    // All known indexnodes sorted by their score for a given block hash (best first). Scores only depend
+    // on the collateral outpoint and the block hash, so rank queries only need to apply their filters.
+    // Protected by cs_scores, which is never held while calculating scores
+    CCriticalSection cs_scores;
+    unordered_lru_cache<uint256, score_pair_vec_cptr, StaticSaltedHasher, 32> mapScoresCache;
+    // bumped whenever indexnodes are added or removed so that concurrently calculated lists are not cached
+    uint64_t nScoresCacheVersion;
     // who's asked for the Znode list and the last time
     std::map<CNetAddr, int64_t> mAskedUsForZnodeList;
     // who we asked for the Znode list and the last time
@@ -156,6 +176,14 @@ private:
 
     friend class CZnodeSync;
 
+    /// Add vIndexnodes[nPos] to the lookup maps, must be called whenever its keys may have changed
+    void AddToLookupMaps(size_t nPos);
+    void RebuildLookupMaps();
+
+    void InvalidateScoresCache();
+    /// Get all known indexnodes sorted by their score for blockHash, cached per block hash
+    score_pair_vec_cptr GetZnodeScores(const uint256& blockHash);
+
 public:
     // Keep track of all broadcasts I've seen
     std::map<uint256, std::pair<int64_t, CZnodeBroadcast> > mapSeenZnodeBroadcast;
@@ -196,6 +224,10 @@ public:
         if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
             Clear();
         }
+        if(ser_action.ForRead()) {
+            RebuildLookupMaps();
+            InvalidateScoresCache();
+        }
     }
 
     CZnodeMan();
@@ -232,6 +264,7 @@ public:
     CZnode* Find(const std::string &txHash, const std::string &outputIndex);
     CZnode* Find(const CScript &payee);
     CZnode* Find(const CTxIn& vin);
+    CZnode* Find(const COutPoint& outpoint);
     CZnode* Find(const CPubKey& pubKeyZnode);
 
     /// Versions of Find that are safe to use from outside the class
@@ -0,0 +1,35 @@
+// Copyright (c) 2019 The Zcoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_LATENCYSTATS_H
+#define BITCOIN_LATENCYSTATS_H
+
+#include <algorithm>
+#include <array>
+#include <stdint.h>
+
+/** Time distribution of some operation, bucketed by powers of two microseconds */
+struct CLatencyHistogram
+{
+    static const int NUM_BUCKETS = 24;
+
+    uint64_t nCount = 0;
+    int64_t nTotalMicros = 0;
+    int64_t nMaxMicros = 0;
+    //! vBuckets[i] counts samples that took [2^i, 2^(i+1)) microseconds, the last bucket is open ended
+    std::array<uint64_t, NUM_BUCKETS> vBuckets{};
+
+    void Add(int64_t nMicros)
+    {
+        nCount++;
+        nTotalMicros += nMicros;
+        nMaxMicros = std::max(nMaxMicros, nMicros);
+        int nBucket = 0;
+        while (nBucket < NUM_BUCKETS - 1 && (nMicros >> (nBucket + 1)) > 0)
+            nBucket++;
+        vBuckets[nBucket]++;
+    }
+};
+
+#endif // BITCOIN_LATENCYSTATS_H
@@ -51,32 +51,24 @@ CQuorum::~CQuorum()
     }
 }
 
-void CQuorum::Init(const CFinalCommitment& _qc, const CBlockIndex* _pindexQuorum, const uint256& _minedBlockHash, const std::vector<CDeterministicMNCPtr>& _members)
+void CQuorum::Init(const CFinalCommitment& _qc, const CBlockIndex* _pindexQuorum, const uint256& _minedBlockHash, const CQuorumMembersCPtr& _quorumMembers)
 {
     qc = _qc;
     pindexQuorum = _pindexQuorum;
-    members = _members;
+    quorumMembers = _quorumMembers;
+    members = quorumMembers->members;
     minedBlockHash = _minedBlockHash;
 }
 
 bool CQuorum::IsMember(const uint256& proTxHash) const
 {
-    for (auto& dmn : members) {
-        if (dmn->proTxHash == proTxHash) {
-            return true;
-        }
-    }
-    return false;
+    return quorumMembers->GetMemberIndex(proTxHash) != -1;
 }
 
 bool CQuorum::IsValidMember(const uint256& proTxHash) const
 {
-    for (size_t i = 0; i < members.size(); i++) {
-        if (members[i]->proTxHash == proTxHash) {
-            return qc.validMembers[i];
-        }
-    }
-    return false;
+    int idx = quorumMembers->GetMemberIndex(proTxHash);
+    return idx != -1 && qc.validMembers[idx];
 }
 
 CBLSPublicKey CQuorum::GetPubKeyShare(size_t memberIdx) const
@@ -95,12 +87,7 @@ CBLSSecretKey CQuorum::GetSkShare() const
 
 int CQuorum::GetMemberIndex(const uint256& proTxHash) const
 {
-    for (size_t i = 0; i < members.size(); i++) {
-        if (members[i]->proTxHash == proTxHash) {
-            return (int)i;
-        }
-    }
-    return -1;
+    return quorumMembers->GetMemberIndex(proTxHash);
 }
 
 void CQuorum::WriteContributions(CEvoDB& evoDb)
@@ -233,7 +220,7 @@ bool CQuorumManager::BuildQuorumFromCommitment(const CFinalCommitment& qc, const
     assert(pindexQuorum);
     assert(qc.quorumHash == pindexQuorum->GetBlockHash());
 
-    auto members = CLLMQUtils::GetAllQuorumMembers((Consensus::LLMQType)qc.llmqType, pindexQuorum);
+    auto members = CLLMQUtils::GetQuorumMembers((Consensus::LLMQType)qc.llmqType, pindexQuorum);
 
     quorum->Init(qc, pindexQuorum, minedBlockHash, members);
 
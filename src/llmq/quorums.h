@@ -8,6 +8,7 @@
 #include "evo/evodb.h"
 #include "evo/deterministicmns.h"
 #include "llmq/quorums_commitment.h"
+#include "llmq/quorums_utils.h"
 
 #include "validationinterface.h"
 #include "consensus/params.h"
@@ -40,6 +41,8 @@ public:
     const CBlockIndex* pindexQuorum;
     uint256 minedBlockHash;
     std::vector<CDeterministicMNCPtr> members;
+    // shared with CLLMQUtils' member cache, used for the proTxHash lookups
+    CQuorumMembersCPtr quorumMembers;
 
     // These are only valid when we either participated in the DKG or fully watched it
     BLSVerificationVectorPtr quorumVvec;
@@ -55,7 +58,7 @@ private:
 public:
     CQuorum(const Consensus::LLMQParams& _params, CBLSWorker& _blsWorker) : params(_params), blsCache(_blsWorker), stopCachePopulatorThread(false) {}
     ~CQuorum();
-    void Init(const CFinalCommitment& _qc, const CBlockIndex* _pindexQuorum, const uint256& _minedBlockHash, const std::vector<CDeterministicMNCPtr>& _members);
+    void Init(const CFinalCommitment& _qc, const CBlockIndex* _pindexQuorum, const uint256& _minedBlockHash, const CQuorumMembersCPtr& _quorumMembers);
 
     bool IsMember(const uint256& proTxHash) const;
     bool IsValidMember(const uint256& proTxHash) const;
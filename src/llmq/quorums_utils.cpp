@@ -7,17 +7,69 @@
 
 #include "chainparams.h"
 #include "random.h"
+#include "unordered_lru_cache.h"
 #include "validation.h"
 
 namespace llmq
 {
 
+static CCriticalSection cs_members;
+// quorum hash -> members, one cache per LLMQ type
+static std::map<Consensus::LLMQType, unordered_lru_cache<uint256, CQuorumMembersCPtr, StaticSaltedHasher>> mapQuorumMembers;
+static std::atomic<uint64_t> nQuorumMembersCacheHits{0};
+static std::atomic<uint64_t> nQuorumMembersCacheMisses{0};
+
+CQuorumMembers::CQuorumMembers(std::vector<CDeterministicMNCPtr> _members) :
+    members(std::move(_members))
+{
+    memberIndexes.reserve(members.size());
+    for (size_t i = 0; i < members.size(); i++) {
+        memberIndexes.emplace(members[i]->proTxHash, i);
+    }
+}
+
+int CQuorumMembers::GetMemberIndex(const uint256& proTxHash) const
+{
+    auto it = memberIndexes.find(proTxHash);
+    return it != memberIndexes.end() ? (int)it->second : -1;
+}
+
 std::vector<CDeterministicMNCPtr> CLLMQUtils::GetAllQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum)
+{
+    return GetQuorumMembers(llmqType, pindexQuorum)->members;
+}
+
+CQuorumMembersCPtr CLLMQUtils::GetQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum)
 {
     auto& params = Params().GetConsensus().llmqs.at(llmqType);
+    CQuorumMembersCPtr quorumMembers;
+    {
+        LOCK(cs_members);
+        auto it = mapQuorumMembers.find(llmqType);
+        if (it == mapQuorumMembers.end()) {
+            // active quorums plus the ones currently going through DKG or being looked up by older sig shares
+            it = mapQuorumMembers.emplace(llmqType, unordered_lru_cache<uint256, CQuorumMembersCPtr, StaticSaltedHasher>(params.signingActiveQuorumCount * 2 + 2)).first;
+        }
+        if (it->second.get(pindexQuorum->GetBlockHash(), quorumMembers)) {
+            nQuorumMembersCacheHits++;
+            return quorumMembers;
+        }
+    }
+    nQuorumMembersCacheMisses++;
+
     auto allMns = deterministicMNManager->GetListForBlock(pindexQuorum);
     auto modifier = ::SerializeHash(std::make_pair((uint8_t) llmqType, pindexQuorum->GetBlockHash()));
-    return allMns.CalculateQuorum(params.size, modifier);
+    quorumMembers = std::make_shared<const CQuorumMembers>(allMns.CalculateQuorum(params.size, modifier));
+
+    LOCK(cs_members);
+    mapQuorumMembers.at(llmqType).insert(pindexQuorum->GetBlockHash(), quorumMembers);
+    return quorumMembers;
+}
+
+void CLLMQUtils::GetQuorumMembersCacheStats(uint64_t& nHits, uint64_t& nMisses)
+{
+    nHits = nQuorumMembersCacheHits;
+    nMisses = nQuorumMembersCacheMisses;
 }
 
 uint256 CLLMQUtils::BuildCommitmentHash(uint8_t llmqType, const uint256& blockHash, const std::vector<bool>& validMembers, const CBLSPublicKey& pubKey, const uint256& vvecHash)
@@ -45,7 +97,8 @@ std::set<uint256> CLLMQUtils::GetQuorumConnections(Consensus::LLMQType llmqType,
 {
     auto& params = Params().GetConsensus().llmqs.at(llmqType);
 
-    auto mns = GetAllQuorumMembers(llmqType, pindexQuorum);
+    auto quorumMembers = GetQuorumMembers(llmqType, pindexQuorum);
+    auto& mns = quorumMembers->members;
     std::set<uint256> result;
     for (size_t i = 0; i < mns.size(); i++) {
         auto& dmn = mns[i];
@@ -9,17 +9,40 @@
 #include "net.h"
 
 #include "evo/deterministicmns.h"
+#include "saltedhasher.h"
 
+#include <atomic>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace llmq
 {
 
+/**
+ * Members of a quorum in quorum order plus a proTxHash -> member index lookup. Computed once per quorum and shared
+ * read-only, as calculating them hashes and sorts the whole indexnode list.
+ */
+struct CQuorumMembers
+{
+    std::vector<CDeterministicMNCPtr> members;
+    std::unordered_map<uint256, size_t, StaticSaltedHasher> memberIndexes;
+
+    explicit CQuorumMembers(std::vector<CDeterministicMNCPtr> _members);
+
+    // returns -1 if proTxHash is not a member
+    int GetMemberIndex(const uint256& proTxHash) const;
+};
+typedef std::shared_ptr<const CQuorumMembers> CQuorumMembersCPtr;
+
 class CLLMQUtils
 {
 public:
     // includes members which failed DKG
     static std::vector<CDeterministicMNCPtr> GetAllQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum);
+    // same as above, but without copying the member list out of the cache
+    static CQuorumMembersCPtr GetQuorumMembers(Consensus::LLMQType llmqType, const CBlockIndex* pindexQuorum);
+    static void GetQuorumMembersCacheStats(uint64_t& nHits, uint64_t& nMisses);
 
     static uint256 BuildCommitmentHash(uint8_t llmqType, const uint256& blockHash, const std::vector<bool>& validMembers, const CBLSPublicKey& pubKey, const uint256& vvecHash);
     static uint256 BuildSignHash(Consensus::LLMQType llmqType, const uint256& quorumHash, const uint256& id, const uint256& msgHash);
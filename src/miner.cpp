@@ -35,6 +35,7 @@
 #include "sigma.h"
 #include "sigma/remint.h"
 #include <algorithm>
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 #include <boost/tuple/tuple.hpp>
 #include <queue>
@@ -381,6 +382,17 @@ bool BlockAssembler::TestPackageTransactions(const CTxMemPool::setEntries& packa
     return true;
 }
 
+// Value spent by a sigma spend or remint, using the spends parsed when the transaction entered the mempool
+static CAmount GetSigmaSpendAmount(CTxMemPool::txiter iter)
+{
+    const CTransaction &tx = iter->GetTx();
+    if (tx.IsZerocoinRemint())
+        return sigma::CoinRemintToV3::GetAmount(tx);
+
+    const sigma::CSigmaSpendSummary *summary = iter->GetSigmaSpendSummary();
+    return summary ? summary->nAmount : sigma::GetSpendAmount(tx);
+}
+
 bool BlockAssembler::TestForBlock(CTxMemPool::txiter iter)
 {
     if (nBlockWeight + iter->GetTxWeight() >= nBlockMaxWeight) {
@@ -439,7 +451,7 @@ bool BlockAssembler::TestForBlock(CTxMemPool::txiter iter)
     // Check transaction against sigma limits
     if (tx.IsSigmaSpend() || tx.IsZerocoinRemint()) {
         // Sigma spend and zerocoin->sigma remint are subject to the same limits
-        CAmount spendAmount = tx.IsSigmaSpend() ? sigma::GetSpendAmount(tx) : sigma::CoinRemintToV3::GetAmount(tx);
+        CAmount spendAmount = GetSigmaSpendAmount(iter);
         auto &params = chainparams.GetConsensus();
 
         if (tx.vin.size() > params.nMaxSigmaInputPerTransaction || spendAmount > params.nMaxValueSigmaSpendPerTransaction)
@@ -460,7 +472,7 @@ void BlockAssembler::AddToBlock(CTxMemPool::txiter iter)
     const CTransaction &tx = iter->GetTx();
     if (tx.IsSigmaSpend() || tx.IsZerocoinRemint()) {
         // Update sigma stats
-        CAmount spendAmount = tx.IsSigmaSpend() ? sigma::GetSpendAmount(tx) : sigma::CoinRemintToV3::GetAmount(tx);
+        CAmount spendAmount = GetSigmaSpendAmount(iter);
 
         if ((nSigmaSpendAmount += spendAmount) > chainparams.GetConsensus().nMaxValueSigmaSpendPerBlock)
             return;
@@ -1174,6 +1186,157 @@ void GenerateBitcoins(bool fGenerate, int nThreads, const CChainParams& chainpar
         minerThreads->create_thread(boost::bind(&IndexMiner, boost::cref(chainparams)));
 }
 
+CBlockTemplateManager blockTemplateManager;
+
+CBlockTemplateManager::CBlockTemplateManager() :
+    nLastRequest(0), fLastSupportsSegwit(false), fTipChanged(false), fMempoolChanged(false), fInterrupt(false),
+    nRefreshMillis(DEFAULT_BLOCK_TEMPLATE_REFRESH)
+{
+}
+
+CBlockTemplateManager::~CBlockTemplateManager()
+{
+    Stop();
+}
+
+void CBlockTemplateManager::Start()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fInterrupt = false;
+        nRefreshMillis = std::max((int64_t)0, GetArg("-blocktemplaterefresh", DEFAULT_BLOCK_TEMPLATE_REFRESH));
+    }
+    GetMainSignals().UpdatedBlockTip.connect(boost::bind(&CBlockTemplateManager::NotifyTipChanged, this));
+    mempool.NotifyEntryAdded.connect(boost::bind(&CBlockTemplateManager::NotifyMempoolChanged, this));
+    mempool.NotifyEntryRemoved.connect(boost::bind(&CBlockTemplateManager::NotifyMempoolChanged, this));
+    threadBuild = std::thread(&TraceThread<std::function<void()> >, "tmplbuild", std::function<void()>(std::bind(&CBlockTemplateManager::ThreadBuildTemplates, this)));
+}
+
+void CBlockTemplateManager::Stop()
+{
+    if (!threadBuild.joinable())
+        return;
+
+    GetMainSignals().UpdatedBlockTip.disconnect(boost::bind(&CBlockTemplateManager::NotifyTipChanged, this));
+    mempool.NotifyEntryAdded.disconnect(boost::bind(&CBlockTemplateManager::NotifyMempoolChanged, this));
+    mempool.NotifyEntryRemoved.disconnect(boost::bind(&CBlockTemplateManager::NotifyMempoolChanged, this));
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fInterrupt = true;
+    }
+    cond.notify_all();
+    threadBuild.join();
+
+    std::lock_guard<std::mutex> lock(cs);
+    current = Template();
+}
+
+bool CBlockTemplateManager::Get(const CBlockIndex* pindexTip, bool fSupportsSegwit, Template& templateRet)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    int64_t nNow = GetTime();
+    if (nNow - nLastRequest > BLOCK_TEMPLATE_IDLE_TIMEOUT) {
+        // The thread went idle, have it build for the current tip again
+        fTipChanged = true;
+        cond.notify_all();
+    }
+    nLastRequest = nNow;
+    if (fLastSupportsSegwit != fSupportsSegwit) {
+        // Build what the caller asks for from now on
+        fLastSupportsSegwit = fSupportsSegwit;
+        fMempoolChanged = true;
+        cond.notify_all();
+    }
+    if (!current.pblocktemplate || current.pindexPrev != pindexTip || current.fSupportsSegwit != fSupportsSegwit)
+        return false;
+    templateRet = current;
+    return true;
+}
+
+void CBlockTemplateManager::Set(const Template& newTemplate)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    current = newTemplate;
+}
+
+bool CBlockTemplateManager::Build(bool fSupportsSegwit, Template& templateRet)
+{
+    CScript scriptDummy = CScript() << OP_TRUE;
+
+    LOCK2(cs_main, mempool.cs);
+    templateRet.pindexPrev = chainActive.Tip();
+    templateRet.nTransactionsUpdated = mempool.GetTransactionsUpdated();
+    templateRet.fSupportsSegwit = fSupportsSegwit;
+    templateRet.nTimeCreated = GetTimeMillis();
+    templateRet.pblocktemplate = BlockAssembler(Params()).CreateNewBlock(scriptDummy, fSupportsSegwit);
+    return templateRet.pblocktemplate != nullptr;
+}
+
+void CBlockTemplateManager::NotifyTipChanged()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fTipChanged = true;
+    }
+    cond.notify_all();
+}
+
+void CBlockTemplateManager::NotifyMempoolChanged()
+{
+    // Called with mempool.cs held, rebuilding is left to the thread
+    std::lock_guard<std::mutex> lock(cs);
+    fMempoolChanged = true;
+}
+
+void CBlockTemplateManager::ThreadBuildTemplates()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    while (!fInterrupt) {
+        // Mempool changes are picked up on the refresh interval, tip changes right away
+        int64_t nWait = nRefreshMillis;
+        if (current.pblocktemplate && fMempoolChanged)
+            nWait = std::max((int64_t)0, current.nTimeCreated + nRefreshMillis - GetTimeMillis());
+        cond.wait_for(lock, std::chrono::milliseconds(std::max(nWait, (int64_t)10)), [this] { return fInterrupt || fTipChanged; });
+        if (fInterrupt)
+            break;
+
+        if (GetTime() - nLastRequest > BLOCK_TEMPLATE_IDLE_TIMEOUT) {
+            // Nobody asked for a template in a while, don't keep a stale one around either. The change
+            // flags are dropped too, a pending tip change would otherwise end every wait right away.
+            // Get() wakes the thread up again.
+            current = Template();
+            fTipChanged = false;
+            fMempoolChanged = false;
+            continue;
+        }
+        bool fStale = !current.pblocktemplate || fTipChanged ||
+            (fMempoolChanged && GetTimeMillis() - current.nTimeCreated >= nRefreshMillis);
+        if (!fStale)
+            continue;
+
+        fTipChanged = false;
+        fMempoolChanged = false;
+        bool fSupportsSegwit = fLastSupportsSegwit;
+        lock.unlock();
+
+        Template newTemplate;
+        int64_t nTimeStart = GetTimeMicros();
+        bool fBuilt = false;
+        try {
+            if (!IsInitialBlockDownload())
+                fBuilt = Build(fSupportsSegwit, newTemplate);
+        } catch (const std::runtime_error& e) {
+            LogPrintf("%s: failed to build block template: %s\n", __func__, e.what());
+        }
+        if (fBuilt)
+            LogPrint("bench", "Block template for height %d rebuilt in %.2fms\n", newTemplate.pindexPrev->nHeight + 1, 0.001 * (GetTimeMicros() - nTimeStart));
+
+        lock.lock();
+        if (fBuilt)
+            current = newTemplate;
+    }
+}
+
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
 {
     // Update nExtraNonce
@@ -10,7 +10,10 @@
 #include "txmempool.h"
 
 #include <stdint.h>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include "boost/multi_index_container.hpp"
 #include "boost/multi_index/ordered_index.hpp"
 
@@ -27,6 +30,11 @@ static const int DEFAULT_GENERATE_THREADS = 1;
 
 static const bool DEFAULT_PRINTPRIORITY = false;
 
+/** Default for -blocktemplaterefresh, minimum milliseconds between template rebuilds for mempool changes */
+static const int64_t DEFAULT_BLOCK_TEMPLATE_REFRESH = 1000;
+/** Seconds without a getblocktemplate call after which the template manager stops rebuilding */
+static const int64_t BLOCK_TEMPLATE_IDLE_TIMEOUT = 10 * 60;
+
 struct CBlockTemplate
 {
     CBlock block;
@@ -223,6 +231,57 @@ private:
     void FillBlackListForBlockTemplate();
 };
 
+/**
+ * Keeps a getblocktemplate template for the current tip built in the background, so a pool polling
+ * getblocktemplate gets an already built template instead of waiting for CreateNewBlock. The template
+ * is rebuilt as soon as the tip changes, and after mempool changes once it is older than
+ * -blocktemplaterefresh. Nothing is built until getblocktemplate is used, and rebuilding stops after
+ * BLOCK_TEMPLATE_IDLE_TIMEOUT seconds without calls.
+ */
+class CBlockTemplateManager
+{
+public:
+    struct Template {
+        std::shared_ptr<const CBlockTemplate> pblocktemplate;
+        const CBlockIndex* pindexPrev = nullptr;
+        //! mempool.GetTransactionsUpdated() before the template was built
+        unsigned int nTransactionsUpdated = 0;
+        bool fSupportsSegwit = false;
+        int64_t nTimeCreated = 0;
+    };
+
+    CBlockTemplateManager();
+    ~CBlockTemplateManager();
+
+    void Start();
+    void Stop();
+
+    /** Returns the template if there is one for pindexTip built with fSupportsSegwit. Also marks the manager as in use. */
+    bool Get(const CBlockIndex* pindexTip, bool fSupportsSegwit, Template& templateRet);
+    /** Publish a template built by the caller, e.g. because the manager hadn't caught up with the tip yet */
+    void Set(const Template& newTemplate);
+    /** Build a template the way the manager does, for the current tip */
+    static bool Build(bool fSupportsSegwit, Template& templateRet);
+
+private:
+    void NotifyTipChanged();
+    void NotifyMempoolChanged();
+    void ThreadBuildTemplates();
+
+    std::mutex cs;
+    std::condition_variable cond;
+    Template current;
+    int64_t nLastRequest;
+    bool fLastSupportsSegwit;
+    bool fTipChanged;
+    bool fMempoolChanged;
+    bool fInterrupt;
+    int64_t nRefreshMillis;
+    std::thread threadBuild;
+};
+
+extern CBlockTemplateManager blockTemplateManager;
+
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
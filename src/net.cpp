@@ -37,6 +37,10 @@
 #include <fcntl.h>
 #endif
 
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -414,7 +418,7 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCo
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed))
     {
-        if (!IsSelectableSocket(hSocket)) {
+        if (socketEventsMode == SOCKETEVENTS_SELECT && !IsSelectableSocket(hSocket)) {
             LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
             return NULL;
@@ -929,6 +933,7 @@ size_t CConnman::SocketSendData(CNode *pnode) const
                 it++;
             } else {
                 // could not send full message; stop sending more
+                pnode->fCanSendData = false;
                 break;
             }
         } else {
@@ -942,6 +947,7 @@ size_t CConnman::SocketSendData(CNode *pnode) const
                 }
             }
             // couldn't send anything at all
+            pnode->fCanSendData = false;
             break;
         }
     }
@@ -1225,7 +1231,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    if (socketEventsMode == SOCKETEVENTS_SELECT && !IsSelectableSocket(hSocket))
     {
         LogPrintf("connection from %s dropped: non-selectable socket\n", addr.ToString());
         CloseSocket(hSocket);
@@ -1271,6 +1277,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+        RegisterNodeEvents(pnode);
         // Dandelion: new inbound connection
         CNode::vDandelionInbound.push_back(pnode);
         CNode* pto = CNode::SelectFromDandelionDestinations();
@@ -1366,6 +1373,428 @@ void CNode::CloseDandelionConnections(const CNode* const pnode)
               CNode::GetDandelionRoutingDataDebugString());
 }
 
+void CConnman::InactivityCheck()
+{
+    std::vector<CNode*> vNodesCopy;
+    {
+        LOCK(cs_vNodes);
+        vNodesCopy = vNodes;
+        BOOST_FOREACH(CNode* pnode, vNodesCopy)
+            pnode->AddRef();
+    }
+    int64_t nTime = GetSystemTimeInSeconds();
+    BOOST_FOREACH(CNode* pnode, vNodesCopy)
+    {
+        if (nTime - pnode->nTimeConnected > 60)
+        {
+            if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
+            {
+                LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
+                pnode->fDisconnect = true;
+            }
+            else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
+            {
+                LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
+                pnode->fDisconnect = true;
+            }
+            else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
+            {
+                LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
+                pnode->fDisconnect = true;
+            }
+            else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
+            {
+                LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
+                pnode->fDisconnect = true;
+            }
+            else if (!pnode->fSuccessfullyConnected)
+            {
+                LogPrintf("version handshake timeout from %d\n", pnode->id);
+                pnode->fDisconnect = true;
+            }
+        }
+    }
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodesCopy)
+            pnode->Release();
+    }
+}
+
+bool CConnman::SocketRecvData(CNode *pnode)
+{
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    int nBytes = 0;
+    {
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket == INVALID_SOCKET)
+            return false;
+        nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    }
+    if (nBytes > 0)
+    {
+        bool notify = false;
+        if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
+            pnode->CloseSocketDisconnect();
+        RecordBytesRecv(nBytes);
+        if (notify) {
+            size_t nSizeAdded = 0;
+            auto it(pnode->vRecvMsg.begin());
+            for (; it != pnode->vRecvMsg.end(); ++it) {
+                if (!it->complete())
+                    break;
+                nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
+            }
+            {
+                LOCK(pnode->cs_vProcessMsg);
+                pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
+                pnode->nProcessQueueSize += nSizeAdded;
+                pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
+            }
+            WakeMessageHandler();
+        }
+        return true;
+    }
+    else if (nBytes == 0)
+    {
+        // socket closed gracefully
+        if (!pnode->fDisconnect)
+            LogPrint("net", "socket closed\n");
+        pnode->CloseSocketDisconnect();
+    }
+    else if (nBytes < 0)
+    {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+        {
+            if (!pnode->fDisconnect)
+                LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
+            pnode->CloseSocketDisconnect();
+        }
+    }
+    return false;
+}
+
+void CConnman::SocketEventsSelect(std::vector<const ListenSocket*>& vListenReady, std::vector<CNode*>& vRecvNodes, std::vector<CNode*>& vSendNodes)
+{
+    //
+    // Find which sockets have data to receive
+    //
+    struct timeval timeout;
+    timeout.tv_sec  = 0;
+    timeout.tv_usec = 50000; // frequency to poll pnode->vSend
+
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    bool have_fds = false;
+
+    BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
+        FD_SET(hListenSocket.socket, &fdsetRecv);
+        hSocketMax = std::max(hSocketMax, hListenSocket.socket);
+        have_fds = true;
+    }
+
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodes)
+        {
+            // Implement the following logic:
+            // * If there is data to send, select() for sending data. As this only
+            //   happens when optimistic write failed, we choose to first drain the
+            //   write buffer in this case before receiving more. This avoids
+            //   needlessly queueing received data, if the remote peer is not themselves
+            //   receiving data. This means properly utilizing TCP flow control signalling.
+            // * Otherwise, if there is space left in the receive buffer, select() for
+            //   receiving data.
+            // * Hand off all complete messages to the processor, to be handled without
+            //   blocking here.
+
+            bool select_recv = !pnode->fPauseRecv;
+            bool select_send;
+            {
+                LOCK(pnode->cs_vSend);
+                select_send = !pnode->vSendMsg.empty();
+            }
+
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+
+            FD_SET(pnode->hSocket, &fdsetError);
+            hSocketMax = std::max(hSocketMax, pnode->hSocket);
+            have_fds = true;
+
+            if (select_send) {
+                FD_SET(pnode->hSocket, &fdsetSend);
+                continue;
+            }
+            if (select_recv) {
+                FD_SET(pnode->hSocket, &fdsetRecv);
+            }
+        }
+    }
+
+    int nSelect = select(have_fds ? hSocketMax + 1 : 0,
+                         &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    if (interruptNet)
+        return;
+
+    if (nSelect == SOCKET_ERROR)
+    {
+        if (have_fds)
+        {
+            int nErr = WSAGetLastError();
+            LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+            for (unsigned int i = 0; i <= hSocketMax; i++)
+                FD_SET(i, &fdsetRecv);
+        }
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
+            return;
+    }
+
+    BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
+    {
+        if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            vListenReady.push_back(&hListenSocket);
+    }
+
+    LOCK(cs_vNodes);
+    BOOST_FOREACH(CNode* pnode, vNodes)
+    {
+        bool recvSet = false;
+        bool sendSet = false;
+        {
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+            recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError);
+            sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
+        }
+        if (recvSet) {
+            pnode->AddRef();
+            vRecvNodes.push_back(pnode);
+        }
+        if (sendSet) {
+            pnode->AddRef();
+            vSendNodes.push_back(pnode);
+        }
+    }
+}
+
+#ifdef HAVE_EPOLL
+// Tags for the epoll data of sockets that don't belong to a node, node events carry the NodeId
+static const uint64_t EPOLL_TAG_WAKEUP = 1ULL << 63;
+static const uint64_t EPOLL_TAG_LISTEN = 1ULL << 62;
+
+void CConnman::SocketEventsEpoll(std::vector<const ListenSocket*>& vListenReady, std::vector<CNode*>& vRecvNodes, std::vector<CNode*>& vSendNodes)
+{
+    // Don't sleep while some sockets still have data buffered from an earlier edge
+    bool fPendingWork = false;
+    for (const auto& p : mapReceivableNodes) {
+        if (!p.second->fPauseRecv) {
+            fPendingWork = true;
+            break;
+        }
+    }
+    if (!fPendingWork) {
+        LOCK(cs_mapSendableNodes);
+        fPendingWork = !mapSendableNodes.empty();
+    }
+
+    const int nMaxEvents = 1024;
+    struct epoll_event events[nMaxEvents];
+    int nEvents = epoll_wait(epollFd, events, nMaxEvents, fPendingWork ? 0 : 50);
+    if (interruptNet)
+        return;
+    if (nEvents < 0) {
+        if (errno != EINTR) {
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(errno));
+            if (!interruptNet.sleep_for(std::chrono::milliseconds(50)))
+                return;
+        }
+        nEvents = 0;
+    }
+
+    LOCK(cs_vNodes);
+    for (int i = 0; i < nEvents; i++) {
+        const struct epoll_event& e = events[i];
+        if (e.data.u64 == EPOLL_TAG_WAKEUP) {
+            char buf[128];
+            while (read(wakeupPipe[0], buf, sizeof(buf)) > 0) {}
+            continue;
+        }
+        if (e.data.u64 & EPOLL_TAG_LISTEN) {
+            size_t nIndex = e.data.u64 & ~EPOLL_TAG_LISTEN;
+            if (nIndex < vhListenSocket.size())
+                vListenReady.push_back(&vhListenSocket[nIndex]);
+            continue;
+        }
+
+        auto it = mapEventNodes.find((NodeId)e.data.u64);
+        if (it == mapEventNodes.end())
+            continue;
+        CNode* pnode = it->second;
+        if (e.events & (EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP)) {
+            pnode->fHasRecvData = true;
+            mapReceivableNodes.emplace(pnode->id, pnode);
+        }
+        if (e.events & EPOLLOUT) {
+            LOCK(pnode->cs_vSend);
+            pnode->fCanSendData = true;
+            MarkSendable(pnode);
+        }
+    }
+
+    for (const auto& p : mapReceivableNodes) {
+        if (p.second->fPauseRecv)
+            continue;
+        p.second->AddRef();
+        vRecvNodes.push_back(p.second);
+    }
+    {
+        LOCK(cs_mapSendableNodes);
+        for (const auto& p : mapSendableNodes) {
+            p.second->AddRef();
+            vSendNodes.push_back(p.second);
+        }
+    }
+}
+#endif
+
+void CConnman::SocketEvents(std::vector<const ListenSocket*>& vListenReady, std::vector<CNode*>& vRecvNodes, std::vector<CNode*>& vSendNodes)
+{
+#ifdef HAVE_EPOLL
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        SocketEventsEpoll(vListenReady, vRecvNodes, vSendNodes);
+        return;
+    }
+#endif
+    SocketEventsSelect(vListenReady, vRecvNodes, vSendNodes);
+}
+
+bool CConnman::InitSocketEvents(std::string& strError)
+{
+    if (socketEventsMode != SOCKETEVENTS_EPOLL)
+        return true;
+#ifdef HAVE_EPOLL
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd == -1) {
+        strError = strprintf("epoll_create1 failed: %s", NetworkErrorString(errno));
+        return false;
+    }
+
+    if (pipe(wakeupPipe) != 0) {
+        strError = strprintf("failed to create wakeup pipe: %s", NetworkErrorString(errno));
+        return false;
+    }
+    for (int fd : wakeupPipe) {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+
+    struct epoll_event e;
+    e.events = EPOLLIN;
+    e.data.u64 = EPOLL_TAG_WAKEUP;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeupPipe[0], &e) != 0) {
+        strError = strprintf("failed to add wakeup pipe to epoll: %s", NetworkErrorString(errno));
+        return false;
+    }
+
+    // Listen sockets are level triggered, AcceptConnection accepts one connection per event
+    for (size_t i = 0; i < vhListenSocket.size(); i++) {
+        e.events = EPOLLIN;
+        e.data.u64 = EPOLL_TAG_LISTEN | i;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, vhListenSocket[i].socket, &e) != 0) {
+            strError = strprintf("failed to add listen socket to epoll: %s", NetworkErrorString(errno));
+            return false;
+        }
+    }
+    return true;
+#else
+    strError = "epoll is not supported on this platform";
+    return false;
+#endif
+}
+
+void CConnman::ShutdownSocketEvents()
+{
+#ifndef WIN32
+    if (epollFd != -1)
+        close(epollFd);
+    epollFd = -1;
+    for (int& fd : wakeupPipe) {
+        if (fd != -1)
+            close(fd);
+        fd = -1;
+    }
+#endif
+}
+
+void CConnman::RegisterNodeEvents(CNode* pnode)
+{
+    AssertLockHeld(cs_vNodes);
+#ifdef HAVE_EPOLL
+    if (socketEventsMode != SOCKETEVENTS_EPOLL)
+        return;
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET)
+        return;
+    struct epoll_event e;
+    e.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    e.data.u64 = (uint64_t)pnode->id;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, pnode->hSocket, &e) != 0) {
+        LogPrintf("failed to add socket of peer=%d to epoll: %s\n", pnode->id, NetworkErrorString(errno));
+        pnode->fDisconnect = true;
+        return;
+    }
+    mapEventNodes.emplace(pnode->id, pnode);
+#endif
+}
+
+void CConnman::UnregisterNodeEvents(CNode* pnode)
+{
+    AssertLockHeld(cs_vNodes);
+    if (socketEventsMode != SOCKETEVENTS_EPOLL)
+        return;
+    // The socket is closed already, which removed it from the epoll set
+    mapEventNodes.erase(pnode->id);
+    mapReceivableNodes.erase(pnode->id);
+    LOCK(pnode->cs_vSend);
+    pnode->fCanSendData = false;
+    LOCK(cs_mapSendableNodes);
+    mapSendableNodes.erase(pnode->id);
+}
+
+bool CConnman::MarkSendable(CNode* pnode)
+{
+    AssertLockHeld(pnode->cs_vSend);
+    if (socketEventsMode != SOCKETEVENTS_EPOLL || !pnode->fCanSendData || pnode->vSendMsg.empty())
+        return false;
+    LOCK(cs_mapSendableNodes);
+    return mapSendableNodes.emplace(pnode->id, pnode).second;
+}
+
+void CConnman::WakeSocketHandler()
+{
+#ifndef WIN32
+    if (wakeupPipe[1] == -1)
+        return;
+    char buf = 0;
+    if (write(wakeupPipe[1], &buf, 1) != 1) {
+        // The pipe is full, so the socket handler is going to wake up anyway
+    }
+#endif
+}
+
 void CConnman::ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
@@ -1391,6 +1820,7 @@ void CConnman::ThreadSocketHandler()
 
                     // close socket and cleanup
                     pnode->CloseSocketDisconnect();
+                    UnregisterNodeEvents(pnode);
 
                     // hold in disconnected pool until all refs are released
                     pnode->Release();
@@ -1435,236 +1865,65 @@ void CConnman::ThreadSocketHandler()
                 clientInterface->NotifyNumConnectionsChanged(nPrevNodeCount);
         }
 
-        //
-        // Find which sockets have data to receive
-        //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
-
-        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = std::max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
-
-        {
-            LOCK(cs_vNodes);
-            BOOST_FOREACH(CNode* pnode, vNodes)
-            {
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is space left in the receive buffer, select() for
-                //   receiving data.
-                // * Hand off all complete messages to the processor, to be handled without
-                //   blocking here.
-
-                bool select_recv = !pnode->fPauseRecv;
-                bool select_send;
-                {
-                    LOCK(pnode->cs_vSend);
-                    select_send = !pnode->vSendMsg.empty();
-                }
-
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = std::max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
-                if (select_send) {
-                    FD_SET(pnode->hSocket, &fdsetSend);
-                    continue;
-                }
-                if (select_recv) {
-                    FD_SET(pnode->hSocket, &fdsetRecv);
-                }
-            }
-        }
-
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
-        if (interruptNet)
-            return;
-
-        if (nSelect == SOCKET_ERROR)
-        {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
-                return;
-        }
+        std::vector<const ListenSocket*> vListenReady;
+        std::vector<CNode*> vRecvNodes, vSendNodes;
+        SocketEvents(vListenReady, vRecvNodes, vSendNodes);
 
         //
         // Accept new connections
         //
-        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
-        {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
-            {
-                AcceptConnection(hListenSocket);
-            }
+        if (!interruptNet) {
+            BOOST_FOREACH(const ListenSocket* pListenSocket, vListenReady)
+                AcceptConnection(*pListenSocket);
         }
 
         //
-        // Service each socket
+        // Service the sockets that are ready
         //
-        std::vector<CNode*> vNodesCopy;
+        BOOST_FOREACH(CNode* pnode, vRecvNodes)
         {
-            LOCK(cs_vNodes);
-            vNodesCopy = vNodes;
-            BOOST_FOREACH(CNode* pnode, vNodesCopy)
-                pnode->AddRef();
+            if (interruptNet)
+                break;
+            if (!SocketRecvData(pnode) && socketEventsMode == SOCKETEVENTS_EPOLL) {
+                // Drained (or closed), wait for the next edge
+                pnode->fHasRecvData = false;
+                mapReceivableNodes.erase(pnode->id);
+            }
         }
-        BOOST_FOREACH(CNode* pnode, vNodesCopy)
+        BOOST_FOREACH(CNode* pnode, vSendNodes)
         {
             if (interruptNet)
-                return;
-
-            //
-            // Receive
-            //
-            bool recvSet = false;
-            bool sendSet = false;
-            bool errorSet = false;
-            {
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-                recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
-                sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
-                errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
-            }
-            if (recvSet || errorSet)
-            {
-                {
-                    {
-                        // typical socket buffer is 8K-64K
-                        char pchBuf[0x10000];
-                        int nBytes = 0;
-                        {
-                            LOCK(pnode->cs_hSocket);
-                            if (pnode->hSocket == INVALID_SOCKET)
-                                continue;
-                            nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-                        }
-                        if (nBytes > 0)
-                        {
-                            bool notify = false;
-                            if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
-                                pnode->CloseSocketDisconnect();
-                            RecordBytesRecv(nBytes);
-                            if (notify) {
-                                size_t nSizeAdded = 0;
-                                auto it(pnode->vRecvMsg.begin());
-                                for (; it != pnode->vRecvMsg.end(); ++it) {
-                                    if (!it->complete())
-                                        break;
-                                    nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
-                                }
-                                {
-                                    LOCK(pnode->cs_vProcessMsg);
-                                    pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
-                                    pnode->nProcessQueueSize += nSizeAdded;
-                                    pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
-                                }
-                                WakeMessageHandler();
-                            }
-                        }
-                        else if (nBytes == 0)
-                        {
-                            // socket closed gracefully
-                            if (!pnode->fDisconnect)
-                                LogPrint("net", "socket closed\n");
-                            pnode->CloseSocketDisconnect();
-                        }
-                        else if (nBytes < 0)
-                        {
-                            // error
-                            int nErr = WSAGetLastError();
-                            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
-                            {
-                                if (!pnode->fDisconnect)
-                                    LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
-                                pnode->CloseSocketDisconnect();
-                            }
-                        }
-                    }
-                }
+                break;
+            LOCK(pnode->cs_vSend);
+            size_t nBytes = SocketSendData(pnode);
+            if (nBytes) {
+                RecordBytesSent(nBytes);
             }
-
-            //
-            // Send
-            //
-            if (sendSet)
-            {
-                LOCK(pnode->cs_vSend);
-                size_t nBytes = SocketSendData(pnode);
-                if (nBytes) {
-                    RecordBytesSent(nBytes);
-                }
-            }
-
-            //
-            // Inactivity checking
-            //
-            int64_t nTime = GetSystemTimeInSeconds();
-            if (nTime - pnode->nTimeConnected > 60)
-            {
-                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
-                {
-                    LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
-                {
-                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
-                {
-                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
-                    pnode->fDisconnect = true;
-                }
-                else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
-                {
-                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
-                    pnode->fDisconnect = true;
-                }
-                else if (!pnode->fSuccessfullyConnected)
-                {
-                    LogPrintf("version handshake timeout from %d\n", pnode->id);
-                    pnode->fDisconnect = true;
-                }
+            if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+                // Either everything was sent or the socket is full and EPOLLOUT queues it again
+                LOCK(cs_mapSendableNodes);
+                mapSendableNodes.erase(pnode->id);
             }
         }
+
         {
             LOCK(cs_vNodes);
-            BOOST_FOREACH(CNode* pnode, vNodesCopy)
+            BOOST_FOREACH(CNode* pnode, vRecvNodes)
+                pnode->Release();
+            BOOST_FOREACH(CNode* pnode, vSendNodes)
                 pnode->Release();
         }
+        if (interruptNet)
+            return;
+
+        //
+        // Inactivity checking
+        //
+        int64_t nTime = GetSystemTimeInSeconds();
+        if (nTime != nLastInactivityCheck) {
+            nLastInactivityCheck = nTime;
+            InactivityCheck();
+        }
     }
 }
 
@@ -1674,7 +1933,7 @@ void CConnman::WakeMessageHandler()
         std::lock_guard<std::mutex> lock(mutexMsgProc);
         fMsgProcWake = true;
     }
-    condMsgProc.notify_one();
+    condMsgProc.notify_all();
 }
 
 
@@ -2332,6 +2591,7 @@ bool CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+        RegisterNodeEvents(pnode);
     }
 
     return true;
@@ -2341,7 +2601,7 @@ bool CConnman::OpenMasternodeConnection(const CAddress &addrConnect) {
     return OpenNetworkConnection(addrConnect, false, NULL, NULL, false, false, false, true);
 }
 
-void CConnman::ThreadMessageHandler()
+void CConnman::ThreadMessageHandler(int nWorker)
 {
     while (!flagInterruptMsgProc)
     {
@@ -2356,22 +2616,48 @@ void CConnman::ThreadMessageHandler()
 
         bool fMoreWork = false;
 
-        BOOST_FOREACH(CNode* pnode, vNodesCopy)
+        // Workers start at different peers so they don't all line up behind the same one
+        size_t nNodes = vNodesCopy.size();
+        size_t nStart = nNodes * nWorker / nMsgHandlerThreads;
+        for (size_t i = 0; i < nNodes; i++)
         {
+            CNode* pnode = vNodesCopy[(nStart + i) % nNodes];
             if (pnode->fDisconnect)
                 continue;
 
+            // Only one worker handles a peer at a time, which keeps its messages in order. The wakeup for
+            // messages that arrive meanwhile may be the one this worker consumes, so the owner wakes the
+            // workers again when it's done. Checking busy again covers an owner that finished before
+            // the flag was set.
+            if (pnode->fMsgProcBusy.exchange(true)) {
+                pnode->fMsgProcSkipped = true;
+                if (!pnode->fMsgProcBusy)
+                    fMoreWork = true;
+                continue;
+            }
+
             // Receive messages
+            bool fProcessed = !pnode->vRecvGetData.empty();
+            {
+                LOCK(pnode->cs_vProcessMsg);
+                fProcessed |= !pnode->vProcessMsg.empty();
+            }
             bool fMoreNodeWork = GetNodeSignals().ProcessMessages(pnode, *this, flagInterruptMsgProc);
             fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
-            if (flagInterruptMsgProc)
+            if (flagInterruptMsgProc) {
+                pnode->fMsgProcBusy = false;
                 return;
+            }
 
-            // Send messages
-            {
+            // Send messages. The first worker runs them for every peer as the single handler used to,
+            // the others only for peers whose messages they just handled.
+            if (nWorker == 0 || fProcessed) {
                 LOCK(pnode->cs_sendProcessing);
                 GetNodeSignals().SendMessages(pnode, *this, flagInterruptMsgProc);
             }
+            pnode->fMsgProcBusy = false;
+            if (pnode->fMsgProcSkipped.exchange(false))
+                WakeMessageHandler();
             if (flagInterruptMsgProc)
                 return;
         }
@@ -2673,6 +2959,11 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) : nSeed0(nSeed0In), nSe
     nBestHeight = 0;
     clientInterface = NULL;
     flagInterruptMsgProc = false;
+    socketEventsMode = SOCKETEVENTS_SELECT;
+    nMsgHandlerThreads = 1;
+    epollFd = -1;
+    wakeupPipe[0] = wakeupPipe[1] = -1;
+    nLastInactivityCheck = 0;
 }
 
 NodeId CConnman::GetNewNodeId()
@@ -2700,6 +2991,12 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     nMaxOutboundLimit = connOptions.nMaxOutboundLimit;
     nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
 
+    socketEventsMode = connOptions.socketEventsMode;
+    if (!InitSocketEvents(strNodeError)) {
+        ShutdownSocketEvents();
+        return false;
+    }
+
     SetBestHeight(connOptions.nBestHeight);
 
     clientInterface = connOptions.uiInterface;
@@ -2784,7 +3081,13 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     threadOpenMasternodeConnections = std::thread(&TraceThread<std::function<void()> >, "mncon", std::function<void()>(std::bind(&CConnman::ThreadOpenMasternodeConnections, this)));
 
     // Process messages
-    threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    nMsgHandlerThreads = std::max(1, std::min(connOptions.nMsgHandlerThreads, MAX_MSGHANDLER_THREADS));
+    for (int i = 0; i < nMsgHandlerThreads; i++) {
+        threadMessageHandlers.push_back(std::thread([this, i] {
+            std::string strName = i == 0 ? "msghand" : strprintf("msghand.%d", i);
+            TraceThread(strName.c_str(), std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this, i)));
+        }));
+    }
 
     // Dandelion shuffle
     threadDandelionShuffle = std::thread(TraceThread<std::function<void()> >, "dandelion", std::function<void()>(std::bind(&CConnman::ThreadDandelionShuffle, this)));
@@ -2843,8 +3146,11 @@ void CConnman::Interrupt()
 
 void CConnman::Stop()
 {
-    if (threadMessageHandler.joinable())
-        threadMessageHandler.join();
+    for (std::thread& thread : threadMessageHandlers) {
+        if (thread.joinable())
+            thread.join();
+    }
+    threadMessageHandlers.clear();
     if (threadOpenMasternodeConnections.joinable())
         threadOpenMasternodeConnections.join();
     if (threadOpenConnections.joinable())
@@ -2882,6 +3188,13 @@ void CConnman::Stop()
     vNodes.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
+    mapEventNodes.clear();
+    mapReceivableNodes.clear();
+    {
+        LOCK(cs_mapSendableNodes);
+        mapSendableNodes.clear();
+    }
+    ShutdownSocketEvents();
     delete semOutbound;
     semOutbound = NULL;
     delete semAddnode;
@@ -3481,6 +3794,10 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     fZnode = false;
     fPauseRecv = false;
     fPauseSend = false;
+    fHasRecvData = false;
+    fCanSendData = false;
+    fMsgProcBusy = false;
+    fMsgProcSkipped = false;
     nProcessQueueSize = 0;
     pendingMNVerification = nullptr;
 
@@ -3579,6 +3896,7 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg, bool allowOpti
     CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, serializedHeader, 0, hdr};
 
     size_t nBytesSent = 0;
+    bool fWakeSocketHandler = false;
     {
         LOCK(pnode->cs_vSend);
         bool optimisticSend(allowOptimisticSend && pnode->vSendMsg.empty());
@@ -3596,9 +3914,14 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg, bool allowOpti
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
             nBytesSent = SocketSendData(pnode);
+
+        // With epoll the socket handler only looks at nodes that were queued for sending
+        fWakeSocketHandler = MarkSendable(pnode);
     }
     if (nBytesSent)
         RecordBytesSent(nBytesSent);
+    if (fWakeSocketHandler)
+        WakeSocketHandler();
 }
 
 bool CConnman::ForNode(const CService& addr, std::function<bool(const CNode* pnode)> cond, std::function<bool(CNode* pnode)> func)
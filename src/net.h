@@ -29,6 +29,7 @@
 #include <stdint.h>
 #include <thread>
 #include <memory>
+#include <unordered_map>
 #include <condition_variable>
 
 #ifndef WIN32
@@ -52,6 +53,13 @@
 #define DEFAULT_ALLOW_OPTIMISTIC_SEND false
 #endif
 
+/** How the socket handler waits for socket readiness */
+enum SocketEventsMode {
+    SOCKETEVENTS_SELECT = 0,
+    //! Edge triggered epoll, no FD_SETSIZE limit and no per iteration cost for idle peers (Linux only)
+    SOCKETEVENTS_EPOLL = 1,
+};
+
 class CAddrMan;
 class CScheduler;
 class CNode;
@@ -101,6 +109,10 @@ static const size_t MAPASKFOR_MAX_SZ = MAX_INV_SZ;
 static const size_t SETASKFOR_MAX_SZ = 2 * MAX_INV_SZ;
 /** The maximum number of peer connections to maintain. */
 static const unsigned int DEFAULT_MAX_PEER_CONNECTIONS = 125;
+/** Default number of threads processing peer messages */
+static const int DEFAULT_MSGHANDLER_THREADS = 2;
+/** Maximum number of threads processing peer messages */
+static const int MAX_MSGHANDLER_THREADS = 16;
 /** The default for -maxuploadtarget. 0 = Unlimited */
 static const uint64_t DEFAULT_MAX_UPLOAD_TARGET = 0;
 /** The default timeframe for -maxuploadtarget. 1 day. */
@@ -172,6 +184,8 @@ public:
         unsigned int nReceiveFloodSize = 0;
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
+        SocketEventsMode socketEventsMode = SOCKETEVENTS_SELECT;
+        int nMsgHandlerThreads = 1;
     };
     CConnman(uint64_t seed0, uint64_t seed1);
     ~CConnman();
@@ -180,6 +194,7 @@ public:
     void Interrupt();
     bool BindListenPort(const CService &bindAddr, std::string& strError, bool fWhitelisted = false);
     bool GetNetworkActive() const { return fNetworkActive; };
+    SocketEventsMode GetSocketEventsMode() const { return socketEventsMode; }
     void SetNetworkActive(bool active);
     bool OpenNetworkConnection(const CAddress& addrConnect, bool fCountFailure, CSemaphoreGrant *grantOutbound = NULL, const char *strDest = NULL, bool fOneShot = false, bool fFeeler = false, bool fAddnode = false, bool fConnectToMasternode = false);
     bool OpenMasternodeConnection(const CAddress& addrConnect);    
@@ -427,7 +442,7 @@ private:
     void ThreadOpenAddedConnections();
     void ProcessOneShot();
     void ThreadOpenConnections();
-    void ThreadMessageHandler();
+    void ThreadMessageHandler(int nWorker);
     void AcceptConnection(const ListenSocket& hListenSocket);
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
@@ -451,6 +466,29 @@ private:
     NodeId GetNewNodeId();
 
     size_t SocketSendData(CNode *pnode) const;
+    /** Read once from the socket of pnode, returns false if there was nothing to read */
+    bool SocketRecvData(CNode *pnode);
+    /** Check the timeouts of all nodes, called by the socket handler */
+    void InactivityCheck();
+
+    /**
+     * Wait for socket events and return the listen sockets with pending connections and the nodes
+     * to receive from and send to. The returned nodes have a reference added.
+     */
+    void SocketEvents(std::vector<const ListenSocket*>& vListenReady, std::vector<CNode*>& vRecvNodes, std::vector<CNode*>& vSendNodes);
+    void SocketEventsSelect(std::vector<const ListenSocket*>& vListenReady, std::vector<CNode*>& vRecvNodes, std::vector<CNode*>& vSendNodes);
+    //! Only defined when built with HAVE_EPOLL
+    void SocketEventsEpoll(std::vector<const ListenSocket*>& vListenReady, std::vector<CNode*>& vRecvNodes, std::vector<CNode*>& vSendNodes);
+    bool InitSocketEvents(std::string& strError);
+    void ShutdownSocketEvents();
+    /** Add a new node to the socket events backend, cs_vNodes must be held */
+    void RegisterNodeEvents(CNode* pnode);
+    /** Remove a node that was taken out of vNodes, cs_vNodes must be held */
+    void UnregisterNodeEvents(CNode* pnode);
+    /** Queue pnode for the socket handler if it has data to send and the socket is writable, pnode->cs_vSend must be held */
+    bool MarkSendable(CNode* pnode);
+    /** Interrupt a wait for socket events */
+    void WakeSocketHandler();
     //!check is the banlist has unwritten changes
     bool BannedSetIsDirty();
     //!set the "dirty" flag for the banlist
@@ -510,6 +548,20 @@ public:
     std::list<CNode*> vNodesDisconnected;
     mutable CCriticalSection cs_vNodes;
 private:
+    SocketEventsMode socketEventsMode;
+    //! epoll instance, -1 unless socketEventsMode is SOCKETEVENTS_EPOLL
+    int epollFd;
+    //! Pipe used to interrupt the epoll wait when data is queued for sending
+    int wakeupPipe[2];
+    //! Nodes registered with epoll by id, protected by cs_vNodes
+    std::unordered_map<NodeId, CNode*> mapEventNodes;
+    //! Nodes that reported readable and weren't drained yet, only used by the socket handler
+    std::unordered_map<NodeId, CNode*> mapReceivableNodes;
+    //! Nodes with queued data and a writable socket
+    std::unordered_map<NodeId, CNode*> mapSendableNodes;
+    CCriticalSection cs_mapSendableNodes;
+    int64_t nLastInactivityCheck;
+
     std::atomic<NodeId> nLastNodeId;
 
     /** Services this instance offers */
@@ -537,6 +589,7 @@ private:
     std::condition_variable condMsgProc;
     std::mutex mutexMsgProc;
     std::atomic<bool> flagInterruptMsgProc;
+    int nMsgHandlerThreads;
 
     CThreadInterrupt interruptNet;
 
@@ -545,7 +598,7 @@ private:
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
     std::thread threadOpenMasternodeConnections;
-    std::thread threadMessageHandler;
+    std::vector<std::thread> threadMessageHandlers;
     std::thread threadDandelionShuffle;
 };
 extern std::unique_ptr<CConnman> g_connman;
@@ -726,6 +779,10 @@ public:
     size_t nProcessQueueSize;
 
     CCriticalSection cs_sendProcessing;
+    //! Set while a message handler thread owns this node, so its messages are processed in order
+    std::atomic<bool> fMsgProcBusy;
+    //! Set by handler threads that skipped this node because it was busy, its owner wakes them when done
+    std::atomic<bool> fMsgProcSkipped;
 
     std::deque<CInv> vRecvGetData;
     uint64_t nRecvBytes;
@@ -775,6 +832,10 @@ public:
     const uint64_t nKeyedNetGroup;
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+    // Readiness as last reported by edge triggered socket events. The socket handler keeps using
+    // the socket until recv/send would block and then waits for the next event.
+    bool fHasRecvData; // only used by the socket handler thread
+    bool fCanSendData; // protected by cs_vSend
 protected:
 
     mapMsgCmdSize mapSendBytesPerMsgCmd;
@@ -84,6 +84,42 @@ static std::vector<std::pair<uint256, CTransactionRef>> vExtraTxnForCompact GUAR
 
 static const uint64_t RANDOMIZER_ID_ADDRESS_RELAY = 0x3cac0035b5866b90ULL; // SHA256("main address relay")[0:8]
 
+/**
+ * Held by the parts of message processing that were written for a single message handler thread:
+ * ProcessGetData, ProcessMessage and SendMessages. Blocks, transactions, headers and getdata are
+ * processed one message at a time under it, however many handler threads there are. Acquired before
+ * cs_main.
+ */
+static CCriticalSection cs_serialMsgProc;
+
+/**
+ * Serializes the legacy indexnode messages accepted by IsIndexnodeMessage() (announcements, list
+ * requests, payment votes, sporks) among themselves. With -msghandlerthreads > 1 they run while
+ * another thread holds cs_serialMsgProc, so a slow mnodeman or znpayments handler doesn't hold up
+ * block relay. Their managers guard their own state, the core code reading it takes those locks too.
+ * Never held together with cs_serialMsgProc. Acquired before cs_main.
+ */
+static CCriticalSection cs_indexnodeMsgProc;
+
+static CCriticalSection cs_msgLatency;
+static std::map<std::string, CLatencyHistogram> mapMessageLatency GUARDED_BY(cs_msgLatency);
+
+static void RecordMessageLatency(const std::string& strCommand, int64_t nMicros)
+{
+    // Only known commands get their own entry, peers shouldn't be able to grow the map
+    static const std::set<std::string> setKnownCommands(getAllNetMessageTypes().begin(), getAllNetMessageTypes().end());
+    const std::string& strKey = setKnownCommands.count(strCommand) ? strCommand : "*other*";
+
+    LOCK(cs_msgLatency);
+    mapMessageLatency[strKey].Add(nMicros);
+}
+
+void GetMessageLatencyStats(std::map<std::string, CLatencyHistogram>& mapStatsRet)
+{
+    LOCK(cs_msgLatency);
+    mapStatsRet = mapMessageLatency;
+}
+
 // Internal stuff
 namespace {
     /** Number of nodes with fSyncStarted. */
@@ -977,29 +1013,41 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     case MSG_TXLOCK_VOTE:
         return fEvoIndexnodes || instantsend.AlreadyHave(inv.hash);
 
-    case MSG_SPORK:
-        return fEvoIndexnodes || mapSporks.count(inv.hash);
+    case MSG_SPORK: {
+        CSporkMessage spork;
+        return fEvoIndexnodes || sporkManager.GetSporkByHash(inv.hash, spork);
+    }
 
-    case MSG_INDEXNODE_PAYMENT_VOTE:
+    case MSG_INDEXNODE_PAYMENT_VOTE: {
+        // Indexnode messages are handled next to this, under cs_indexnodeMsgProc
+        LOCK(cs_mapZnodePaymentVotes);
         return fEvoIndexnodes || znpayments.mapZnodePaymentVotes.count(inv.hash);
+    }
 
     case MSG_INDEXNODE_PAYMENT_BLOCK:
         if (!fEvoIndexnodes)
         {
             BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
+            LOCK(cs_mapZnodeBlocks);
             return mi != mapBlockIndex.end() && znpayments.mapZnodeBlocks.find(mi->second->nHeight) != znpayments.mapZnodeBlocks.end();
         }
         else
             return true;
 
-    case MSG_INDEXNODE_ANNOUNCE:
+    case MSG_INDEXNODE_ANNOUNCE: {
+        LOCK(mnodeman.GetCS());
         return fEvoIndexnodes || (mnodeman.mapSeenZnodeBroadcast.count(inv.hash) && !mnodeman.IsMnbRecoveryRequested(inv.hash));
+    }
 
-    case MSG_INDEXNODE_PING:
+    case MSG_INDEXNODE_PING: {
+        LOCK(mnodeman.GetCS());
         return fEvoIndexnodes || mnodeman.mapSeenZnodePing.count(inv.hash);
+    }
 
-    case MSG_INDEXNODE_VERIFY:
+    case MSG_INDEXNODE_VERIFY: {
+        LOCK(mnodeman.GetCS());
         return fEvoIndexnodes || mnodeman.mapSeenZnodeVerification.count(inv.hash);
+    }
 
     case MSG_QUORUM_FINAL_COMMITMENT:
         return !fEvoIndexnodes || llmq::quorumBlockProcessor->HasMinableCommitment(inv.hash);
@@ -1127,12 +1175,24 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 }
                 // Pruned nodes may have deleted the block, so check whether
                 // it's available before trying to send.
-                if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
+                if (send && (mi->second->nStatus & BLOCK_HAVE_DATA) &&
+                        (inv.type == MSG_WITNESS_BLOCK || (inv.type == MSG_BLOCK && !(mi->second->nStatus & BLOCK_OPT_WITNESS))))
+                {
+                    // The block is stored in the serialization the peer asked for (a block received before segwit
+                    // activation has no witness data), send the bytes from disk without deserializing them
+                    CSerializedNetMsg msg;
+                    msg.command = NetMsgType::BLOCK;
+                    if (!ReadRawBlockFromDisk(msg.data, mi->second, Params().MessageStart()))
+                        assert(!"cannot load block from disk");
+                    connman.PushMessage(pfrom, std::move(msg));
+                }
+                else if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
                 {
                     // Send block from disk
-                    CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second, consensusParams))
+                    std::shared_ptr<const CBlock> pblock = ReadBlockFromDiskCached((*mi).second, consensusParams);
+                    if (!pblock)
                         assert(!"cannot load block from disk");
+                    const CBlock& block = *pblock;
                     if (inv.type == MSG_BLOCK)
                         connman.PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, block));
                     else if (inv.type == MSG_WITNESS_BLOCK)
@@ -1273,16 +1333,18 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 }
 
                 if (!fEvoIndexnodes && !pushed && inv.type == MSG_SPORK) {
-                    if(mapSporks.count(inv.hash)) {
+                    CSporkMessage spork;
+                    if(sporkManager.GetSporkByHash(inv.hash, spork)) {
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
-                        ss << mapSporks[inv.hash];
+                        ss << spork;
                         connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::SPORK, ss));
                         pushed = true;
                     }
                 }
 
                 if (!fEvoIndexnodes && !pushed && inv.type == MSG_INDEXNODE_PAYMENT_VOTE) {
+                    LOCK(cs_mapZnodePaymentVotes);
                     if(znpayments.HasVerifiedPaymentVote(inv.hash)) {
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
@@ -1294,7 +1356,7 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
 
                 if (!fEvoIndexnodes && !pushed && inv.type == MSG_INDEXNODE_PAYMENT_BLOCK) {
                     BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
-                    LOCK(cs_mapZnodeBlocks);
+                    LOCK2(cs_mapZnodeBlocks, cs_mapZnodePaymentVotes);
                     if (mi != mapBlockIndex.end() && znpayments.mapZnodeBlocks.count(mi->second->nHeight)) {
                         BOOST_FOREACH(CZnodePayee& payee, znpayments.mapZnodeBlocks[mi->second->nHeight].vecPayees) {
                             std::vector<uint256> vecVoteHashes = payee.GetVoteHashes();
@@ -1312,6 +1374,7 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 }
 
                 if (!fEvoIndexnodes && !pushed && inv.type == MSG_INDEXNODE_ANNOUNCE) {
+                    LOCK(mnodeman.GetCS());
                     if(mnodeman.mapSeenZnodeBroadcast.count(inv.hash)){
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
@@ -1322,6 +1385,7 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 }
 
                 if (!fEvoIndexnodes && !pushed && inv.type == MSG_INDEXNODE_PING) {
+                    LOCK(mnodeman.GetCS());
                     if(mnodeman.mapSeenZnodePing.count(inv.hash)) {
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
@@ -1332,6 +1396,7 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 }
 
                 if (!fEvoIndexnodes && !pushed && inv.type == MSG_INDEXNODE_VERIFY) {
+                    LOCK(mnodeman.GetCS());
                     if(mnodeman.mapSeenZnodeVerification.count(inv.hash)) {
                         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
                         ss.reserve(1000);
@@ -3188,6 +3253,85 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
     return true;
 }
 
+/**
+ * Messages whose handlers do their own locking and don't depend on the rest of the peer's message
+ * stream once the handshake is done. They are processed without cs_serialMsgProc.
+ */
+static bool IsLockFreeMessage(const CNode* pfrom, const std::string& strCommand)
+{
+    // VERSION/VERACK ordering is enforced by ProcessMessage
+    if (!pfrom->fSuccessfullyConnected)
+        return false;
+
+    // The other legacy indexnode messages, sporks included, go through IsIndexnodeMessage()
+    return strCommand == NetMsgType::MNPING ||
+           strCommand == NetMsgType::MNAUTH ||
+           strCommand == NetMsgType::QSIGSESANN ||
+           strCommand == NetMsgType::QSIGSHARESINV ||
+           strCommand == NetMsgType::QGETSIGSHARES ||
+           strCommand == NetMsgType::QBSIGSHARES;
+}
+
+/** Dispatch a message accepted by IsLockFreeMessage() the same way the tail of ProcessMessage does */
+static bool ProcessLockFreeMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)
+{
+    LogPrint("net", "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->id);
+
+    std::string command = strCommand;
+
+    if (strCommand == NetMsgType::MNAUTH) {
+        CMNAuth::ProcessMessage(pfrom, strCommand, vRecv, connman);
+    } else if (!deterministicMNManager->IsDIP3Enforced()) {
+        // legacy indexnodes
+        if (strCommand == NetMsgType::MNPING)
+            mnodeman.ProcessMessage(pfrom, command, vRecv);
+    } else if (strCommand != NetMsgType::MNPING) {
+        // evo indexnodes
+        llmq::quorumSigSharesManager->ProcessMessage(pfrom, strCommand, vRecv, connman);
+    }
+
+    return true;
+}
+
+/**
+ * Messages the tail of ProcessMessage only hands to the legacy indexnode managers while DIP3 isn't
+ * enforced. They are processed under cs_indexnodeMsgProc instead of cs_serialMsgProc.
+ */
+static bool IsIndexnodeMessage(const CNode* pfrom, const std::string& strCommand)
+{
+    if (!pfrom->fSuccessfullyConnected || deterministicMNManager->IsDIP3Enforced())
+        return false;
+
+    return strCommand == NetMsgType::MNANNOUNCE ||
+           strCommand == NetMsgType::DSEG ||
+           strCommand == NetMsgType::MNVERIFY ||
+           strCommand == NetMsgType::INDEXNODEPAYMENTVOTE ||
+           strCommand == NetMsgType::INDEXNODEPAYMENTSYNC ||
+           strCommand == NetMsgType::SYNCSTATUSCOUNT ||
+           strCommand == NetMsgType::SPORK ||
+           strCommand == NetMsgType::GETSPORKS;
+}
+
+/** Dispatch a message accepted by IsIndexnodeMessage() the same way the tail of ProcessMessage does */
+static bool ProcessIndexnodeMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv)
+{
+    LogPrint("net", "received: %s (%u bytes) peer=%d\n", SanitizeString(strCommand), vRecv.size(), pfrom->id);
+
+    std::string command = strCommand;
+
+    if (!deterministicMNManager->IsDIP3Enforced()) {
+        mnodeman.ProcessMessage(pfrom, command, vRecv);
+        znpayments.ProcessMessage(pfrom, command, vRecv);
+        sporkManager.ProcessSpork(pfrom, command, vRecv);
+        indexnodeSync.ProcessMessage(pfrom, command, vRecv);
+    } else {
+        // DIP3 got enforced since the message was classified
+        masternodeSync.ProcessMessage(pfrom, strCommand, vRecv);
+    }
+
+    return true;
+}
+
 static bool SendRejectsAndCheckIfBanned(CNode* pnode, CConnman& connman)
 {
     AssertLockHeld(cs_main);
@@ -3231,8 +3375,10 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
     //
     bool fMoreWork = false;
 
-    if (!pfrom->vRecvGetData.empty())
+    if (!pfrom->vRecvGetData.empty()) {
+        LOCK(cs_serialMsgProc);
         ProcessGetData(pfrom, chainparams.GetConsensus(), connman, interruptMsgProc);
+    }
 
     if (pfrom->fDisconnect)
         return false;
@@ -3289,11 +3435,24 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
             return fMoreWork;
         }
 
-        // Process message
+        // Process message. The latency is measured once the message's lock is held, waiting for another
+        // peer's message doesn't count.
         bool fRet = false;
+        int64_t nTimeStart = 0;
         try
         {
-            fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc);
+            if (IsLockFreeMessage(pfrom, strCommand)) {
+                nTimeStart = GetTimeMicros();
+                fRet = ProcessLockFreeMessage(pfrom, strCommand, vRecv, connman);
+            } else if (IsIndexnodeMessage(pfrom, strCommand)) {
+                LOCK(cs_indexnodeMsgProc);
+                nTimeStart = GetTimeMicros();
+                fRet = ProcessIndexnodeMessage(pfrom, strCommand, vRecv);
+            } else {
+                LOCK(cs_serialMsgProc);
+                nTimeStart = GetTimeMicros();
+                fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc);
+            }
             if (interruptMsgProc)
                 return false;
             if (!pfrom->vRecvGetData.empty())
@@ -3325,6 +3484,8 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
         catch (...) {
             PrintExceptionContinue(std::current_exception(), "ProcessMessages()");
         }
+        if (nTimeStart != 0)
+            RecordMessageLatency(strCommand, GetTimeMicros() - nTimeStart);
 
         if (!fRet) {
             LogPrintf("%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->id);
@@ -3355,6 +3516,7 @@ public:
 
 bool SendMessages(CNode* pto, CConnman& connman, const std::atomic<bool>& interruptMsgProc)
 {
+    LOCK(cs_serialMsgProc);
     const Consensus::Params& consensusParams = Params().GetConsensus();
     {
         // Don't send anything until the version handshake is complete
@@ -6,6 +6,7 @@
 #ifndef BITCOIN_NET_PROCESSING_H
 #define BITCOIN_NET_PROCESSING_H
 
+#include "latencystats.h"
 #include "net.h"
 #include "validationinterface.h"
 
@@ -49,6 +50,9 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
 void Misbehaving(NodeId nodeid, int howmuch);
 bool IsBanned(NodeId nodeid);
 
+/** Get processing latency per message type, messages of unknown type are reported as "*other*" */
+void GetMessageLatencyStats(std::map<std::string, CLatencyHistogram>& mapStatsRet);
+
 /** Process protocol messages received from a given node */
 bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& interrupt);
 /**
@@ -3,18 +3,22 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "base58.h"
 #include "chain.h"
 #include "chainparams.h"
+#include "clientversion.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "validation.h"
 #include "httpserver.h"
 #include "rpc/server.h"
+#include "sigma.h"
 #include "streams.h"
 #include "sync.h"
 #include "txmempool.h"
 #include "utilstrencodings.h"
 #include "version.h"
+#include "zerocoin_params.h"
 
 #include <boost/algorithm/string.hpp>
 
@@ -58,6 +62,75 @@ struct CCoin {
     }
 };
 
+/** Address index entries as served by /rest/address/, without the address that every entry of a reply shares */
+struct CRestAddressDelta {
+    uint256 txhash;
+    uint32_t index;
+    uint32_t txindex;
+    int32_t nHeight;
+    CAmount satoshis;
+
+    ADD_SERIALIZE_METHODS;
+
+    CRestAddressDelta() : index(0), txindex(0), nHeight(0), satoshis(0) {}
+    CRestAddressDelta(const CAddressIndexKey& key, CAmount value) :
+        txhash(key.txhash), index(key.index), txindex(key.txindex), nHeight(key.blockHeight), satoshis(value) {}
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(txhash);
+        READWRITE(index);
+        READWRITE(txindex);
+        READWRITE(nHeight);
+        READWRITE(satoshis);
+    }
+};
+
+struct CRestAddressUnspent {
+    uint256 txhash;
+    uint32_t index;
+    int32_t nHeight;
+    CAmount satoshis;
+    CScript script;
+
+    ADD_SERIALIZE_METHODS;
+
+    CRestAddressUnspent() : index(0), nHeight(0), satoshis(0) {}
+    CRestAddressUnspent(const CAddressUnspentKey& key, const CAddressUnspentValue& value) :
+        txhash(key.txhash), index(key.index), nHeight(value.blockHeight), satoshis(value.satoshis), script(value.script) {}
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(txhash);
+        READWRITE(index);
+        READWRITE(nHeight);
+        READWRITE(satoshis);
+        READWRITE(*(CScriptBase*)(&script));
+    }
+};
+
+struct CRestSpentSerial {
+    int32_t nHeight;
+    Scalar serial;
+    int64_t denomination;
+    int32_t coinGroupId;
+
+    ADD_SERIALIZE_METHODS;
+
+    CRestSpentSerial() : nHeight(0), denomination(0), coinGroupId(0) {}
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(nHeight);
+        READWRITE(serial);
+        READWRITE(denomination);
+        READWRITE(coinGroupId);
+    }
+};
+
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
 extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
 extern UniValue mempoolInfoToJSON();
@@ -118,6 +191,41 @@ static bool ParseHashStr(const std::string& strReq, uint256& v)
     return true;
 }
 
+/** Cut the query string off strURIPart and return its parameters. Values aren't unescaped, none of ours need it */
+static std::map<std::string, std::string> ParseQueryString(std::string& strURIPart)
+{
+    std::map<std::string, std::string> query;
+    const std::string::size_type pos = strURIPart.find('?');
+    if (pos == std::string::npos)
+        return query;
+
+    std::vector<std::string> items;
+    const std::string strQuery = strURIPart.substr(pos + 1);
+    strURIPart.erase(pos);
+    boost::split(items, strQuery, boost::is_any_of("&"));
+    for (const std::string& item : items) {
+        const std::string::size_type eq = item.find('=');
+        if (eq == std::string::npos)
+            query[item] = "";
+        else
+            query[item.substr(0, eq)] = item.substr(eq + 1);
+    }
+    return query;
+}
+
+/** Read a non-negative integer query parameter, leaving n untouched if it's absent */
+static bool GetQueryInt(const std::map<std::string, std::string>& query, const std::string& name, int& n)
+{
+    std::map<std::string, std::string>::const_iterator it = query.find(name);
+    if (it == query.end())
+        return true;
+    int32_t value;
+    if (!ParseInt32(it->second, &value) || value < 0)
+        return false;
+    n = value;
+    return true;
+}
+
 static bool CheckWarmup(HTTPRequest* req)
 {
     std::string statusmessage;
@@ -213,7 +321,8 @@ static bool rest_block(HTTPRequest* req,
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
-    CBlock block;
+    std::shared_ptr<const CBlock> pblock;
+    std::vector<unsigned char> vRawBlock;
     CBlockIndex* pblockindex = NULL;
     {
         LOCK(cs_main);
@@ -224,30 +333,43 @@ static bool rest_block(HTTPRequest* req,
         if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
 
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
-            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        // Binary and hex replies are the serialized block. Unless witness data has to be stripped
+        // they are exactly the bytes stored on disk, so don't deserialize and serialize again.
+        bool fRaw = (rf == RF_BINARY || rf == RF_HEX) &&
+                (!(RPCSerializationFlags() & SERIALIZE_TRANSACTION_NO_WITNESS) || !(pblockindex->nStatus & BLOCK_OPT_WITNESS));
+        if (fRaw) {
+            if (!ReadRawBlockFromDisk(vRawBlock, pblockindex, Params().MessageStart()))
+                return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        } else {
+            pblock = ReadBlockFromDiskCached(pblockindex, Params().GetConsensus());
+            if (!pblock)
+                return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        }
     }
 
-    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-    ssBlock << block;
+    if (pblock && rf != RF_JSON) {
+        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
+        ssBlock << *pblock;
+        vRawBlock.assign(ssBlock.begin(), ssBlock.end());
+    }
 
     switch (rf) {
     case RF_BINARY: {
-        std::string binaryBlock = ssBlock.str();
+        std::string binaryBlock(vRawBlock.begin(), vRawBlock.end());
         req->WriteHeader("Content-Type", "application/octet-stream");
         req->WriteReply(HTTP_OK, binaryBlock);
         return true;
     }
 
     case RF_HEX: {
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end()) + "\n";
+        std::string strHex = HexStr(vRawBlock.begin(), vRawBlock.end()) + "\n";
         req->WriteHeader("Content-Type", "text/plain");
         req->WriteReply(HTTP_OK, strHex);
         return true;
     }
 
     case RF_JSON: {
-        UniValue objBlock = blockToJSON(block, pblockindex, showTxDetails);
+        UniValue objBlock = blockToJSON(*pblock, pblockindex, showTxDetails);
         std::string strJSON = objBlock.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strJSON);
@@ -591,6 +713,389 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
     return true; // continue to process further HTTP reqs on this cxn
 }
 
+/**
+ * A page cursor is the last index key returned, hex encoded. It has to belong to the requested address so a cursor
+ * can't be used to read another address' history.
+ */
+template<typename Key>
+static std::string EncodeAddressCursor(const Key& key)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << key;
+    return HexStr(ss.begin(), ss.end());
+}
+
+template<typename Key>
+static bool DecodeAddressCursor(const std::map<std::string, std::string>& query, const uint160& hashBytes, AddressType type,
+                                Key& key, bool& fAfter)
+{
+    std::map<std::string, std::string>::const_iterator it = query.find("cursor");
+    fAfter = it != query.end();
+    if (!fAfter)
+        return true;
+    if (!IsHex(it->second))
+        return false;
+
+    std::vector<unsigned char> data(ParseHex(it->second));
+    CDataStream ss(data, SER_DISK, CLIENT_VERSION);
+    try {
+        ss >> key;
+    } catch (const std::exception&) {
+        return false;
+    }
+    return key.hashBytes == hashBytes && key.type == type;
+}
+
+static bool ParseAddressStr(const std::string& strAddress, uint160& hashBytes, AddressType& type)
+{
+    CBitcoinAddress address(strAddress);
+    type = AddressType::unknown;
+    return address.GetIndexKey(hashBytes, type);
+}
+
+static bool rest_address_deltas(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string strURI(strURIPart);
+    const std::map<std::string, std::string> query = ParseQueryString(strURI);
+    std::string strAddress;
+    const RetFormat rf = ParseDataFormat(strAddress, strURI);
+    if (rf == RF_UNDEF)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+
+    uint160 hashBytes;
+    AddressType type;
+    if (!ParseAddressStr(strAddress, hashBytes, type))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid address: " + strAddress);
+
+    int start = 0, end = 0, limit = 0;
+    if (!GetQueryInt(query, "start", start) || !GetQueryInt(query, "end", end) || !GetQueryInt(query, "limit", limit))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid start, end or limit");
+    if (start <= 0 || end <= 0)
+        start = end = 0;
+    else if (end < start)
+        return RESTERR(req, HTTP_BAD_REQUEST, "End value is expected to be greater than start");
+
+    CAddressIndexKey after;
+    bool fAfter;
+    if (!DecodeAddressCursor(query, hashBytes, type, after, fAfter))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid cursor");
+
+    std::vector<CRestAddressDelta> deltas;
+    bool fMore = false;
+    auto visitor = [&](const CAddressIndexKey& key, CAmount value) {
+        if (limit > 0 && deltas.size() == (size_t)limit) {
+            fMore = true;
+            return false;
+        }
+        deltas.emplace_back(key, value);
+        after = key;
+        return true;
+    };
+    if (!GetAddressIndex(hashBytes, type, fAfter ? &after : NULL, start, end, visitor))
+        return RESTERR(req, HTTP_NOT_FOUND, "No information available for address " + strAddress);
+
+    // There is at least one more delta, resume right after the last one returned
+    const std::string strCursor = fMore ? EncodeAddressCursor(after) : "";
+
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        CDataStream ssDeltas(SER_NETWORK, PROTOCOL_VERSION);
+        ssDeltas << deltas << ParseHex(strCursor);
+        if (rf == RF_HEX) {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(ssDeltas.begin(), ssDeltas.end()) + "\n");
+        } else {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, ssDeltas.str());
+        }
+        return true;
+    }
+
+    case RF_JSON: {
+        UniValue jsonDeltas(UniValue::VARR);
+        for (const CRestAddressDelta& delta : deltas) {
+            UniValue obj(UniValue::VOBJ);
+            obj.push_back(Pair("satoshis", delta.satoshis));
+            obj.push_back(Pair("txid", delta.txhash.GetHex()));
+            obj.push_back(Pair("index", (int)delta.index));
+            obj.push_back(Pair("blockindex", (int)delta.txindex));
+            obj.push_back(Pair("height", delta.nHeight));
+            jsonDeltas.push_back(obj);
+        }
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("address", strAddress));
+        result.push_back(Pair("deltas", jsonDeltas));
+        result.push_back(Pair("cursor", fMore ? UniValue(strCursor) : NullUniValue));
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, result.write() + "\n");
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
+static bool rest_address_utxos(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string strURI(strURIPart);
+    const std::map<std::string, std::string> query = ParseQueryString(strURI);
+    std::string strAddress;
+    const RetFormat rf = ParseDataFormat(strAddress, strURI);
+    if (rf == RF_UNDEF)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+
+    uint160 hashBytes;
+    AddressType type;
+    if (!ParseAddressStr(strAddress, hashBytes, type))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid address: " + strAddress);
+
+    int limit = 0;
+    if (!GetQueryInt(query, "limit", limit))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid limit");
+
+    CAddressUnspentKey after;
+    bool fAfter;
+    if (!DecodeAddressCursor(query, hashBytes, type, after, fAfter))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid cursor");
+
+    std::vector<CRestAddressUnspent> utxos;
+    bool fMore = false;
+    auto visitor = [&](const CAddressUnspentKey& key, const CAddressUnspentValue& value) {
+        if (limit > 0 && utxos.size() == (size_t)limit) {
+            fMore = true;
+            return false;
+        }
+        utxos.emplace_back(key, value);
+        after = key;
+        return true;
+    };
+    if (!GetAddressUnspent(hashBytes, type, fAfter ? &after : NULL, visitor))
+        return RESTERR(req, HTTP_NOT_FOUND, "No information available for address " + strAddress);
+
+    const std::string strCursor = fMore ? EncodeAddressCursor(after) : "";
+
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        CDataStream ssUtxos(SER_NETWORK, PROTOCOL_VERSION);
+        ssUtxos << utxos << ParseHex(strCursor);
+        if (rf == RF_HEX) {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(ssUtxos.begin(), ssUtxos.end()) + "\n");
+        } else {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, ssUtxos.str());
+        }
+        return true;
+    }
+
+    case RF_JSON: {
+        UniValue jsonUtxos(UniValue::VARR);
+        for (const CRestAddressUnspent& utxo : utxos) {
+            UniValue obj(UniValue::VOBJ);
+            obj.push_back(Pair("txid", utxo.txhash.GetHex()));
+            obj.push_back(Pair("outputIndex", (int)utxo.index));
+            obj.push_back(Pair("script", HexStr(utxo.script.begin(), utxo.script.end())));
+            obj.push_back(Pair("satoshis", utxo.satoshis));
+            obj.push_back(Pair("height", utxo.nHeight));
+            jsonUtxos.push_back(obj);
+        }
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("address", strAddress));
+        result.push_back(Pair("utxos", jsonUtxos));
+        result.push_back(Pair("cursor", fMore ? UniValue(strCursor) : NullUniValue));
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, result.write() + "\n");
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
+static bool rest_sigma_anonymityset(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Use /rest/sigma/anonymityset/<denomination>/<groupid>.<ext>.");
+
+    int64_t intDenom;
+    int32_t coinGroupId;
+    sigma::CoinDenomination denomination;
+    if (!ParseInt64(path[0], &intDenom) || !sigma::IntegerToDenomination(intDenom, denomination))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid denomination: " + path[0]);
+    if (!ParseInt32(path[1], &coinGroupId) || coinGroupId < 1)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid coin group id: " + path[1]);
+
+    uint256 blockHash;
+    std::vector<sigma::PublicCoin> coins;
+    {
+        LOCK(cs_main);
+        sigma::CSigmaState::GetState()->GetCoinSetForSpend(
+                &chainActive,
+                chainActive.Height() - (ZC_MINT_CONFIRMATIONS - 1),
+                denomination,
+                coinGroupId,
+                blockHash,
+                coins);
+    }
+
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        // Group elements are written as they are, without the denomination every coin of the set shares
+        CDataStream ssCoins(SER_NETWORK, PROTOCOL_VERSION);
+        ssCoins.reserve(40 + coins.size() * GroupElement::memoryRequired());
+        ssCoins << blockHash;
+        WriteCompactSize(ssCoins, coins.size());
+        for (const sigma::PublicCoin& coin : coins)
+            ssCoins << coin.getValue();
+        if (rf == RF_HEX) {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(ssCoins.begin(), ssCoins.end()) + "\n");
+        } else {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, ssCoins.str());
+        }
+        return true;
+    }
+
+    case RF_JSON: {
+        UniValue serializedCoins(UniValue::VARR);
+        for (const sigma::PublicCoin& coin : coins) {
+            std::vector<unsigned char> vch = coin.getValue().getvch();
+            serializedCoins.push_back(HexStr(vch.begin(), vch.end()));
+        }
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("blockHash", blockHash.GetHex()));
+        result.push_back(Pair("serializedCoins", serializedCoins));
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, result.write() + "\n");
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
+static bool rest_sigma_usedserials(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string strURI(strURIPart);
+    const std::map<std::string, std::string> query = ParseQueryString(strURI);
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURI);
+
+    int32_t nStartHeight;
+    if (!ParseInt32(param, &nStartHeight) || nStartHeight < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height: " + param + ". Use /rest/sigma/usedserials/<height>.<ext>.");
+
+    // Without end the walk goes up to the tip, without limit it returns every serial on the way
+    int end = -1, limit = 0;
+    if (!GetQueryInt(query, "end", end) || !GetQueryInt(query, "limit", limit))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid end or limit");
+    if (end >= 0 && end < nStartHeight)
+        return RESTERR(req, HTTP_BAD_REQUEST, "End value is expected to be greater than start");
+
+    // Serials are read from the block index rather than the global set, so only the blocks asked for are visited.
+    // A block's serials are returned together, a page ends before the block that would take it past the limit.
+    int nTipHeight;
+    uint256 tipHash;
+    int nNextHeight = -1;
+    std::vector<CRestSpentSerial> serials;
+    {
+        LOCK(cs_main);
+        nTipHeight = chainActive.Height();
+        tipHash = chainActive.Tip()->GetBlockHash();
+        for (const CBlockIndex* pindex = chainActive[nStartHeight]; pindex; pindex = chainActive.Next(pindex)) {
+            if (end >= 0 && pindex->nHeight > end)
+                break;
+            if (limit > 0 && !serials.empty() && serials.size() + pindex->sigmaSpentSerials.size() > (size_t)limit) {
+                nNextHeight = pindex->nHeight;
+                break;
+            }
+            for (const auto& spend : pindex->sigmaSpentSerials) {
+                CRestSpentSerial entry;
+                entry.nHeight = pindex->nHeight;
+                entry.serial = spend.first;
+                sigma::DenominationToInteger(spend.second.denomination, entry.denomination);
+                entry.coinGroupId = spend.second.coinGroupId;
+                serials.push_back(entry);
+            }
+        }
+    }
+
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        CDataStream ssSerials(SER_NETWORK, PROTOCOL_VERSION);
+        ssSerials << nTipHeight << tipHash << serials << nNextHeight;
+        if (rf == RF_HEX) {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(ssSerials.begin(), ssSerials.end()) + "\n");
+        } else {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, ssSerials.str());
+        }
+        return true;
+    }
+
+    case RF_JSON: {
+        UniValue jsonSerials(UniValue::VARR);
+        for (const CRestSpentSerial& entry : serials) {
+            UniValue obj(UniValue::VOBJ);
+            obj.push_back(Pair("serial", entry.serial.GetHex()));
+            obj.push_back(Pair("height", entry.nHeight));
+            obj.push_back(Pair("denomination", entry.denomination));
+            obj.push_back(Pair("coinGroupId", entry.coinGroupId));
+            jsonSerials.push_back(obj);
+        }
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("chainHeight", nTipHeight));
+        result.push_back(Pair("chaintipHash", tipHash.GetHex()));
+        result.push_back(Pair("serials", jsonSerials));
+        result.push_back(Pair("nextHeight", nNextHeight >= 0 ? UniValue(nNextHeight) : NullUniValue));
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, result.write() + "\n");
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -603,6 +1108,10 @@ static const struct {
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
+      {"/rest/address/deltas/", rest_address_deltas},
+      {"/rest/address/utxos/", rest_address_utxos},
+      {"/rest/sigma/anonymityset/", rest_sigma_anonymityset},
+      {"/rest/sigma/usedserials/", rest_sigma_usedserials},
 };
 
 bool StartREST()
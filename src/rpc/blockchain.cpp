@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "amount.h"
+#include "blockcache.h"
 #include <blockinfo/blockinfo.h>
 #include "chain.h"
 #include "chainparams.h"
@@ -17,6 +18,7 @@
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
+#include "txdb.h"
 #include "txmempool.h"
 #include "util.h"
 #include "utilstrencodings.h"
@@ -26,6 +28,7 @@
 #include "evo/providertx.h"
 #include "evo/deterministicmns.h"
 #include "evo/cbtx.h"
+#include "sigma.h"
 
 #include <stdint.h>
 
@@ -890,19 +893,20 @@ UniValue getblock(const JSONRPCRequest& request)
     if (mapBlockIndex.count(hash) == 0)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    CBlock block;
     CBlockIndex* pblockindex = mapBlockIndex[hash];
 
     if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
         throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
 
-    if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+    std::shared_ptr<const CBlock> pblock = ReadBlockFromDiskCached(pblockindex, Params().GetConsensus());
+    if (!pblock)
         // Block not found on disk. This could be because we have the block
         // header in our index but don't have the block (for example if a
         // non-whitelisted node sends us an unrequested long chain of valid
         // blocks, we add the headers to our index, but don't accept the
         // block).
         throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
+    const CBlock& block = *pblock;
 
     if (!fVerbose)
     {
@@ -1071,6 +1075,52 @@ UniValue gettxoutsetinfo(const JSONRPCRequest& request)
     return ret;
 }
 
+UniValue getcoinsflushinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 0)
+        throw runtime_error(
+            "getcoinsflushinfo\n"
+            "\nReturns how flushes of the coins cache to the coin database went.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"background\": true|false,  (boolean) Whether the cache is written on a background thread (-dbbackgroundflush)\n"
+            "  \"pending_coins\": n,         (numeric) Entries of the write in progress, 0 if there is none\n"
+            "  \"pending_block\": \"hash\",    (string, optional) The block the write in progress is at\n"
+            "  \"coins_written\": n,         (numeric) Entries written since startup\n"
+            "  \"pause\": {                  (json object) Time full flushes held up block validation\n"
+            "    \"count\": n,               (numeric) Number of flushes\n"
+            "    \"avg_us\": n,              (numeric) Average time in microseconds\n"
+            "    \"max_us\": n,              (numeric) Longest time in microseconds\n"
+            "    \"histogram\": [n,...]      (array) Flush counts by time, entry i covers [2^i, 2^(i+1)) microseconds\n"
+            "  },\n"
+            "  \"wait\": {...},              (json object) Part of the pause spent waiting for a write to finish, same fields as pause\n"
+            "  \"write\": {...}              (json object) Time the writes to the coin database took, same fields as pause\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getcoinsflushinfo", "")
+            + HelpExampleRpc("getcoinsflushinfo", "")
+        );
+
+    CCoinsFlushStats stats;
+    {
+        LOCK(cs_main);
+        if (!pcoinsflusher)
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Coin database is not open");
+        pcoinsflusher->GetStats(stats);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("background", fCoinsBackgroundFlush));
+    ret.push_back(Pair("pending_coins", (uint64_t)stats.nPendingCoins));
+    if (stats.nPendingCoins > 0)
+        ret.push_back(Pair("pending_block", stats.hashPendingBlock.GetHex()));
+    ret.push_back(Pair("coins_written", stats.nCoinsWritten));
+    ret.push_back(Pair("pause", LatencyHistogramToJSON(stats.pause)));
+    ret.push_back(Pair("wait", LatencyHistogramToJSON(stats.wait)));
+    ret.push_back(Pair("write", LatencyHistogramToJSON(stats.write)));
+    return ret;
+}
+
 UniValue gettxout(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
@@ -1478,6 +1528,62 @@ UniValue getmempoolinfo(const JSONRPCRequest& request)
     return mempoolInfoToJSON();
 }
 
+UniValue getblockcacheinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw runtime_error(
+            "getblockcacheinfo\n"
+            "\nReturns details on the cache of recently used blocks (see -blockcachesize).\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"size\": xxxxx,               (numeric) Number of cached blocks\n"
+            "  \"usage\": xxxxx,              (numeric) Estimated memory usage of the cached blocks\n"
+            "  \"maxusage\": xxxxx,           (numeric) Maximum memory usage of the cache\n"
+            "  \"hits\": xxxxx,               (numeric) Block reads served from the cache since startup\n"
+            "  \"misses\": xxxxx,             (numeric) Block reads that went to disk since startup\n"
+            "  \"evictions\": xxxxx           (numeric) Blocks evicted to stay within maxusage since startup\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockcacheinfo", "")
+            + HelpExampleRpc("getblockcacheinfo", "")
+        );
+
+    CBlockCache::Stats stats = blockCache.GetStats();
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("size", (uint64_t)stats.nBlocks));
+    ret.push_back(Pair("usage", (uint64_t)stats.nUsage));
+    ret.push_back(Pair("maxusage", (uint64_t)stats.nMaxUsage));
+    ret.push_back(Pair("hits", stats.nHits));
+    ret.push_back(Pair("misses", stats.nMisses));
+    ret.push_back(Pair("evictions", stats.nEvictions));
+    return ret;
+}
+
+UniValue getsigmaproofcacheinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw runtime_error(
+            "getsigmaproofcacheinfo\n"
+            "\nReturns details on the cache of verified sigma spend proofs (see -maxsigmaproofcachesize).\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"maxentries\": xxxxx,         (numeric) Number of proofs the cache can hold\n"
+            "  \"hits\": xxxxx,               (numeric) Proof checks answered by the cache since startup\n"
+            "  \"misses\": xxxxx              (numeric) Proof checks that ran the verification since startup\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getsigmaproofcacheinfo", "")
+            + HelpExampleRpc("getsigmaproofcacheinfo", "")
+        );
+
+    sigma::SigmaProofCacheStats stats = sigma::GetSigmaProofCacheStats();
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("maxentries", (uint64_t)stats.nMaxEntries));
+    ret.push_back(Pair("hits", stats.nHits));
+    ret.push_back(Pair("misses", stats.nMisses));
+    return ret;
+}
+
 UniValue preciousblock(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -1705,6 +1811,8 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       true,  {} },
     { "blockchain",         "getblockcount",          &getblockcount,          true,  {} },
     { "blockchain",         "getblock",               &getblock,               true,  {"blockhash","verbose"} },
+    { "blockchain",         "getblockcacheinfo",      &getblockcacheinfo,      true,  {} },
+    { "blockchain",         "getsigmaproofcacheinfo", &getsigmaproofcacheinfo, true,  {} },
     { "blockchain",         "getblockhash",           &getblockhash,           true,  {"height"} },
     { "blockchain",         "getblockhashes",         &getblockhashes,         true,  {"high", "low"} },
     { "blockchain",         "getblockheader",         &getblockheader,         true,  {"blockhash","verbose"} },
@@ -1717,6 +1825,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getrawmempool",          &getrawmempool,          true,  {"verbose"} },
     { "blockchain",         "clearmempool",           &clearmempool,           true,  {} },
     { "blockchain",         "getspecialtxes",         &getspecialtxes,         true,  {"blockhash", "type", "count", "skip", "verbosity"} },
+    { "blockchain",         "getcoinsflushinfo",      &getcoinsflushinfo,      true,  {} },
     { "blockchain",         "gettxout",               &gettxout,               true,  {"txid","n","include_mempool"} },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  {} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        true,  {"height"} },
@@ -668,6 +668,57 @@ bool timestampSort(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
     return a.second.time < b.second.time;
 }
 
+namespace {
+/**
+ * A page cursor is the position of the address in the request plus the last index key returned for it, so that the
+ * next call can seek right past it instead of re-reading the history.
+ */
+template<typename Key>
+UniValue encodeAddressCursor(size_t nAddress, const Key &key)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << (uint32_t)nAddress << key;
+    return UniValue(HexStr(ss.begin(), ss.end()));
+}
+
+template<typename Key>
+bool decodeAddressCursor(const UniValue &cursor, const std::vector<std::pair<uint160, AddressType> > &addresses,
+                         size_t &nAddress, Key &key)
+{
+    if (cursor.isNull())
+        return false;
+    if (!cursor.isStr() || !IsHex(cursor.get_str()))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+
+    std::vector<unsigned char> data(ParseHex(cursor.get_str()));
+    CDataStream ss(data, SER_DISK, CLIENT_VERSION);
+    uint32_t n;
+    try {
+        ss >> n >> key;
+    } catch (const std::exception &) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+    }
+    if (n >= addresses.size() || addresses[n].first != key.hashBytes || addresses[n].second != key.type)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Cursor doesn't match the requested addresses");
+
+    nAddress = n;
+    return true;
+}
+
+int getPageLimit(const UniValue &params)
+{
+    if (!params[0].isObject())
+        return 0;
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    if (limitValue.isNull())
+        return 0;
+    int limit = limitValue.get_int();
+    if (limit <= 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be positive");
+    return limit;
+}
+}
+
 UniValue getaddressmempool(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -751,6 +802,8 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
                         "      \"address\"  (string) The base58check encoded address\n"
                         "      ,...\n"
                         "    ]\n"
+                        "  \"limit\" (number, optional) Return at most this many outputs per call\n"
+                        "  \"cursor\" (string, optional) The cursor returned by the previous call\n"
                         "}\n"
                         "\nResult\n"
                         "[\n"
@@ -763,8 +816,14 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
                         "    \"height\"  (number) The block height\n"
                         "  }\n"
                         "]\n"
+                        "\nResult (with limit):\n"
+                        "{\n"
+                        "  \"utxos\"  (array) The outputs as above, in index order rather than sorted by height\n"
+                        "  \"cursor\"  (string) The cursor for the next page, null if there are no more outputs\n"
+                        "}\n"
                         "\nExamples:\n"
                 + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
+                + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"], \"limit\": 1000}'")
                 + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
         );
 
@@ -774,6 +833,55 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    int const limit = getPageLimit(request.params);
+    if (limit > 0) {
+        size_t nAddress = 0;
+        CAddressUnspentKey after;
+        bool const fAfter = decodeAddressCursor(find_value(request.params[0].get_obj(), "cursor"), addresses, nAddress, after);
+        size_t nAfterAddress = nAddress;
+
+        UniValue utxos(UniValue::VARR);
+        UniValue cursor(UniValue::VNULL);
+        int count = 0;
+
+        for (; nAddress < addresses.size() && cursor.isNull(); nAddress++) {
+            std::string address;
+            if (!getAddressFromIndex(addresses[nAddress].second, addresses[nAddress].first, address)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+            }
+
+            auto visitor = [&](const CAddressUnspentKey &key, const CAddressUnspentValue &value) {
+                if (count == limit) {
+                    // there is at least one more output, resume from the last one returned
+                    cursor = encodeAddressCursor(nAfterAddress, after);
+                    return false;
+                }
+                UniValue output(UniValue::VOBJ);
+                output.push_back(Pair("address", address));
+                output.push_back(Pair("txid", key.txhash.GetHex()));
+                output.push_back(Pair("outputIndex", (int)key.index));
+                output.push_back(Pair("script", HexStr(value.script.begin(), value.script.end())));
+                output.push_back(Pair("satoshis", value.satoshis));
+                output.push_back(Pair("height", value.blockHeight));
+                utxos.push_back(output);
+                after = key;
+                nAfterAddress = nAddress;
+                count++;
+                return true;
+            };
+
+            bool const fResume = fAfter && after.hashBytes == addresses[nAddress].first && after.type == addresses[nAddress].second;
+            if (!GetAddressUnspent(addresses[nAddress].first, addresses[nAddress].second, fResume ? &after : NULL, visitor)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+        }
+
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("utxos", utxos));
+        result.push_back(Pair("cursor", cursor));
+        return result;
+    }
+
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
 
     for (std::vector<std::pair<uint160, AddressType> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
@@ -820,6 +928,8 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
                         "    ]\n"
                         "  \"start\" (number) The start block height\n"
                         "  \"end\" (number) The end block height\n"
+                        "  \"limit\" (number, optional) Return at most this many deltas per call\n"
+                        "  \"cursor\" (string, optional) The cursor returned by the previous call\n"
                         "}\n"
                         "\nResult:\n"
                         "[\n"
@@ -832,8 +942,14 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
                         "    \"address\"  (string) The base58check encoded address\n"
                         "  }\n"
                         "]\n"
+                        "\nResult (with limit):\n"
+                        "{\n"
+                        "  \"deltas\"  (array) The deltas as above\n"
+                        "  \"cursor\"  (string) The cursor for the next page, null if there are no more deltas\n"
+                        "}\n"
                         "\nExamples:\n"
                 + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
+                + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"], \"limit\": 1000}'")
                 + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
         );
 
@@ -858,6 +974,59 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    int const limit = getPageLimit(request.params);
+    if (limit > 0) {
+        if (start <= 0 || end <= 0) {
+            start = end = 0;
+        }
+
+        size_t nAddress = 0;
+        CAddressIndexKey after;
+        bool const fAfter = decodeAddressCursor(find_value(request.params[0].get_obj(), "cursor"), addresses, nAddress, after);
+        size_t nAfterAddress = nAddress;
+
+        UniValue deltas(UniValue::VARR);
+        UniValue cursor(UniValue::VNULL);
+        int count = 0;
+
+        for (; nAddress < addresses.size() && cursor.isNull(); nAddress++) {
+            std::string address;
+            if (!getAddressFromIndex(addresses[nAddress].second, addresses[nAddress].first, address)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+            }
+
+            auto visitor = [&](const CAddressIndexKey &key, CAmount value) {
+                if (count == limit) {
+                    // there is at least one more delta, resume from the last one returned
+                    cursor = encodeAddressCursor(nAfterAddress, after);
+                    return false;
+                }
+                UniValue delta(UniValue::VOBJ);
+                delta.push_back(Pair("satoshis", value));
+                delta.push_back(Pair("txid", key.txhash.GetHex()));
+                delta.push_back(Pair("index", (int)key.index));
+                delta.push_back(Pair("blockindex", (int)key.txindex));
+                delta.push_back(Pair("height", key.blockHeight));
+                delta.push_back(Pair("address", address));
+                deltas.push_back(delta);
+                after = key;
+                nAfterAddress = nAddress;
+                count++;
+                return true;
+            };
+
+            bool const fResume = fAfter && after.hashBytes == addresses[nAddress].first && after.type == addresses[nAddress].second;
+            if (!GetAddressIndex(addresses[nAddress].first, addresses[nAddress].second, fResume ? &after : NULL, start, end, visitor)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+        }
+
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("deltas", deltas));
+        result.push_back(Pair("cursor", cursor));
+        return result;
+    }
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
     for (std::vector<std::pair<uint160, AddressType> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
@@ -911,6 +1080,7 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
                         "{\n"
                         "  \"balance\"  (string) The current balance in duffs\n"
                         "  \"received\"  (string) The total number of duffs received (including change)\n"
+                        "  \"txcount\"  (number) The number of transactions involving the address(es)\n"
                         "}\n"
                         "\nExamples:\n"
                 + HelpExampleCli("getaddressbalance", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
@@ -923,27 +1093,24 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-    for (std::vector<std::pair<uint160, AddressType> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
-    }
-
     CAmount balance = 0;
     CAmount received = 0;
+    int64_t txCount = 0;
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        if (it->second > 0) {
-            received += it->second;
+    for (std::vector<std::pair<uint160, AddressType> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        CAddressBalanceValue value;
+        if (!GetAddressBalance((*it).first, (*it).second, value)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
-        balance += it->second;
+        balance += value.balance;
+        received += value.received;
+        txCount += value.txCount;
     }
 
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("balance", balance));
     result.push_back(Pair("received", received));
+    result.push_back(Pair("txcount", txCount));
 
     return result;
 
@@ -6,6 +6,7 @@
 
 #include "chainparams.h"
 #include "clientversion.h"
+#include "httpserver.h"
 #include "validation.h"
 #include "net.h"
 #include "net_processing.h"
@@ -376,6 +377,81 @@ UniValue getnettotals(const JSONRPCRequest& request)
     return obj;
 }
 
+UniValue getmessagelatency(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 0)
+        throw runtime_error(
+            "getmessagelatency\n"
+            "\nReturns how long received messages took to process, per message type.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"command\":               (string) The message type, \"*other*\" for unknown ones\n"
+            "  {\n"
+            "    \"count\": n,            (numeric) Number of messages processed\n"
+            "    \"avg_us\": n,           (numeric) Average processing time in microseconds\n"
+            "    \"max_us\": n,           (numeric) Longest processing time in microseconds\n"
+            "    \"histogram\": [n,...]   (array) Message counts by processing time, entry i covers [2^i, 2^(i+1)) microseconds\n"
+            "  }, ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getmessagelatency", "")
+            + HelpExampleRpc("getmessagelatency", "")
+       );
+
+    std::map<std::string, CLatencyHistogram> mapStats;
+    GetMessageLatencyStats(mapStats);
+
+    UniValue obj(UniValue::VOBJ);
+    for (const auto& entry : mapStats)
+        obj.push_back(Pair(entry.first, LatencyHistogramToJSON(entry.second)));
+    return obj;
+}
+
+UniValue gethttpworkqueueinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() > 0)
+        throw runtime_error(
+            "gethttpworkqueueinfo\n"
+            "\nReturns the state of the HTTP server's work queue lanes.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"lane\":                   (string) rpc, wallet or rest\n"
+            "  {\n"
+            "    \"threads\": n,            (numeric) Worker threads serving the lane\n"
+            "    \"depth\": n,              (numeric) Requests waiting for a worker\n"
+            "    \"max_depth\": n,          (numeric) Depth at which requests are rejected\n"
+            "    \"rejected\": n,           (numeric) Requests rejected because the queue was full\n"
+            "    \"queue_wait\": {          (json object) Time requests waited for a worker\n"
+            "      \"count\": n,            (numeric) Number of requests\n"
+            "      \"avg_us\": n,           (numeric) Average time in microseconds\n"
+            "      \"max_us\": n,           (numeric) Longest time in microseconds\n"
+            "      \"histogram\": [n,...]   (array) Request counts by time, entry i covers [2^i, 2^(i+1)) microseconds\n"
+            "    },\n"
+            "    \"exec\": {...}            (json object) Time requests took to execute, same fields as queue_wait\n"
+            "  }, ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("gethttpworkqueueinfo", "")
+            + HelpExampleRpc("gethttpworkqueueinfo", "")
+       );
+
+    std::vector<HTTPWorkQueueStats> vStats;
+    GetHTTPWorkQueueStats(vStats);
+
+    UniValue obj(UniValue::VOBJ);
+    for (const HTTPWorkQueueStats& stats : vStats) {
+        UniValue laneObj(UniValue::VOBJ);
+        laneObj.push_back(Pair("threads", stats.nThreads));
+        laneObj.push_back(Pair("depth", (uint64_t)stats.nDepth));
+        laneObj.push_back(Pair("max_depth", (uint64_t)stats.nMaxDepth));
+        laneObj.push_back(Pair("rejected", stats.nRejected));
+        laneObj.push_back(Pair("queue_wait", LatencyHistogramToJSON(stats.queueWait)));
+        laneObj.push_back(Pair("exec", LatencyHistogramToJSON(stats.exec)));
+        obj.push_back(Pair(stats.name, laneObj));
+    }
+    return obj;
+}
+
 static UniValue GetNetworksInfo()
 {
     UniValue networks(UniValue::VARR);
@@ -413,6 +489,7 @@ UniValue getnetworkinfo(const JSONRPCRequest& request)
             "  \"timeoffset\": xxxxx,                   (numeric) the time offset\n"
             "  \"connections\": xxxxx,                  (numeric) the number of connections\n"
             "  \"networkactive\": true|false,           (bool) whether p2p networking is enabled\n"
+            "  \"socketevents\": \"mode\",               (string) how sockets are polled for events, epoll or select (-socketevents)\n"
             "  \"networks\": [                          (array) information per network\n"
             "  {\n"
             "    \"name\": \"xxx\",                     (string) network (ipv4, ipv6 or onion)\n"
@@ -452,6 +529,7 @@ UniValue getnetworkinfo(const JSONRPCRequest& request)
     if (g_connman) {
         obj.push_back(Pair("networkactive", g_connman->GetNetworkActive()));
         obj.push_back(Pair("connections",   (int)g_connman->GetNodeCount(CConnman::CONNECTIONS_ALL)));
+        obj.push_back(Pair("socketevents",  g_connman->GetSocketEventsMode() == SOCKETEVENTS_EPOLL ? "epoll" : "select"));
     }
     obj.push_back(Pair("networks",      GetNetworksInfo()));
     obj.push_back(Pair("relayfee",      ValueFromAmount(::minRelayTxFee.GetFeePerK())));
@@ -618,6 +696,8 @@ static const CRPCCommand commands[] =
     { "network",            "disconnectnode",         &disconnectnode,         true,  {"address"} },
     { "network",            "getaddednodeinfo",       &getaddednodeinfo,       true,  {"node"} },
     { "network",            "getnettotals",           &getnettotals,           true,  {} },
+    { "network",            "getmessagelatency",      &getmessagelatency,      true,  {} },
+    { "network",            "gethttpworkqueueinfo",   &gethttpworkqueueinfo,   true,  {} },
     { "network",            "getnetworkinfo",         &getnetworkinfo,         true,  {} },
     { "network",            "setban",                 &setban,                 true,  {"subnet", "command", "bantime", "absolute"} },
     { "network",            "listbanned",             &listbanned,             true,  {} },
@@ -11,6 +11,7 @@
 #include "llmq/quorums_debug.h"
 #include "llmq/quorums_dkgsession.h"
 #include "llmq/quorums_signing.h"
+#include "llmq/quorums_utils.h"
 
 void quorum_list_help()
 {
@@ -185,6 +186,13 @@ UniValue quorum_dkgstatus(const JSONRPCRequest& request)
 
     ret.push_back(Pair("minableCommitments", minableCommitments));
 
+    uint64_t nMembersCacheHits, nMembersCacheMisses;
+    llmq::CLLMQUtils::GetQuorumMembersCacheStats(nMembersCacheHits, nMembersCacheMisses);
+    UniValue membersCache(UniValue::VOBJ);
+    membersCache.push_back(Pair("hits", nMembersCacheHits));
+    membersCache.push_back(Pair("misses", nMembersCacheMisses));
+    ret.push_back(Pair("quorumMembersCache", membersCache));
+
     return ret;
 }
 
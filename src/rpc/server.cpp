@@ -7,6 +7,7 @@
 
 #include "base58.h"
 #include "init.h"
+#include "latencystats.h"
 #include "random.h"
 #include "sync.h"
 #include "ui_interface.h"
@@ -23,8 +24,12 @@
 #include <boost/thread.hpp>
 #include <boost/algorithm/string/case_conv.hpp> // for to_upper()
 
+#include <atomic>
+#include <condition_variable>
 #include <memory> // for unique_ptr
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 
 using namespace RPCServer;
 using namespace std;
@@ -483,13 +488,114 @@ static UniValue JSONRPCExecOne(const UniValue& req)
     return rpc_result;
 }
 
-std::string JSONRPCExecBatch(const UniValue& vReq)
+/** Whether a batch element only reads chain, mempool or index state, so it may run alongside other elements */
+static bool IsConcurrentBatchRequest(const UniValue& req)
 {
-    UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+    static const std::unordered_set<std::string> setReadOnly = {
+        "getbestblockhash", "getblock", "getblockchaininfo", "getblockcount", "getblockhash", "getblockhashes",
+        "getblockheader", "getchaintips", "getdifficulty", "getmempoolancestors", "getmempooldescendants",
+        "getmempoolentry", "getmempoolinfo", "getrawmempool", "gettxout", "getrawtransaction",
+        "decoderawtransaction", "decodescript", "getaddressbalance", "getaddressdeltas", "getaddressmempool",
+        "getaddresstxids", "getaddressutxos", "getspentinfo", "getanonymityset", "getmintmetadata",
+        "getusedcoinserials",
+    };
+    if (!req.isObject())
+        return false;
+    const UniValue& method = find_value(req, "method");
+    return method.isStr() && setReadOnly.count(method.get_str());
+}
+
+/** Elements [nBegin, nEnd) of a batch, claimed one at a time by the calling thread and its helpers */
+struct BatchRun
+{
+    const UniValue* pvReq;
+    std::vector<std::string>* pvReplies;
+    std::atomic<size_t> nNext;
+    size_t nEnd;
+    std::mutex cs;
+    std::condition_variable cond;
+    size_t nLeft;
 
-    return ret.write() + "\n";
+    // Helpers can still be queued after the batch is done, they only touch pvReq and
+    // pvReplies for elements they claimed, which the caller waits for.
+    void Work()
+    {
+        size_t nIdx;
+        while ((nIdx = nNext++) < nEnd) {
+            std::string strReply = JSONRPCExecOne((*pvReq)[nIdx]).write();
+            std::lock_guard<std::mutex> lock(cs);
+            (*pvReplies)[nIdx] = std::move(strReply);
+            if (--nLeft == 0)
+                cond.notify_all();
+        }
+    }
+};
+
+void JSONRPCWriteBatch(const UniValue& vReq, const std::function<void(std::string&&)>& writeReply, const std::function<bool(const std::function<void()>&)>& queueWork, int nMaxHelpers)
+{
+    // Each reply is written out as soon as it is done, so its UniValue doesn't stay
+    // around until the whole batch has been executed
+    std::vector<std::string> vReplies(vReq.size());
+    size_t nIdx = 0;
+    size_t nWritten = 0;
+    std::string strOut = "[";
+    while (nIdx < vReq.size()) {
+        size_t nEnd = nIdx;
+        if (queueWork && nMaxHelpers > 0) {
+            while (nEnd < vReq.size() && IsConcurrentBatchRequest(vReq[nEnd]))
+                nEnd++;
+        }
+        if (nEnd - nIdx < 2) {
+            vReplies[nIdx] = JSONRPCExecOne(vReq[nIdx]).write();
+            nEnd = nIdx + 1;
+        } else {
+            std::shared_ptr<BatchRun> run = std::make_shared<BatchRun>();
+            run->pvReq = &vReq;
+            run->pvReplies = &vReplies;
+            run->nNext = nIdx;
+            run->nEnd = nEnd;
+            run->nLeft = nEnd - nIdx;
+            int nHelpers = std::min<size_t>(nMaxHelpers, nEnd - nIdx - 1);
+            for (int i = 0; i < nHelpers; i++) {
+                if (!queueWork([run] { run->Work(); }))
+                    break;
+            }
+            run->Work();
+            {
+                std::unique_lock<std::mutex> lock(run->cs);
+                run->cond.wait(lock, [&run] { return run->nLeft == 0; });
+            }
+        }
+        nIdx = nEnd;
+
+        // Everything before nIdx is done and can go out
+        size_t nSize = strOut.size();
+        for (size_t i = nWritten; i < nIdx; i++)
+            nSize += vReplies[i].size() + 1;
+        strOut.reserve(nSize);
+        for (; nWritten < nIdx; nWritten++) {
+            if (nWritten > 0)
+                strOut += ',';
+            strOut += vReplies[nWritten];
+            std::string().swap(vReplies[nWritten]);
+        }
+        writeReply(std::move(strOut));
+        strOut.clear();
+    }
+    strOut += "]\n";
+    writeReply(std::move(strOut));
+}
+
+std::string JSONRPCExecBatch(const UniValue& vReq, const std::function<bool(const std::function<void()>&)>& queueWork, int nMaxHelpers)
+{
+    std::string strRet;
+    JSONRPCWriteBatch(vReq, [&strRet](std::string&& strReply) {
+        if (strRet.empty())
+            strRet = std::move(strReply);
+        else
+            strRet += strReply;
+    }, queueWork, nMaxHelpers);
+    return strRet;
 }
 
 /**
@@ -615,6 +721,23 @@ void RPCRunLater(const std::string& name, boost::function<void(void)> func, int6
     deadlineTimers.emplace(name, std::unique_ptr<RPCTimerBase>(timerInterface->NewTimer(func, nSeconds*1000)));
 }
 
+UniValue LatencyHistogramToJSON(const CLatencyHistogram& stats)
+{
+    UniValue histogram(UniValue::VARR);
+    int nLast = CLatencyHistogram::NUM_BUCKETS - 1;
+    while (nLast > 0 && stats.vBuckets[nLast] == 0)
+        nLast--;
+    for (int i = 0; i <= nLast; i++)
+        histogram.push_back(stats.vBuckets[i]);
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("count", stats.nCount));
+    obj.push_back(Pair("avg_us", stats.nCount ? stats.nTotalMicros / (int64_t)stats.nCount : 0));
+    obj.push_back(Pair("max_us", stats.nMaxMicros));
+    obj.push_back(Pair("histogram", histogram));
+    return obj;
+}
+
 int RPCSerializationFlags()
 {
     int flag = 0;
@@ -22,6 +22,7 @@
 static const unsigned int DEFAULT_RPC_SERIALIZE_VERSION = 1;
 
 class CRPCCommand;
+struct CLatencyHistogram;
 
 namespace RPCServer
 {
@@ -202,6 +203,8 @@ extern double GetPoSKernelPS();
 extern double GetEstimatedAnnualROI();
 extern std::string HelpExampleCli(const std::string& methodname, const std::string& args);
 extern std::string HelpExampleRpc(const std::string& methodname, const std::string& args);
+/** count, avg_us, max_us and the histogram with its empty tail buckets dropped */
+extern UniValue LatencyHistogramToJSON(const CLatencyHistogram& stats);
 
 extern UniValue getaddressmempool(const JSONRPCRequest &request);
 extern UniValue getaddressutxos(const JSONRPCRequest &request);
@@ -224,7 +227,17 @@ extern UniValue znsync(const JSONRPCRequest &request);
 bool StartRPC();
 void InterruptRPC();
 void StopRPC();
-std::string JSONRPCExecBatch(const UniValue& vReq);
+/**
+ * Execute a batch of requests and return the reply array. When queueWork is given, consecutive
+ * read-only requests are also executed by up to nMaxHelpers closures passed to it, which are
+ * expected to run on other threads. Replies stay in request order.
+ */
+std::string JSONRPCExecBatch(const UniValue& vReq, const std::function<bool(const std::function<void()>&)>& queueWork = nullptr, int nMaxHelpers = 0);
+/**
+ * Same, but the reply array is passed to writeReply piece by piece, in order, as soon as
+ * the replies at its front are done, instead of being joined into one string.
+ */
+void JSONRPCWriteBatch(const UniValue& vReq, const std::function<void(std::string&&)>& writeReply, const std::function<bool(const std::function<void()>&)>& queueWork = nullptr, int nMaxHelpers = 0);
 void RPCNotifyBlockChange(bool ibd, const CBlockIndex *);
 
 // Retrieves any serialization flags requested in command line argument
@@ -39,6 +39,15 @@ struct SaltedHasherImpl<uint256>
     }
 };
 
+template<>
+struct SaltedHasherImpl<uint160>
+{
+    static std::size_t CalcHash(const uint160& v, uint64_t k0, uint64_t k1)
+    {
+        return CSipHasher(k0, k1).Write(v.begin(), v.size()).Finalize();
+    }
+};
+
 struct SaltedHasherBase
 {
     /** Salt */
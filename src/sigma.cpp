@@ -6,7 +6,9 @@
 #include "util.h"
 #include "base58.h"
 #include "definition.h"
+#include "txdb.h"
 #include "txmempool.h"
+#include "ui_interface.h"
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
 #include "crypto/sha256.h"
@@ -16,14 +18,19 @@
 #include "indexnode-payments.h"
 #include "indexnode-sync.h"
 #include "primitives/zerocoin.h"
+#include "random.h"
+#include "hash.h"
+#include "cuckoocache.h"
 
 
 #include <atomic>
 #include <sstream>
 #include <chrono>
 
+#include <boost/filesystem.hpp>
 #include <boost/foreach.hpp>
 #include <boost/scope_exit.hpp>
+#include <boost/thread.hpp>
 
 #include <ios>
 
@@ -31,6 +38,101 @@ namespace sigma {
 
 static CSigmaState sigmaState;
 
+namespace {
+
+/**
+ * We're hashing a nonce into the entries themselves, so we don't need extra
+ * blinding in the set hash computation.
+ */
+class SigmaProofCacheHasher
+{
+public:
+    template <uint8_t hash_select>
+    uint32_t operator()(const uint256& key) const
+    {
+        static_assert(hash_select <8, "SigmaProofCacheHasher only has 8 hashes available.");
+        uint32_t u;
+        std::memcpy(&u, key.begin()+4*hash_select, 4);
+        return u;
+    }
+};
+
+/**
+ * Spend proofs that were already verified. A spend is checked when it enters the mempool, when a
+ * block template containing it is built and tested, and when its block is connected; only the
+ * first of these needs to run the proof verification.
+ */
+class CSigmaProofCache
+{
+private:
+    //! Entries are Hash(nonce || spend input || metadata || anonymity set || padding flag)
+    uint256 nonce;
+    typedef CuckooCache::cache<uint256, SigmaProofCacheHasher> map_type;
+    map_type setValid;
+    boost::shared_mutex cs_proofcache;
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+    uint32_t nMaxEntries;
+
+public:
+    CSigmaProofCache() : nHits(0), nMisses(0), nMaxEntries(0)
+    {
+        GetRandBytes(nonce.begin(), 32);
+    }
+
+    uint256 ComputeEntry(const CTxIn& txin, const SpendMetaData& metaData, const uint256& anonymitySetHash, bool fPadding) const
+    {
+        return (CHashWriter(SER_GETHASH, 0) << nonce << txin << metaData << anonymitySetHash << fPadding).GetHash();
+    }
+
+    bool Get(const uint256& entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_proofcache);
+        bool fFound = setValid.contains(entry, false);
+        (fFound ? nHits : nMisses)++;
+        return fFound;
+    }
+
+    void Set(const uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_proofcache);
+        setValid.insert(entry);
+    }
+
+    uint32_t setup_bytes(size_t n)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_proofcache);
+        nMaxEntries = setValid.setup_bytes(n);
+        return nMaxEntries;
+    }
+
+    SigmaProofCacheStats GetStats() const
+    {
+        SigmaProofCacheStats stats;
+        stats.nMaxEntries = nMaxEntries;
+        stats.nHits = nHits;
+        stats.nMisses = nMisses;
+        return stats;
+    }
+};
+
+static CSigmaProofCache proofCache;
+
+} // namespace
+
+void InitSigmaProofCache()
+{
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, GetArg("-maxsigmaproofcachesize", DEFAULT_MAX_SIGMA_PROOF_CACHE_SIZE)), MAX_MAX_SIGMA_PROOF_CACHE_SIZE) * ((size_t) 1 << 20);
+    size_t nElems = proofCache.setup_bytes(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for sigma proof cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >>20, nMaxCacheSize>>20, nElems);
+}
+
+SigmaProofCacheStats GetSigmaProofCacheStats()
+{
+    return proofCache.GetStats();
+}
+
 static bool CheckSigmaSpendSerial(
         CValidationState &state,
         CSigmaTxInfo *sigmaTxInfo,
@@ -105,13 +207,100 @@ std::pair<std::unique_ptr<sigma::CoinSpend>, uint32_t> ParseSigmaSpend(const CTx
     return std::make_pair(std::move(spend), groupId);
 }
 
+int64_t CSigmaSpendHeader::GetIntDenomination() const {
+    int64_t denom_value;
+    DenominationToInteger(denomination, denom_value);
+    return denom_value;
+}
+
+// Skip nCount serialized elements of nElementSize bytes each
+static void SkipSerializedElements(CDataStream& s, uint64_t nCount, size_t nElementSize)
+{
+    if (nCount > s.size() / nElementSize)
+        throw std::ios_base::failure("SkipSerializedElements(): end of data");
+    s.ignore(nCount * nElementSize);
+}
+
+// Mirrors CoinSpend::SerializationOp but only decodes the fields after the proof. Decoding the proof's
+// group elements is what makes a full parse expensive.
+static CSigmaSpendHeader ReadSigmaSpendHeader(CDataStream& s)
+{
+    const size_t geSize = GroupElement::memoryRequired();
+    const size_t scalarSize = Scalar::memoryRequired();
+
+    // SigmaPlusProof: B_, R1Proof (A_, C_, D_, f_, ZA_, ZC_), Gk_, z_
+    s.ignore(4 * geSize);
+    SkipSerializedElements(s, ReadCompactSize(s), scalarSize);
+    s.ignore(2 * scalarSize);
+    SkipSerializedElements(s, ReadCompactSize(s), geSize);
+    s.ignore(scalarSize);
+
+    CSigmaSpendHeader header;
+    s >> header.serial;
+    s >> header.version;
+
+    int64_t denomination_value = 0;
+    s >> denomination_value;
+    header.denomination = CoinDenomination::SIGMA_DENOM_1;
+    IntegerToDenomination(denomination_value, header.denomination);
+
+    s >> header.accumulatorBlockHash;
+
+    // ecdsaPubkey and ecdsaSignature, skipped so truncated spends fail like they do in a full parse
+    SkipSerializedElements(s, ReadCompactSize(s), 1);
+    SkipSerializedElements(s, ReadCompactSize(s), 1);
+
+    header.groupId = 0;
+    return header;
+}
+
+CSigmaSpendHeader ParseSigmaSpendHeader(const CTxIn& in)
+{
+    uint32_t groupId = in.prevout.n;
+
+    if (groupId < 1 || groupId >= INT_MAX || in.scriptSig.size() < 1) {
+        throw CBadTxIn();
+    }
+
+    CDataStream serialized(
+        std::vector<unsigned char>(in.scriptSig.begin() + 1, in.scriptSig.end()),
+        SER_NETWORK,
+        PROTOCOL_VERSION
+    );
+
+    CSigmaSpendHeader header = ReadSigmaSpendHeader(serialized);
+    header.groupId = groupId;
+    return header;
+}
+
+bool GetSigmaSpendSummary(const CTransaction& tx, CSigmaSpendSummary& summaryRet)
+{
+    summaryRet = CSigmaSpendSummary();
+    if (!tx.IsSigmaSpend())
+        return false;
+
+    try {
+        for (const CTxIn& txin : tx.vin) {
+            if (!txin.IsSigmaSpend())
+                return false;
+            summaryRet.spends.push_back(ParseSigmaSpendHeader(txin));
+            summaryRet.nAmount += summaryRet.spends.back().GetIntDenomination();
+        }
+    } catch (const std::ios_base::failure&) {
+        return false;
+    } catch (const CBadTxIn&) {
+        return false;
+    }
+    return true;
+}
+
 // This function will not report an error only if the transaction is sigma spend.
 CAmount GetSpendAmount(const CTxIn& in) {
     if (in.IsSigmaSpend()) {
-        std::unique_ptr<sigma::CoinSpend> spend;
+        CSigmaSpendHeader header;
 
         try {
-            std::tie(spend, std::ignore) = ParseSigmaSpend(in);
+            header = ParseSigmaSpendHeader(in);
         } catch (const std::ios_base::failure& e) {
             LogPrintf("GetSpendAmount: io error %s\n", e.what());
             return 0;
@@ -120,7 +309,7 @@ CAmount GetSpendAmount(const CTxIn& in) {
             return 0;
         }
 
-        return spend->getIntDenomination();
+        return header.GetIntDenomination();
     }
     return 0;
 }
@@ -240,7 +429,7 @@ bool CheckSigmaSpendTransaction(
         }
         txHashForMetadata = txTemp.GetHash();
 
-        LogPrintf("CheckSigmaSpendTransaction: tx version=%d, tx metadata hash=%s, serial=%s\n",
+        LogPrint("sigma", "CheckSigmaSpendTransaction: tx version=%d, tx metadata hash=%s, serial=%s\n",
                 spend->getVersion(), txHashForMetadata.ToString(),
                 spend->getCoinSerialNumber().tostring());
 
@@ -270,22 +459,6 @@ bool CheckSigmaSpendTransaction(
         while (index != coinGroup.firstBlock && index->GetBlockHash() != accumulatorBlockHash)
             index = index->pprev;
 
-        // Build a vector with all the public coins with given denomination and accumulator id before
-        // the block on which the spend occured.
-        // This list of public coins is required by function "Verify" of CoinSpend.
-        std::vector<sigma::PublicCoin> anonymity_set;
-        while(true) {
-            if (index->sigmaMintedPubCoins.count(denominationAndId) > 0) {
-                BOOST_FOREACH(const sigma::PublicCoin& pubCoinValue,
-                        index->sigmaMintedPubCoins[denominationAndId]) {
-                        anonymity_set.push_back(pubCoinValue);
-                }
-            }
-            if (index == coinGroup.firstBlock)
-                break;
-            index = index->pprev;
-        }
-
         bool fPadding = spend->getVersion() >= ZEROCOIN_TX_VERSION_3_1;
         if (!isVerifyDB) {
             bool fShouldPad = nHeight >= params.nSigmaPaddingBlock;
@@ -293,7 +466,38 @@ bool CheckSigmaSpendTransaction(
                 return state.DoS(1, error("Incorrect sigma spend transaction version"));
         }
 
-        passVerify = spend->Verify(anonymity_set, newMetaData, fPadding);
+        // The anonymity set is made of the coins minted from coinGroup.firstBlock up to index, so those
+        // two blocks identify it.
+        uint256 anonymitySetHash = (CHashWriter(SER_GETHASH, 0)
+                << (int)targetDenominations[vinIndex] << coinGroupId
+                << index->GetBlockHash() << coinGroup.firstBlock->GetBlockHash()).GetHash();
+        uint256 proofCacheEntry = proofCache.ComputeEntry(txin, newMetaData, anonymitySetHash, fPadding);
+
+        if (proofCache.Get(proofCacheEntry)) {
+            passVerify = true;
+        }
+        else {
+            // Build a vector with all the public coins with given denomination and accumulator id before
+            // the block on which the spend occured.
+            // This list of public coins is required by function "Verify" of CoinSpend.
+            std::vector<sigma::PublicCoin> anonymity_set;
+            while(true) {
+                if (index->sigmaMintedPubCoins.count(denominationAndId) > 0) {
+                    BOOST_FOREACH(const sigma::PublicCoin& pubCoinValue,
+                            index->sigmaMintedPubCoins[denominationAndId]) {
+                            anonymity_set.push_back(pubCoinValue);
+                    }
+                }
+                if (index == coinGroup.firstBlock)
+                    break;
+                index = index->pprev;
+            }
+
+            passVerify = spend->Verify(anonymity_set, newMetaData, fPadding);
+            if (passVerify)
+                proofCache.Set(proofCacheEntry);
+        }
+
         if (passVerify) {
             Scalar serial = spend->getCoinSerialNumber();
             // do not check for duplicates in case we've seen exact copy of this tx in this block before
@@ -351,8 +555,8 @@ bool CheckSigmaMintTransaction(
         CSigmaTxInfo *sigmaTxInfo) {
     secp_primitives::GroupElement pubCoinValue;
 
-    LogPrintf("CheckSigmaMintTransaction txHash = %s\n", txout.GetHash().ToString());
-    LogPrintf("nValue = %d\n", txout.nValue);
+    LogPrint("sigma", "CheckSigmaMintTransaction txHash = %s\n", txout.GetHash().ToString());
+    LogPrint("sigma", "nValue = %d\n", txout.nValue);
 
     try {
         pubCoinValue = ParseSigmaMintScript(txout.scriptPubKey);
@@ -511,17 +715,18 @@ void RemoveSigmaSpendsReferencingBlock(CTxMemPool& pool, CBlockIndex* blockIndex
         if (tx.IsSigmaSpend()) {
             // Run over all the inputs, check if their Accumulator block hash is equal to
             // block removed. If any one is equal, remove txn from mempool.
-            for (const CTxIn& txin : tx.vin) {
-                if (txin.IsSigmaSpend()) {
-                    std::unique_ptr<sigma::CoinSpend> spend;
-                    uint32_t pubcoinId;
-                    std::tie(spend, pubcoinId) = ParseSigmaSpend(txin);
-                    uint256 accumulatorBlockHash = spend->getAccumulatorBlockHash();
-                    if (accumulatorBlockHash == blockIndex->GetBlockHash()) {
-                        // Do not remove transaction immediately, that will invalidate iterator mi.
-                        txn_to_remove.push_back(tx);
-                        break;
-                    }
+            // Spends in the mempool were parsed when they were accepted
+            const CSigmaSpendSummary* summary = mi->GetSigmaSpendSummary();
+            CSigmaSpendSummary parsed;
+            if (!summary) {
+                GetSigmaSpendSummary(tx, parsed);
+                summary = &parsed;
+            }
+            for (const CSigmaSpendHeader& spend : summary->spends) {
+                if (spend.accumulatorBlockHash == blockIndex->GetBlockHash()) {
+                    // Do not remove transaction immediately, that will invalidate iterator mi.
+                    txn_to_remove.push_back(tx);
+                    break;
                 }
             }
         }
@@ -553,8 +758,7 @@ Scalar GetSigmaSpendSerialNumber(const CTransaction &tx, const CTxIn &txin) {
                 (const char *)&*(txin.scriptSig.begin() + 1),
                 (const char *)&*txin.scriptSig.end(),
                 SER_NETWORK, PROTOCOL_VERSION);
-        sigma::CoinSpend spend(sigma::Params::get_default(), serializedCoinSpend);
-        return spend.getCoinSerialNumber();
+        return ReadSigmaSpendHeader(serializedCoinSpend).serial;
     }
     catch (const std::ios_base::failure &) {
         return Scalar(uint64_t(0));
@@ -575,8 +779,7 @@ CAmount GetSigmaSpendInput(const CTransaction &tx) {
                     (const char *)&*(txin.scriptSig.begin() + 1),
                     (const char *)&*txin.scriptSig.end(),
                     SER_NETWORK, PROTOCOL_VERSION);
-            sigma::CoinSpend spend(sigma::Params::get_default(), serializedCoinSpend);
-            sum += spend.getIntDenomination();
+            sum += ReadSigmaSpendHeader(serializedCoinSpend).GetIntDenomination();
         }
         return sum;
     }
@@ -660,6 +863,16 @@ bool GetOutPointFromBlock(COutPoint& outPoint, const GroupElement &pubCoinValue,
     return false;
 }
 
+// Look up the outpoint of a mint in the sigma index. Mints indexed while their block was pruned have none
+static bool GetOutPointFromIndex(COutPoint& outPoint, const uint256 &pubCoinValueHash) {
+    CSigmaMintIndexKey key;
+    CSigmaMintIndexValue value;
+    if (!pblocktree || !pblocktree->ReadSigmaMint(pubCoinValueHash, key, value) || value.outpoint.IsNull())
+        return false;
+    outPoint = value.outpoint;
+    return true;
+}
+
 bool GetOutPoint(COutPoint& outPoint, const sigma::PublicCoin &pubCoin) {
 
     sigma::CSigmaState *sigmaState = sigma::CSigmaState::GetState();
@@ -670,16 +883,24 @@ bool GetOutPoint(COutPoint& outPoint, const sigma::PublicCoin &pubCoin) {
     if(mintHeight==-1 && coinId==-1)
         return false;
 
+    if (GetOutPointFromIndex(outPoint, pubCoin.getValueHash()))
+        return true;
+
     // get block containing mint
     CBlockIndex *mintBlock = chainActive[mintHeight];
-    CBlock block;
-    if(!ReadBlockFromDisk(block, mintBlock, ::Params().GetConsensus()))
+    std::shared_ptr<const CBlock> pblock = ReadBlockFromDiskCached(mintBlock, ::Params().GetConsensus());
+    if (!pblock) {
         LogPrintf("can't read block from disk.\n");
+        return false;
+    }
 
-    return GetOutPointFromBlock(outPoint, pubCoin.getValue(), block);
+    return GetOutPointFromBlock(outPoint, pubCoin.getValue(), *pblock);
 }
 
 bool GetOutPoint(COutPoint& outPoint, const GroupElement &pubCoinValue) {
+    if (GetOutPointFromIndex(outPoint, primitives::GetPubCoinValueHash(pubCoinValue)))
+        return true;
+
     int mintHeight = 0;
     int coinId = 0;
 
@@ -700,14 +921,19 @@ bool GetOutPoint(COutPoint& outPoint, const GroupElement &pubCoinValue) {
 
     // get block containing mint
     CBlockIndex *mintBlock = chainActive[mintHeight];
-    CBlock block;
-    if(!ReadBlockFromDisk(block, mintBlock, ::Params().GetConsensus()))
+    std::shared_ptr<const CBlock> pblock = ReadBlockFromDiskCached(mintBlock, ::Params().GetConsensus());
+    if (!pblock) {
         LogPrintf("can't read block from disk.\n");
+        return false;
+    }
 
-    return GetOutPointFromBlock(outPoint, pubCoinValue, block);
+    return GetOutPointFromBlock(outPoint, pubCoinValue, *pblock);
 }
 
 bool GetOutPoint(COutPoint& outPoint, const uint256 &pubCoinValueHash) {
+    if (GetOutPointFromIndex(outPoint, pubCoinValueHash))
+        return true;
+
     GroupElement pubCoinValue;
     sigma::CSigmaState *sigmaState = sigma::CSigmaState::GetState();
     if(!sigmaState->HasCoinHash(pubCoinValue, pubCoinValueHash)){
@@ -717,12 +943,115 @@ bool GetOutPoint(COutPoint& outPoint, const uint256 &pubCoinValueHash) {
     return GetOutPoint(outPoint, pubCoinValue);
 }
 
-bool BuildSigmaStateFromIndex(CChain *chain) {
-    for (CBlockIndex *blockIndex = chain->Genesis(); blockIndex; blockIndex=chain->Next(blockIndex))
-    {
-        sigmaState.AddBlock(blockIndex);
+void GetSigmaIndexEntries(const CBlockIndex *pindex, const CBlock *pblock, CSigmaIndexBlock &entries) {
+    std::map<uint256, COutPoint> outPoints;
+    if (pblock) {
+        BOOST_FOREACH(const CTransactionRef &tx, pblock->vtx) {
+            for (uint32_t n = 0; n < tx->vout.size(); n++) {
+                const CScript &script = tx->vout[n].scriptPubKey;
+                // The serialized coin follows the OP_SIGMAMINT opcode, see GetOutPointFromBlock
+                if (!script.IsSigmaMint() || script.size() < 1 + GroupElement::memoryRequired())
+                    continue;
+                vector<unsigned char> coin_serialised(script.begin() + 1, script.end());
+                GroupElement pubCoinValue;
+                pubCoinValue.deserialize(&coin_serialised[0]);
+                outPoints[primitives::GetPubCoinValueHash(pubCoinValue)] = COutPoint(tx->GetHash(), n);
+            }
+        }
     }
-    // DEBUG
+
+    for (const auto &group : pindex->sigmaMintedPubCoins) {
+        int64_t denomination;
+        DenominationToInteger(group.first.first, denomination);
+        unsigned int n = 0;
+        for (const sigma::PublicCoin &coin : group.second) {
+            CSigmaMintIndexValue value;
+            value.pubCoin = coin.getValue();
+            auto it = outPoints.find(coin.getValueHash());
+            if (it != outPoints.end())
+                value.outpoint = it->second;
+            entries.mints.push_back(std::make_pair(CSigmaMintIndexKey(denomination, group.first.second, pindex->nHeight, n++), value));
+        }
+    }
+
+    for (const auto &spend : pindex->sigmaSpentSerials) {
+        CSigmaSpendIndexValue value;
+        value.serial = spend.first;
+        value.blockHeight = pindex->nHeight;
+        DenominationToInteger(spend.second.denomination, value.denomination);
+        value.coinGroupId = spend.second.coinGroupId;
+        entries.spends.push_back(value);
+    }
+}
+
+// Add the blocks of chain from pindexStart up to the tip to the sigma index, which is at hashFrom
+static bool ConnectSigmaIndex(CChain *chain, const CBlockIndex *pindexStart, uint256 hashFrom) {
+    for (const CBlockIndex *pindex = pindexStart; pindex; pindex = chain->Next(pindex)) {
+        boost::this_thread::interruption_point();
+        if (pindex->sigmaMintedPubCoins.empty() && pindex->sigmaSpentSerials.empty())
+            continue;
+
+        // Only mints need the block, for their outpoints
+        CBlock block;
+        bool fHaveBlock = !pindex->sigmaMintedPubCoins.empty() && (pindex->nStatus & BLOCK_HAVE_DATA) &&
+                ReadBlockFromDisk(block, pindex, ::Params().GetConsensus());
+
+        CSigmaIndexBlock entries;
+        GetSigmaIndexEntries(pindex, fHaveBlock ? &block : NULL, entries);
+        if (!pblocktree->UpdateSigmaIndex(entries, false, hashFrom, pindex->GetBlockHash()))
+            return false;
+        hashFrom = pindex->GetBlockHash();
+    }
+    return pblocktree->UpdateSigmaIndex(CSigmaIndexBlock(), false, hashFrom, chain->Tip()->GetBlockHash());
+}
+
+bool SyncSigmaIndex(CChain *chain) {
+    const CBlockIndex *tip = chain->Tip();
+    uint256 hashBestBlock;
+    bool fHaveIndex = pblocktree->ReadSigmaIndexBestBlock(hashBestBlock);
+    if (!tip || (fHaveIndex && hashBestBlock == tip->GetBlockHash()))
+        return true;
+
+    // An unclean shutdown leaves the index ahead of or behind the chain state. Undo the blocks from the index down to
+    // the fork point and add the ones from there to the tip. The entries come from the sigma data in the block index,
+    // which blocks connected after the last flush of the block index don't have, the index is rebuilt then.
+    if (fHaveIndex) {
+        BlockMap::const_iterator mi = mapBlockIndex.find(hashBestBlock);
+        const CBlockIndex *pindexIndexed = mi != mapBlockIndex.end() ? mi->second : NULL;
+        const CBlockIndex *pindexFork = pindexIndexed ? chain->FindFork(pindexIndexed) : NULL;
+        bool fCanUndo = pindexFork != NULL;
+        for (const CBlockIndex *pindex = pindexIndexed; fCanUndo && pindex != pindexFork; pindex = pindex->pprev)
+            fCanUndo = pindex->IsValid(BLOCK_VALID_SCRIPTS);
+
+        if (fCanUndo) {
+            LogPrintf("%s: moving sigma index from height %d to %d\n", __func__, pindexIndexed->nHeight, tip->nHeight);
+            uint256 hashFrom = hashBestBlock;
+            for (const CBlockIndex *pindex = pindexIndexed; pindex != pindexFork; pindex = pindex->pprev) {
+                boost::this_thread::interruption_point();
+                if (pindex->sigmaMintedPubCoins.empty() && pindex->sigmaSpentSerials.empty())
+                    continue;
+
+                CSigmaIndexBlock entries;
+                GetSigmaIndexEntries(pindex, NULL, entries);
+                if (!pblocktree->UpdateSigmaIndex(entries, true, hashFrom, pindex->pprev->GetBlockHash()))
+                    return false;
+                hashFrom = pindex->pprev->GetBlockHash();
+            }
+            return ConnectSigmaIndex(chain, chain->Next(pindexFork), hashFrom);
+        }
+    }
+
+    // The index is missing (older database) or can't be moved to the tip
+    LogPrintf("%s: rebuilding sigma index\n", __func__);
+    uiInterface.InitMessage(_("Rebuilding sigma index..."));
+    if (!pblocktree->WipeSigmaIndex())
+        return false;
+
+    // Nothing is written yet, so the first update doesn't check where the index is
+    return ConnectSigmaIndex(chain, chain->Genesis(), uint256());
+}
+
+static void LogLatestCoinIds() {
     LogPrintf(
         "Latest IDs for sigma coin groups are %d, %d, %d, %d, %d\n",
         sigmaState.GetLatestCoinID(CoinDenomination::SIGMA_DENOM_0_1),
@@ -730,6 +1059,164 @@ bool BuildSigmaStateFromIndex(CChain *chain) {
         sigmaState.GetLatestCoinID(CoinDenomination::SIGMA_DENOM_1),
         sigmaState.GetLatestCoinID(CoinDenomination::SIGMA_DENOM_10),
         sigmaState.GetLatestCoinID(CoinDenomination::SIGMA_DENOM_100));
+}
+
+bool BuildSigmaStateFromIndex(CChain *chain) {
+    for (CBlockIndex *blockIndex = chain->Genesis(); blockIndex; blockIndex=chain->Next(blockIndex))
+    {
+        sigmaState.AddBlock(blockIndex);
+    }
+    // DEBUG
+    LogLatestCoinIds();
+    return true;
+}
+
+static const int SIGMA_STATE_SNAPSHOT_VERSION = 1;
+
+static boost::filesystem::path GetSigmaStateSnapshotPath() {
+    return GetDataDir() / "sigmastate.dat";
+}
+
+bool WriteSigmaStateSnapshot(const CBlockIndex *tip) {
+    if (!tip)
+        return false;
+
+    CDataStream ssState(SER_DISK, CLIENT_VERSION);
+    SerializeSigmaStateSnapshot(tip, ssState);
+    return WriteSigmaStateSnapshotFile(ssState);
+}
+
+void SerializeSigmaStateSnapshot(const CBlockIndex *tip, CDataStream &ssState) {
+    // serialize the state keyed by the tip, checksum data up to that point, then append csum
+    ssState << FLATDATA(::Params().MessageStart());
+    ssState << SIGMA_STATE_SNAPSHOT_VERSION;
+    ssState << tip->GetBlockHash();
+    ssState << tip->nHeight;
+    sigmaState.WriteSnapshot(ssState);
+    uint256 hash = Hash(ssState.begin(), ssState.end());
+    ssState << hash;
+}
+
+bool WriteSigmaStateSnapshotFile(const CDataStream &ssState) {
+    // Generate random temporary filename
+    unsigned short randv = 0;
+    GetRandBytes((unsigned char*)&randv, sizeof(randv));
+    std::string tmpfn = strprintf("sigmastate.dat.%04x", randv);
+
+    // open temp output file, and associate with CAutoFile
+    boost::filesystem::path pathTmp = GetDataDir() / tmpfn;
+    FILE *file = fopen(pathTmp.string().c_str(), "wb");
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        return error("%s: Failed to open file %s", __func__, pathTmp.string());
+
+    // Write and commit header, data
+    try {
+        fileout << ssState;
+    }
+    catch (const std::exception& e) {
+        return error("%s: Serialize or I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout.Get());
+    fileout.fclose();
+
+    // replace existing sigmastate.dat, if any, with new sigmastate.dat.XXXX
+    if (!RenameOver(pathTmp, GetSigmaStateSnapshotPath()))
+        return error("%s: Rename-into-place failed", __func__);
+
+    return true;
+}
+
+static bool ReadSigmaStateSnapshot(CChain *chain, CBlockIndex *&snapshotTip) {
+    boost::filesystem::path path = GetSigmaStateSnapshotPath();
+    if (!boost::filesystem::exists(path))
+        return false;
+
+    // open input file, and associate with CAutoFile
+    FILE *file = fopen(path.string().c_str(), "rb");
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: Failed to open file %s", __func__, path.string());
+
+    // use file size to size memory buffer
+    uint64_t fileSize = boost::filesystem::file_size(path);
+    uint64_t dataSize = 0;
+    // Don't try to resize to a negative number if file is small
+    if (fileSize >= sizeof(uint256))
+        dataSize = fileSize - sizeof(uint256);
+    std::vector<unsigned char> vchData;
+    vchData.resize(dataSize);
+    uint256 hashIn;
+
+    // read data and checksum from file
+    try {
+        filein.read((char *)vchData.data(), dataSize);
+        filein >> hashIn;
+    }
+    catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+    filein.fclose();
+
+    CDataStream ssState(vchData, SER_DISK, CLIENT_VERSION);
+
+    // verify stored checksum matches input data
+    uint256 hashTmp = Hash(ssState.begin(), ssState.end());
+    if (hashIn != hashTmp)
+        return error("%s: Checksum mismatch, data corrupted", __func__);
+
+    unsigned char pchMsgTmp[4];
+    int nVersion;
+    uint256 tipHash;
+    int tipHeight;
+    try {
+        ssState >> FLATDATA(pchMsgTmp);
+        if (memcmp(pchMsgTmp, ::Params().MessageStart(), sizeof(pchMsgTmp)))
+            return error("%s: Invalid network magic number", __func__);
+
+        ssState >> nVersion;
+        if (nVersion != SIGMA_STATE_SNAPSHOT_VERSION) {
+            LogPrintf("%s: unsupported snapshot version %d\n", __func__, nVersion);
+            return false;
+        }
+
+        ssState >> tipHash >> tipHeight;
+    }
+    catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+
+    // The snapshot is only usable if it was taken at a block which is still in the active chain
+    BlockMap::const_iterator mi = mapBlockIndex.find(tipHash);
+    if (mi == mapBlockIndex.end() || !chain->Contains(mi->second) || mi->second->nHeight != tipHeight) {
+        LogPrintf("%s: snapshot block %s is not in the active chain\n", __func__, tipHash.ToString());
+        return false;
+    }
+
+    if (!sigmaState.ReadSnapshot(ssState, chain)) {
+        sigmaState.Reset();
+        return error("%s: snapshot at block %s is inconsistent with the block index", __func__, tipHash.ToString());
+    }
+
+    snapshotTip = mi->second;
+    return true;
+}
+
+bool BuildSigmaStateFromSnapshot(CChain *chain) {
+    CBlockIndex *snapshotTip = NULL;
+    if (!ReadSigmaStateSnapshot(chain, snapshotTip)) {
+        LogPrintf("%s: no usable snapshot, rebuilding sigma state from the block index\n", __func__);
+        return BuildSigmaStateFromIndex(chain);
+    }
+
+    LogPrintf("%s: loaded sigma state snapshot at height %d, replaying %d blocks\n", __func__,
+        snapshotTip->nHeight, chain->Height() - snapshotTip->nHeight);
+    for (CBlockIndex *blockIndex = chain->Next(snapshotTip); blockIndex; blockIndex=chain->Next(blockIndex))
+    {
+        sigmaState.AddBlock(blockIndex);
+    }
+    // DEBUG
+    LogLatestCoinIds();
     return true;
 }
 
@@ -885,7 +1372,7 @@ void CSigmaState::AddMintsToStateAndBlockIndex(
         for (const auto& mint : mintsWithThisDenom) {
             containers.AddMint(mint, CMintedCoinInfo::make(denomination, mintCoinGroupId, index->nHeight));
 
-            LogPrintf("AddMintsToStateAndBlockIndex: mint added denomination=%d, id=%d\n", denomination, mintCoinGroupId);
+            LogPrint("sigma", "AddMintsToStateAndBlockIndex: mint added denomination=%d, id=%d\n", denomination, mintCoinGroupId);
             index->sigmaMintedPubCoins[{denomination, mintCoinGroupId}].push_back(mint);
         }
     }
@@ -996,6 +1483,14 @@ bool CSigmaState::IsUsedCoinSerial(const Scalar &coinSerial) {
 }
 
 bool CSigmaState::IsUsedCoinSerialHash(Scalar &coinSerial, const uint256 &coinSerialHash) {
+    // The sigma index finds the serial with a point lookup, the spend set only confirms it.
+    // An index miss (e.g. the index is still catching up) falls back to scanning the spend set.
+    CSigmaSpendIndexValue spend;
+    if (pblocktree && pblocktree->ReadSigmaSpend(coinSerialHash, spend) && IsUsedCoinSerial(spend.serial)) {
+        coinSerial = spend.serial;
+        return true;
+    }
+
     for ( auto it = GetSpends().begin(); it != GetSpends().end(); ++it ){
         if(primitives::GetSerialHash(it->first)==coinSerialHash){
             coinSerial = it->first;
@@ -1010,6 +1505,17 @@ bool CSigmaState::HasCoin(const sigma::PublicCoin& pubCoin) {
 }
 
 bool CSigmaState::HasCoinHash(GroupElement &pubCoinValue, const uint256 &pubCoinValueHash) {
+    // Same as above: try the sigma index first, scan the mint set on a miss
+    CSigmaMintIndexKey key;
+    CSigmaMintIndexValue value;
+    CoinDenomination denomination;
+    if (pblocktree && pblocktree->ReadSigmaMint(pubCoinValueHash, key, value) &&
+            IntegerToDenomination(key.denomination, denomination) &&
+            HasCoin(sigma::PublicCoin(value.pubCoin, denomination))) {
+        pubCoinValue = value.pubCoin;
+        return true;
+    }
+
     for ( auto it = GetMints().begin(); it != GetMints().end(); ++it ){
         const sigma::PublicCoin & pubCoin = (*it).first;
         if(pubCoin.getValueHash()==pubCoinValueHash){
@@ -1020,6 +1526,38 @@ bool CSigmaState::HasCoinHash(GroupElement &pubCoinValue, const uint256 &pubCoin
     return false;
 }
 
+void CSigmaState::GetMintedCoinsByHash(const std::set<uint256> &pubCoinValueHashes,
+                                       std::map<uint256, std::pair<sigma::PublicCoin, CMintedCoinInfo>> &result) {
+    if (pubCoinValueHashes.empty())
+        return;
+
+    // Point lookups in the sigma index, the mint set confirms each coin is (still) minted on the active chain
+    if (pblocktree) {
+        for (const uint256 &pubCoinValueHash : pubCoinValueHashes) {
+            CSigmaMintIndexKey key;
+            CSigmaMintIndexValue value;
+            CoinDenomination denomination;
+            if (!pblocktree->ReadSigmaMint(pubCoinValueHash, key, value) ||
+                    !IntegerToDenomination(key.denomination, denomination))
+                continue;
+            auto mint = GetMints().find(sigma::PublicCoin(value.pubCoin, denomination));
+            if (mint != GetMints().end())
+                result.insert(std::make_pair(pubCoinValueHash, *mint));
+        }
+        if (result.size() == pubCoinValueHashes.size())
+            return;
+    }
+
+    // Scan the mint set for whatever the index didn't resolve
+    for (auto const & mint : GetMints()) {
+        if (pubCoinValueHashes.count(mint.first.getValueHash()) && !result.count(mint.first.getValueHash())) {
+            result.insert(std::make_pair(mint.first.getValueHash(), mint));
+            if (result.size() == pubCoinValueHashes.size())
+                break;
+        }
+    }
+}
+
 int CSigmaState::GetCoinSetForSpend(
         CChain *chain,
         int maxHeight,
@@ -1129,6 +1667,94 @@ void CSigmaState::Reset() {
     containers.Reset();
 }
 
+void CSigmaState::WriteSnapshot(CDataStream &stream) const {
+    WriteCompactSize(stream, latestCoinIds.size());
+    for (auto const & id : latestCoinIds) {
+        stream << int64_t(id.first);
+        stream << id.second;
+    }
+
+    WriteCompactSize(stream, coinGroups.size());
+    for (auto const & group : coinGroups) {
+        stream << int64_t(group.first.first);
+        stream << group.first.second;
+        stream << group.second.firstBlock->GetBlockHash();
+        stream << group.second.lastBlock->GetBlockHash();
+        stream << group.second.nCoins;
+    }
+
+    WriteCompactSize(stream, GetMints().size());
+    for (auto const & mint : GetMints()) {
+        stream << mint.first;
+        stream << int64_t(mint.second.denomination);
+        stream << mint.second.coinGroupId;
+        stream << mint.second.nHeight;
+    }
+
+    WriteCompactSize(stream, GetSpends().size());
+    for (auto const & spend : GetSpends()) {
+        stream << spend.first;
+        stream << spend.second;
+    }
+}
+
+bool CSigmaState::ReadSnapshot(CDataStream &stream, CChain *chain) {
+    Reset();
+
+    auto getBlock = [chain](uint256 const & hash) -> CBlockIndex * {
+        BlockMap::const_iterator mi = mapBlockIndex.find(hash);
+        if (mi == mapBlockIndex.end() || !chain->Contains(mi->second))
+            return NULL;
+        return mi->second;
+    };
+
+    try {
+        int64_t denomination;
+        uint64_t size = ReadCompactSize(stream);
+        for (uint64_t i = 0; i < size; i++) {
+            int id;
+            stream >> denomination >> id;
+            latestCoinIds[CoinDenomination(denomination)] = id;
+        }
+
+        size = ReadCompactSize(stream);
+        for (uint64_t i = 0; i < size; i++) {
+            int id;
+            uint256 firstBlockHash, lastBlockHash;
+            SigmaCoinGroupInfo group;
+            stream >> denomination >> id >> firstBlockHash >> lastBlockHash >> group.nCoins;
+            group.firstBlock = getBlock(firstBlockHash);
+            group.lastBlock = getBlock(lastBlockHash);
+            if (!group.firstBlock || !group.lastBlock)
+                return false;
+            coinGroups[std::make_pair(CoinDenomination(denomination), id)] = group;
+        }
+
+        // mints go first so that the surge condition never sees spends without their mints
+        size = ReadCompactSize(stream);
+        for (uint64_t i = 0; i < size; i++) {
+            sigma::PublicCoin pubCoin;
+            CMintedCoinInfo info;
+            stream >> pubCoin >> denomination >> info.coinGroupId >> info.nHeight;
+            info.denomination = CoinDenomination(denomination);
+            containers.AddMint(pubCoin, info);
+        }
+
+        size = ReadCompactSize(stream);
+        for (uint64_t i = 0; i < size; i++) {
+            Scalar serial;
+            CSpendCoinInfo info;
+            stream >> serial >> info;
+            containers.AddSpend(serial, info);
+        }
+    }
+    catch (const std::exception& e) {
+        return error("%s: Deserialize error - %s", __func__, e.what());
+    }
+
+    return true;
+}
+
 CSigmaState* CSigmaState::GetState() {
     return &sigmaState;
 }
@@ -13,6 +13,7 @@
 #include <unordered_map>
 #include <functional>
 #include "coin_containers.h"
+#include "sigmaindex.h"
 
 //tests
 namespace sigma_mintspend_many { class sigma_mintspend_many; }
@@ -44,13 +45,54 @@ public:
     void Complete();
 };
 
+// Size of the cache of verified spend proofs in MiB, each entry takes 32 bytes
+static const int64_t DEFAULT_MAX_SIGMA_PROOF_CACHE_SIZE = 4;
+static const int64_t MAX_MAX_SIGMA_PROOF_CACHE_SIZE = 1024;
+
+struct SigmaProofCacheStats {
+    uint32_t nMaxEntries;
+    uint64_t nHits;
+    uint64_t nMisses;
+};
+
+// To be called once at startup, before any spend is verified
+void InitSigmaProofCache();
+SigmaProofCacheStats GetSigmaProofCacheStats();
+
 bool IsSigmaAllowed();
 bool IsSigmaAllowed(int height);
 
 bool IsRemintWindow(int height);
 
+// Fields of a sigma spend input that can be read without deserializing its proof
+struct CSigmaSpendHeader {
+    Scalar serial;
+    unsigned int version;
+    CoinDenomination denomination;
+    uint256 accumulatorBlockHash;
+    uint32_t groupId;
+
+    int64_t GetIntDenomination() const;
+};
+
+// Parsed sigma spend inputs of a transaction, computed once when it enters the mempool
+struct CSigmaSpendSummary {
+    std::vector<CSigmaSpendHeader> spends;
+    CAmount nAmount = 0;
+};
+
 secp_primitives::GroupElement ParseSigmaMintScript(const CScript& script);
 std::pair<std::unique_ptr<sigma::CoinSpend>, uint32_t> ParseSigmaSpend(const CTxIn& in);
+/*
+ * Read the header of a sigma spend input, skipping over the proof. Accepts and rejects exactly the
+ * inputs ParseSigmaSpend does, throwing CBadTxIn or std::ios_base::failure.
+ */
+CSigmaSpendHeader ParseSigmaSpendHeader(const CTxIn& in);
+/*
+ * Parse every input of a sigma spend transaction. Returns false if tx isn't a sigma spend or any of
+ * its inputs is malformed.
+ */
+bool GetSigmaSpendSummary(const CTransaction& tx, CSigmaSpendSummary& summaryRet);
 CAmount GetSpendAmount(const CTxIn& in);
 CAmount GetSpendAmount(const CTransaction& tx);
 bool CheckSigmaBlock(CValidationState &state, const CBlock& block);
@@ -84,6 +126,36 @@ bool GetOutPoint(COutPoint& outPoint, const uint256 &pubCoinValueHash);
 
 bool BuildSigmaStateFromIndex(CChain *chain);
 
+/*
+ * Load the sigma state from the snapshot written at the last flush and replay only the blocks connected after it.
+ * Falls back to BuildSigmaStateFromIndex if the snapshot is missing, corrupted or doesn't belong to the chain.
+ */
+bool BuildSigmaStateFromSnapshot(CChain *chain);
+
+/*
+ * Write the current sigma state into the snapshot file. tip must be the block the state corresponds to.
+ */
+bool WriteSigmaStateSnapshot(const CBlockIndex *tip);
+
+/*
+ * The two halves of WriteSigmaStateSnapshot, so that the file can be written later without cs_main. The state is
+ * serialized at tip, writing the file doesn't touch it.
+ */
+void SerializeSigmaStateSnapshot(const CBlockIndex *tip, CDataStream &ssState);
+bool WriteSigmaStateSnapshotFile(const CDataStream &ssState);
+
+/*
+ * Collect the sigma index entries of a block from its sigma data in the block index. The outpoints of the mints are
+ * only filled in if pblock is given.
+ */
+void GetSigmaIndexEntries(const CBlockIndex *pindex, const CBlock *pblock, CSigmaIndexBlock &entries);
+
+/*
+ * Bring the on-disk sigma index to the chain tip. Blocks between the index and the tip are undone or added, the
+ * index is only rebuilt from genesis if it is missing or its block isn't known with sigma data.
+ */
+bool SyncSigmaIndex(CChain *chain);
+
 Scalar GetSigmaSpendSerialNumber(const CTransaction &tx, const CTxIn &txin);
 CAmount GetSigmaSpendInput(const CTransaction &tx);
 
@@ -140,6 +212,9 @@ public:
     bool HasCoin(const sigma::PublicCoin& pubCoin);
     // Query if there is a coin with given hash of a pubCoin value. If so, store preimage in pubCoin param
     bool HasCoinHash(GroupElement &pubCoinValue, const uint256 &pubCoinValueHash);
+    // Look up a batch of pubCoin value hashes with a single pass over the minted coins
+    void GetMintedCoinsByHash(const std::set<uint256> &pubCoinValueHashes,
+                              std::map<uint256, std::pair<sigma::PublicCoin, CMintedCoinInfo>> &result);
 
     // Given denomination and id returns latest accumulator value and corresponding block hash
     // Do not take into account coins with height more than maxHeight
@@ -158,6 +233,12 @@ public:
     // Reset to initial values
     void Reset();
 
+    // Serialize mints, spends, coin groups and latest ids (but not the mempool data) into the stream
+    void WriteSnapshot(CDataStream &stream) const;
+
+    // Replace the state with the one read from the stream. Blocks referenced by coin groups must be in the chain
+    bool ReadSnapshot(CDataStream &stream, CChain *chain);
+
     // Check if there is a conflicting tx in the blockchain or mempool
     bool CanAddSpendToMempool(const Scalar& coinSerial);
 
@@ -0,0 +1,111 @@
+// Copyright (c) 2019 The Zcoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SIGMAINDEX_H
+#define BITCOIN_SIGMAINDEX_H
+
+#include "primitives/transaction.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <secp256k1/include/GroupElement.h>
+#include <secp256k1/include/Scalar.h>
+
+#include <utility>
+#include <vector>
+
+/**
+ * Position of a sigma mint in its coin group. Keys of a group are contiguous in the database and sorted by height
+ * and then by position in the block, which is the order the anonymity set is built in.
+ */
+struct CSigmaMintIndexKey {
+    int64_t denomination;
+    int coinGroupId;
+    int blockHeight;
+    unsigned int n;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata64(s, denomination);
+        // Group ids, heights and positions are stored big-endian for key sorting in LevelDB
+        ser_writedata32be(s, coinGroupId);
+        ser_writedata32be(s, blockHeight);
+        ser_writedata32be(s, n);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        denomination = ser_readdata64(s);
+        coinGroupId = ser_readdata32be(s);
+        blockHeight = ser_readdata32be(s);
+        n = ser_readdata32be(s);
+    }
+
+    CSigmaMintIndexKey(int64_t denom, int groupId, int height, unsigned int position) {
+        denomination = denom;
+        coinGroupId = groupId;
+        blockHeight = height;
+        n = position;
+    }
+
+    CSigmaMintIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        denomination = 0;
+        coinGroupId = 0;
+        blockHeight = 0;
+        n = 0;
+    }
+};
+
+struct CSigmaMintIndexValue {
+    secp_primitives::GroupElement pubCoin;
+    // Null if the block couldn't be read when the index was rebuilt (pruned)
+    COutPoint outpoint;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(pubCoin);
+        READWRITE(outpoint);
+    }
+};
+
+/** Spends are keyed by the hash of the serial, which is what the wallet tracks its coins by */
+struct CSigmaSpendIndexValue {
+    secp_primitives::Scalar serial;
+    int blockHeight;
+    int64_t denomination;
+    int coinGroupId;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(serial);
+        READWRITE(blockHeight);
+        READWRITE(denomination);
+        READWRITE(coinGroupId);
+    }
+
+    CSigmaSpendIndexValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        blockHeight = 0;
+        denomination = 0;
+        coinGroupId = 0;
+    }
+};
+
+/** Index entries added (or, when disconnecting, removed) by one block */
+struct CSigmaIndexBlock {
+    std::vector<std::pair<CSigmaMintIndexKey, CSigmaMintIndexValue> > mints;
+    std::vector<CSigmaSpendIndexValue> spends;
+};
+
+#endif // BITCOIN_SIGMAINDEX_H
@@ -37,15 +37,18 @@ void CSporkManager::ProcessSpork(CNode* pfrom, std::string& strCommand, CDataStr
             strLogMsg = strprintf("SPORK -- hash: %s id: %d value: %10d bestHeight: %d peer=%d", hash.ToString(), spork.nSporkID, spork.nValue, chainActive.Height(), pfrom->id);
         }
 
-        if(mapSporksActive.count(spork.nSporkID)) {
-            if (mapSporksActive[spork.nSporkID].nTimeSigned >= spork.nTimeSigned) {
-                LogPrint("spork", "%s seen\n", strLogMsg);
-                return;
+        {
+            LOCK(cs);
+            if(mapSporksActive.count(spork.nSporkID)) {
+                if (mapSporksActive[spork.nSporkID].nTimeSigned >= spork.nTimeSigned) {
+                    LogPrint("spork", "%s seen\n", strLogMsg);
+                    return;
+                } else {
+                    LogPrintf("%s updated\n", strLogMsg);
+                }
             } else {
-                LogPrintf("%s updated\n", strLogMsg);
+                LogPrintf("%s new\n", strLogMsg);
             }
-        } else {
-            LogPrintf("%s new\n", strLogMsg);
         }
 
         if(!spork.CheckSignature()) {
@@ -65,9 +68,15 @@ void CSporkManager::ProcessSpork(CNode* pfrom, std::string& strCommand, CDataStr
 
     } else if (strCommand == NetMsgType::GETSPORKS) {
 
-        std::map<int, CSporkMessage>::iterator it = mapSporksActive.begin();
+        std::map<int, CSporkMessage> mapSporksCopy;
+        {
+            LOCK(cs);
+            mapSporksCopy = mapSporksActive;
+        }
 
-        while(it != mapSporksActive.end()) {
+        std::map<int, CSporkMessage>::iterator it = mapSporksCopy.begin();
+
+        while(it != mapSporksCopy.end()) {
             g_connman->PushMessage(pfrom, CNetMsgMaker(PROTOCOL_VERSION).Make(NetMsgType::SPORK, it->second));
             it++;
         }
@@ -85,17 +94,29 @@ bool CSporkManager::UpdateSpork(int nSporkID, int64_t nValue)
 
     if (spork.Sign(strMasterPrivKey)) {
         spork.Relay();
+        LOCK(cs);
         mapSporks[spork.GetHash()] = spork;
         mapSporksActive[nSporkID] = spork;
     }
     return true;
 }
 
+bool CSporkManager::GetSporkByHash(const uint256& hash, CSporkMessage& sporkRet) const
+{
+    LOCK(cs);
+    std::map<uint256, CSporkMessage>::const_iterator it = mapSporks.find(hash);
+    if (it == mapSporks.end())
+        return false;
+    sporkRet = it->second;
+    return true;
+}
+
 // grab the spork, otherwise say it's off
 bool CSporkManager::IsSporkActive(int nSporkID)
 {
     int64_t r = -1;
 
+    LOCK(cs);
     if(mapSporksActive.count(nSporkID)){
         r = mapSporksActive[nSporkID].nValue;
     } else {
@@ -122,8 +143,11 @@ bool CSporkManager::IsSporkActive(int nSporkID)
 // grab the value of the spork on the network, or the default
 int64_t CSporkManager::GetSporkValue(int nSporkID)
 {
-    if (mapSporksActive.count(nSporkID))
-        return mapSporksActive[nSporkID].nValue;
+    {
+        LOCK(cs);
+        if (mapSporksActive.count(nSporkID))
+            return mapSporksActive[nSporkID].nValue;
+    }
 
     switch (nSporkID) {
         case SPORK_2_INSTANTSEND_ENABLED:               return SPORK_2_INSTANTSEND_ENABLED_DEFAULT;
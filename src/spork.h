@@ -44,6 +44,7 @@ static const int64_t SPORK_14_REQUIRE_SENTINEL_FLAG_DEFAULT             = 407090
 static const int SPORK_START                                            = SPORK_2_INSTANTSEND_ENABLED;
 static const int SPORK_END                                              = SPORK_20_INSTANTSEND_LLMQ_BASED;
 
+//! Guarded by sporkManager's cs, use CSporkManager::GetSporkByHash
 extern std::map<uint256, CSporkMessage> mapSporks;
 
 //
@@ -104,6 +105,8 @@ class CSporkManager
 private:
     std::vector<unsigned char> vchSig;
     std::string strMasterPrivKey;
+    //! Guards mapSporksActive and mapSporks, sporks are read from any thread
+    mutable CCriticalSection cs;
     std::map<int, CSporkMessage> mapSporksActive;
 
 public:
@@ -116,6 +119,7 @@ public:
 
     bool IsSporkActive(int nSporkID);
     int64_t GetSporkValue(int nSporkID);
+    bool GetSporkByHash(const uint256& hash, CSporkMessage& sporkRet) const;
     int GetSporkIDByName(std::string strName);
     std::string GetSporkNameByID(int nSporkID);
 
@@ -0,0 +1,116 @@
+// Copyright (c) 2019 The Zcoin Core Developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockcache.h"
+
+#include "chainparams.h"
+#include "random.h"
+#include "streams.h"
+#include "validation.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockcache_tests, BasicTestingSetup)
+
+static std::shared_ptr<const CBlock> MakeBlock(size_t nTxs)
+{
+    std::shared_ptr<CBlock> block = std::make_shared<CBlock>();
+    for (size_t i = 0; i < nTxs; ++i) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+        tx.vout.resize(1);
+        tx.vout[0].nValue = i;
+        block->vtx.push_back(MakeTransactionRef(tx));
+    }
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(blockcache_lru)
+{
+    std::vector<uint256> hashes;
+    std::vector<std::shared_ptr<const CBlock>> blocks;
+    for (int i = 0; i < 4; ++i) {
+        hashes.push_back(GetRandHash());
+        blocks.push_back(MakeBlock(10));
+    }
+
+    // Measure how much a single block accounts for
+    CBlockCache sizing(1 << 20);
+    sizing.Insert(hashes[0], blocks[0]);
+    size_t nBlockUsage = sizing.GetStats().nUsage;
+    BOOST_CHECK(nBlockUsage > 0);
+
+    // Room for three blocks
+    CBlockCache cache(nBlockUsage * 3 + nBlockUsage / 2);
+    for (int i = 0; i < 3; ++i)
+        cache.Insert(hashes[i], blocks[i]);
+    BOOST_CHECK_EQUAL(cache.GetStats().nBlocks, 3U);
+
+    // The same object is handed out, not a copy
+    BOOST_CHECK(cache.Get(hashes[0]) == blocks[0]);
+
+    // hashes[1] is now the least recently used and goes first
+    cache.Insert(hashes[3], blocks[3]);
+    BOOST_CHECK(cache.Get(hashes[1]) == nullptr);
+    BOOST_CHECK(cache.Get(hashes[0]) == blocks[0]);
+    BOOST_CHECK(cache.Get(hashes[2]) == blocks[2]);
+    BOOST_CHECK(cache.Get(hashes[3]) == blocks[3]);
+
+    CBlockCache::Stats stats = cache.GetStats();
+    BOOST_CHECK_EQUAL(stats.nBlocks, 3U);
+    BOOST_CHECK_EQUAL(stats.nHits, 4U);
+    BOOST_CHECK_EQUAL(stats.nMisses, 1U);
+    BOOST_CHECK_EQUAL(stats.nEvictions, 1U);
+    BOOST_CHECK(stats.nUsage <= stats.nMaxUsage);
+
+    // Shrinking evicts, erase and clear release the accounted usage
+    cache.SetMaxUsage(nBlockUsage);
+    BOOST_CHECK_EQUAL(cache.GetStats().nBlocks, 1U);
+    BOOST_CHECK(cache.Get(hashes[3]) == blocks[3]);
+    cache.Erase(hashes[3]);
+    BOOST_CHECK_EQUAL(cache.GetStats().nUsage, 0U);
+
+    // Blocks larger than the whole cache are not stored, a zero sized cache stores nothing
+    cache.Insert(hashes[0], MakeBlock(100));
+    BOOST_CHECK(cache.Get(hashes[0]) == nullptr);
+    cache.SetMaxUsage(0);
+    cache.Insert(hashes[1], blocks[1]);
+    BOOST_CHECK(cache.Get(hashes[1]) == nullptr);
+
+    cache.SetMaxUsage(nBlockUsage * 2);
+    cache.Insert(hashes[1], blocks[1]);
+    cache.Clear();
+    BOOST_CHECK(cache.Get(hashes[1]) == nullptr);
+    BOOST_CHECK_EQUAL(cache.GetStats().nUsage, 0U);
+}
+
+BOOST_FIXTURE_TEST_CASE(blockcache_raw_block, TestChain100Setup)
+{
+    LOCK(cs_main);
+    for (int nHeight : {1, 50, chainActive.Height()}) {
+        const CBlockIndex* pindex = chainActive[nHeight];
+
+        CBlock block;
+        BOOST_CHECK(ReadBlockFromDisk(block, pindex, Params().GetConsensus()));
+        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+        ssBlock << block;
+
+        // The stored bytes are exactly what getdata and REST would serialize
+        std::vector<unsigned char> vRawBlock;
+        BOOST_CHECK(ReadRawBlockFromDisk(vRawBlock, pindex, Params().MessageStart()));
+        BOOST_CHECK(vRawBlock == std::vector<unsigned char>(ssBlock.begin(), ssBlock.end()));
+
+        // Records are only accepted with the right magic and a header matching the index
+        CMessageHeader::MessageStartChars wrongStart = {0, 0, 0, 0};
+        BOOST_CHECK(!ReadRawBlockFromDisk(vRawBlock, pindex, wrongStart));
+        CBlockIndex indexWrongPos(*pindex->pprev);
+        indexWrongPos.nFile = pindex->nFile;
+        indexWrongPos.nDataPos = pindex->nDataPos;
+        BOOST_CHECK(!ReadRawBlockFromDisk(vRawBlock, &indexWrongPos, Params().MessageStart()));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -584,4 +584,59 @@ BOOST_AUTO_TEST_CASE(MempoolSizeLimitTest)
     SetMockTime(0);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolAddressSpentIndexTest)
+{
+    CTxMemPool pool(CFeeRate(1000));
+    TestMemPoolEntryHelper entry;
+    CCoinsView coinsDummy;
+    CCoinsViewCache view(&coinsDummy);
+
+    uint160 const address = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+    CScript const script = CScript() << OP_DUP << OP_HASH160 << ToByteVector(address) << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    std::vector<CMutableTransaction> txs(3);
+    for (size_t i = 0; i < txs.size(); i++) {
+        txs[i].vin.resize(1);
+        txs[i].vin[0].prevout = COutPoint(GetRandHash(), i);
+        txs[i].vin[0].scriptSig = CScript() << OP_11;
+        txs[i].vout.resize(2);
+        txs[i].vout[0].scriptPubKey = script;
+        txs[i].vout[0].nValue = (i + 1) * COIN;
+        txs[i].vout[1].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        txs[i].vout[1].nValue = COIN;
+
+        CTxMemPoolEntry const e = entry.FromTx(txs[i]);
+        pool.addUnchecked(txs[i].GetHash(), e);
+        pool.addAddressIndex(e, view);
+        pool.addSpentIndex(e, view);
+    }
+
+    std::vector<std::pair<uint160, AddressType> > addresses(1, std::make_pair(address, AddressType::payToPubKeyHash));
+    std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > results;
+    BOOST_CHECK(pool.getAddressIndex(addresses, results));
+    BOOST_CHECK_EQUAL(results.size(), 3U);
+    CMempoolAddressDeltaKeyCompare compare;
+    for (size_t i = 1; i < results.size(); i++)
+        BOOST_CHECK(compare(results[i - 1].first, results[i].first));
+
+    CSpentIndexKey spentKey(txs[1].vin[0].prevout.hash, txs[1].vin[0].prevout.n);
+    CSpentIndexValue spentValue;
+    BOOST_CHECK(pool.getSpentIndex(spentKey, spentValue));
+    BOOST_CHECK(spentValue.txid == txs[1].GetHash());
+
+    // Entries go away together with the transaction
+    pool.removeRecursive(txs[1]);
+    results.clear();
+    BOOST_CHECK(pool.getAddressIndex(addresses, results));
+    BOOST_CHECK_EQUAL(results.size(), 2U);
+    for (size_t i = 0; i < results.size(); i++)
+        BOOST_CHECK(results[i].first.txhash != txs[1].GetHash());
+    BOOST_CHECK(!pool.getSpentIndex(spentKey, spentValue));
+
+    pool.clear();
+    results.clear();
+    BOOST_CHECK(pool.getAddressIndex(addresses, results));
+    BOOST_CHECK(results.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -133,4 +133,36 @@ BOOST_AUTO_TEST_CASE(merkle_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(merkle_tree_cache_test)
+{
+    for (int ntx = 0; ntx < 40; ntx++) {
+        std::vector<uint256> leaves(ntx);
+        for (auto& leaf : leaves) {
+            leaf = GetRandHash();
+        }
+        CMerkleTreeCache tree;
+        tree.Build(leaves);
+        BOOST_CHECK(tree.GetLeafCount() == leaves.size());
+
+        for (int loop = 0; loop < 32; loop++) {
+            bool oldMutated = false, newMutated = false;
+            uint256 oldRoot = ComputeMerkleRoot(leaves, &oldMutated);
+            uint256 newRoot = tree.GetRoot(&newMutated);
+            BOOST_CHECK(oldRoot == newRoot);
+            BOOST_CHECK(oldMutated == newMutated);
+            if (ntx == 0) {
+                break;
+            }
+            // Either replace a leaf with a fresh hash or copy a neighbour to produce (and later undo) duplicates
+            size_t pos = insecure_rand() % ntx;
+            if (pos > 0 && (insecure_rand() % 3) == 0) {
+                leaves[pos] = leaves[pos - 1];
+            } else {
+                leaves[pos] = GetRandHash();
+            }
+            tree.UpdateLeaf(pos, leaves[pos]);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -7,6 +7,7 @@
 
 #include "base58.h"
 #include "netbase.h"
+#include "validation.h"
 
 #include "test/test_bitcoin.h"
 
@@ -14,6 +15,9 @@
 #include <boost/assign/list_of.hpp>
 #include <boost/test/unit_test.hpp>
 
+#include <atomic>
+#include <thread>
+
 #include <univalue.h>
 
 UniValue CallRPC(std::string args)
@@ -343,4 +347,67 @@ BOOST_AUTO_TEST_CASE(rpc_convert_values_generatetoaddress)
     BOOST_CHECK_EQUAL(result[2].get_int(), 9);
 }
 
+BOOST_AUTO_TEST_CASE(rpc_batch_concurrent)
+{
+    // Read-only calls around one that isn't, replies have to come back in request order
+    UniValue batch(UniValue::VARR);
+    for (int i = 0; i < 8; i++) {
+        UniValue req(UniValue::VOBJ);
+        req.push_back(Pair("method", i == 4 ? "help" : "getblockcount"));
+        req.push_back(Pair("params", UniValue(UniValue::VARR)));
+        req.push_back(Pair("id", i));
+        batch.push_back(req);
+    }
+
+    std::atomic<int> nQueued(0);
+    std::vector<std::thread> threads;
+    auto queueWork = [&](const std::function<void()>& func) {
+        nQueued++;
+        threads.emplace_back(func);
+        return true;
+    };
+    UniValue replies;
+    BOOST_CHECK(replies.read(JSONRPCExecBatch(batch, queueWork, 3)));
+    for (std::thread& thread : threads)
+        thread.join();
+
+    BOOST_CHECK(nQueued > 0);
+    BOOST_CHECK_EQUAL(replies.write() + "\n", JSONRPCExecBatch(batch));
+    BOOST_CHECK_EQUAL(replies.size(), batch.size());
+    for (size_t i = 0; i < replies.size(); i++) {
+        BOOST_CHECK_EQUAL(find_value(replies[i], "id").get_int(), (int)i);
+        BOOST_CHECK(find_value(replies[i], "error").isNull());
+    }
+    BOOST_CHECK_EQUAL(find_value(replies[0], "result").get_int(), chainActive.Height());
+}
+
+BOOST_AUTO_TEST_CASE(rpc_batch_write)
+{
+    // The reply is written out piece by piece, the pieces add up to the joined reply
+    UniValue batch(UniValue::VARR);
+    for (int i = 0; i < 3; i++) {
+        UniValue req(UniValue::VOBJ);
+        req.push_back(Pair("method", "getblockcount"));
+        req.push_back(Pair("params", UniValue(UniValue::VARR)));
+        req.push_back(Pair("id", i));
+        batch.push_back(req);
+    }
+
+    std::vector<std::string> parts;
+    JSONRPCWriteBatch(batch, [&parts](std::string&& strPart) { parts.push_back(std::move(strPart)); });
+    BOOST_CHECK_EQUAL(parts.size(), batch.size() + 1);
+    BOOST_CHECK_EQUAL(parts.front().substr(0, 1), "[");
+    BOOST_CHECK_EQUAL(parts.back(), "]\n");
+
+    std::string strJoined;
+    for (const std::string& strPart : parts)
+        strJoined += strPart;
+    BOOST_CHECK_EQUAL(strJoined, JSONRPCExecBatch(batch));
+
+    parts.clear();
+    JSONRPCWriteBatch(UniValue(UniValue::VARR), [&parts](std::string&& strPart) { parts.push_back(std::move(strPart)); });
+    BOOST_CHECK_EQUAL(parts.size(), 1U);
+    BOOST_CHECK_EQUAL(JSONRPCExecBatch(UniValue(UniValue::VARR)), "[]\n");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -68,6 +68,21 @@ BOOST_AUTO_TEST_CASE(sigma_mintspend_test)
         CBlock b = CreateAndProcessBlock(scriptPubKey);
         BOOST_CHECK_MESSAGE(previousHeight + 1 == chainActive.Height(), "Block not added to chain");
 
+        // The mint is in the sigma index together with the outpoint of the mint transaction
+        {
+            const sigma::PublicCoin& pubCoin = privCoins[0].getPublicCoin();
+            CSigmaMintIndexKey key;
+            CSigmaMintIndexValue value;
+            BOOST_CHECK(pblocktree->ReadSigmaMint(pubCoin.getValueHash(), key, value));
+            BOOST_CHECK(value.pubCoin == pubCoin.getValue());
+            BOOST_CHECK_EQUAL(key.blockHeight, chainActive.Height());
+            BOOST_CHECK(value.outpoint.hash == b.vtx[1]->GetHash());
+
+            COutPoint outPoint;
+            BOOST_CHECK(sigma::GetOutPoint(outPoint, pubCoin.getValueHash()));
+            BOOST_CHECK(outPoint == value.outpoint);
+        }
+
         previousHeight = chainActive.Height();
 
         // Generate address
@@ -149,10 +164,42 @@ BOOST_AUTO_TEST_CASE(sigma_mintspend_test)
         //Verify spend got into mempool
         BOOST_CHECK_MESSAGE(mempool.size() == 1, "Spend was not added to mempool");
 
+        // The spend was parsed when it entered the mempool, and the summary agrees with a full parse
+        {
+            LOCK(mempool.cs);
+            const sigma::CSigmaSpendSummary *summary = mempool.mapTx.begin()->GetSigmaSpendSummary();
+            BOOST_REQUIRE(summary);
+            const CTransaction &spendTx = mempool.mapTx.begin()->GetTx();
+            BOOST_CHECK_EQUAL(summary->spends.size(), spendTx.vin.size());
+            BOOST_CHECK_EQUAL(summary->nAmount, sigma::GetSigmaSpendInput(spendTx));
+            for (size_t i = 0; i < summary->spends.size(); i++) {
+                std::unique_ptr<sigma::CoinSpend> spend;
+                uint32_t groupId;
+                std::tie(spend, groupId) = sigma::ParseSigmaSpend(spendTx.vin[i]);
+                BOOST_CHECK(summary->spends[i].serial == spend->getCoinSerialNumber());
+                BOOST_CHECK(summary->spends[i].denomination == spend->getDenomination());
+                BOOST_CHECK(summary->spends[i].accumulatorBlockHash == spend->getAccumulatorBlockHash());
+                BOOST_CHECK_EQUAL(summary->spends[i].version, spend->getVersion());
+                BOOST_CHECK_EQUAL(summary->spends[i].groupId, groupId);
+            }
+        }
+
+        // The proof was verified when the spend entered the mempool, building and connecting the block reuse that
+        sigma::SigmaProofCacheStats proofCacheStats = sigma::GetSigmaProofCacheStats();
+
         b = CreateBlock(scriptPubKey);
         previousHeight = chainActive.Height();
         BOOST_CHECK_MESSAGE(ProcessBlock(b), "ProcessBlock failed although valid spend inside");
         BOOST_CHECK_MESSAGE(previousHeight + 1 == chainActive.Height(), "Block not added to chain");
+        BOOST_CHECK(sigma::GetSigmaProofCacheStats().nHits > proofCacheStats.nHits);
+        BOOST_CHECK_EQUAL(sigma::GetSigmaProofCacheStats().nMisses, proofCacheStats.nMisses);
+
+        // The serials are found by their hash through the sigma index
+        for (const CSigmaEntry& coin : coins) {
+            Scalar serial;
+            BOOST_CHECK(sigmaState->IsUsedCoinSerialHash(serial, primitives::GetSerialHash(coin.serialNumber)));
+            BOOST_CHECK(serial == coin.serialNumber);
+        }
 
         BOOST_CHECK_MESSAGE(mempool.size() == 0, "Mempool not cleared");
 
@@ -1003,6 +1003,73 @@ BOOST_AUTO_TEST_CASE(sigma_build_state)
     chainActive.SetTip(NULL);
 }
 
+BOOST_AUTO_TEST_CASE(sigma_build_state_snapshot)
+{
+    sigma::CSigmaState *sigmaState = sigma::CSigmaState::GetState();
+    auto params = sigma::Params::get_default();
+    chainActive.SetTip(NULL);
+
+    std::pair<sigma::CoinDenomination, int> denomination1Group1(sigma::CoinDenomination::SIGMA_DENOM_1, 1);
+    std::pair<sigma::CoinDenomination, int> denomination10Group1(sigma::CoinDenomination::SIGMA_DENOM_10, 1);
+
+    // snapshot refers to coin group blocks by hash, so the indexes have to be in mapBlockIndex
+    std::vector<uint256> hashes(11);
+    std::vector<CBlockIndex> indices;
+    indices.reserve(11);
+    for (int i = 0; i <= 10; i++) {
+        hashes[i] = GetRandHash();
+        indices.emplace_back(CreateBlockIndex(i));
+        delete indices.back().phashBlock;
+        indices.back().phashBlock = &hashes[i];
+        mapBlockIndex[hashes[i]] = &indices.back();
+        chainActive.SetTip(&indices.back());
+    }
+
+    auto pubCoins = getPubcoins(generateCoins(params, 10, sigma::CoinDenomination::SIGMA_DENOM_1));
+    auto pubCoins2 = getPubcoins(generateCoins(params, 2, sigma::CoinDenomination::SIGMA_DENOM_10));
+    indices[1].sigmaMintedPubCoins[denomination1Group1] = pubCoins;
+    indices[3].sigmaMintedPubCoins[denomination10Group1] = pubCoins2;
+
+    secp_primitives::Scalar serial;
+    serial.randomize();
+    indices[5].sigmaSpentSerials.insert(std::make_pair(serial, sigma::CSpendCoinInfo::make(sigma::CoinDenomination::SIGMA_DENOM_1, 1)));
+
+    sigma::BuildSigmaStateFromIndex(&chainActive);
+
+    CDataStream snapshot(SER_DISK, CLIENT_VERSION);
+    sigmaState->WriteSnapshot(snapshot);
+    sigmaState->Reset();
+
+    BOOST_CHECK(sigmaState->ReadSnapshot(snapshot, &chainActive));
+
+    sigma::CSigmaState::SigmaCoinGroupInfo group;
+    BOOST_CHECK(sigmaState->GetCoinGroupInfo(sigma::CoinDenomination::SIGMA_DENOM_1, 1, group));
+    BOOST_CHECK(group.firstBlock == &indices[1]);
+    BOOST_CHECK(group.lastBlock == &indices[1]);
+    BOOST_CHECK_EQUAL(group.nCoins, 10);
+    BOOST_CHECK(sigmaState->GetCoinGroupInfo(sigma::CoinDenomination::SIGMA_DENOM_10, 1, group));
+    BOOST_CHECK(group.firstBlock == &indices[3]);
+    BOOST_CHECK_EQUAL(group.nCoins, 2);
+
+    BOOST_CHECK_EQUAL(sigmaState->GetLatestCoinID(sigma::CoinDenomination::SIGMA_DENOM_1), 1);
+    BOOST_CHECK_EQUAL(sigmaState->GetMints().size(), 12);
+    BOOST_CHECK(sigmaState->HasCoin(pubCoins[0]));
+    BOOST_CHECK(sigmaState->GetMintedCoinHeightAndId(pubCoins2[1]) == std::make_pair(3, 1));
+    BOOST_CHECK(sigmaState->IsUsedCoinSerial(serial));
+    BOOST_CHECK(!sigmaState->IsSurgeConditionDetected());
+
+    // a snapshot referring to blocks which are not in the chain is rejected
+    CDataStream snapshot2(SER_DISK, CLIENT_VERSION);
+    sigmaState->WriteSnapshot(snapshot2);
+    chainActive.SetTip(&indices[2]);
+    BOOST_CHECK(!sigmaState->ReadSnapshot(snapshot2, &chainActive));
+
+    for (auto const & hash : hashes)
+        mapBlockIndex.erase(hash);
+    sigmaState->Reset();
+    chainActive.SetTip(NULL);
+}
+
 BOOST_AUTO_TEST_CASE(sigma_build_state_no_sigma)
 {
     sigma::CSigmaState *sigmaState = sigma::CSigmaState::GetState();
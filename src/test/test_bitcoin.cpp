@@ -63,6 +63,7 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
     SetupEnvironment();
     SetupNetworking();
     InitSignatureCache();
+    sigma::InitSigmaProofCache();
     fPrintToDebugLog = false; // don't want to write to debug.log file
     fCheckBlockIndex = true;
     SelectParams(chainName);
@@ -338,4 +338,157 @@ BOOST_AUTO_TEST_CASE(dbindexhelper_zerospend)
     }
 }
 
+BOOST_AUTO_TEST_CASE(load_block_index_parallel)
+{
+    // More records than fit into a single deserialization chunk
+    size_t const blocksNum = 10000;
+
+    std::vector<uint256> hashes(blocksNum);
+    std::vector<CBlockIndex> indexes(blocksNum);
+    std::vector<const CBlockIndex*> blockinfo;
+    for (size_t i = 0; i < blocksNum; ++i) {
+        hashes[i] = GetRandHash();
+        indexes[i].phashBlock = &hashes[i];
+        indexes[i].pprev = i > 0 ? &indexes[i - 1] : NULL;
+        indexes[i].nHeight = i;
+        indexes[i].nTime = i * 600;
+        indexes[i].nTx = i % 7 + 1;
+        blockinfo.push_back(&indexes[i]);
+    }
+
+    CBlockTreeDB blockTree(1 << 20, true);
+    BOOST_CHECK(blockTree.WriteBatchSync(std::vector<std::pair<int, const CBlockFileInfo*> >(), 0, blockinfo));
+
+    typedef std::map<uint256, std::unique_ptr<CBlockIndex> > IndexMap;
+    auto insertInto = [](IndexMap & map) {
+        return [&map](uint256 const & hash) -> CBlockIndex* {
+            if (hash.IsNull())
+                return NULL;
+            std::unique_ptr<CBlockIndex> & entry = map[hash];
+            if (!entry) {
+                entry.reset(new CBlockIndex());
+                entry->phashBlock = &map.find(hash)->first;
+            }
+            return entry.get();
+        };
+    };
+
+    IndexMap serial, parallel;
+    BOOST_CHECK(blockTree.LoadBlockIndexGuts(insertInto(serial), 1));
+    BOOST_CHECK(blockTree.LoadBlockIndexGuts(insertInto(parallel), 4));
+
+    BOOST_CHECK_EQUAL(serial.size(), blocksNum);
+    BOOST_CHECK_EQUAL(parallel.size(), blocksNum);
+    for (size_t i = 0; i < blocksNum; ++i) {
+        CBlockIndex const * pindex = parallel[hashes[i]].get();
+        BOOST_CHECK_EQUAL(pindex->nHeight, i);
+        BOOST_CHECK_EQUAL(pindex->nTime, i * 600);
+        BOOST_CHECK_EQUAL(pindex->nTx, serial[hashes[i]]->nTx);
+        BOOST_CHECK(pindex->pprev == (i > 0 ? parallel[hashes[i - 1]].get() : NULL));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(address_balance_index)
+{
+    CBlockTreeDB blockTree(1 << 20, true);
+
+    uint160 const addr = uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"));
+    uint256 const hash0 = GetRandHash(), hash1 = GetRandHash(), hash2 = GetRandHash();
+    uint256 const txid1 = GetRandHash(), txid2 = GetRandHash();
+
+    // Block 1 pays 50 and 20 to the address in one tx, block 2 spends the 50
+    std::vector<std::pair<CAddressIndexKey, CAmount> > block1, block2;
+    block1.push_back(std::make_pair(CAddressIndexKey(AddressType::payToPubKeyHash, addr, 1, 0, txid1, 0, false), 50));
+    block1.push_back(std::make_pair(CAddressIndexKey(AddressType::payToPubKeyHash, addr, 1, 0, txid1, 1, false), 20));
+    block2.push_back(std::make_pair(CAddressIndexKey(AddressType::payToPubKeyHash, addr, 2, 1, txid2, 0, true), -50));
+
+    BOOST_CHECK(blockTree.UpdateAddressBalanceIndex(block1, false, hash0, hash1, 100));
+    BOOST_CHECK(blockTree.UpdateAddressBalanceIndex(block2, false, hash1, hash2, 10));
+    // Replaying an already applied block is a no-op, for the supply too
+    BOOST_CHECK(blockTree.UpdateAddressBalanceIndex(block2, false, hash1, hash2, 10));
+
+    CAmount nSupply = 0;
+    BOOST_CHECK(blockTree.ReadTotalSupply(nSupply));
+    BOOST_CHECK_EQUAL(nSupply, 110);
+
+    CAddressBalanceValue value;
+    BOOST_CHECK(blockTree.ReadAddressBalanceIndex(addr, AddressType::payToPubKeyHash, value));
+    BOOST_CHECK_EQUAL(value.balance, 20);
+    BOOST_CHECK_EQUAL(value.received, 70);
+    BOOST_CHECK_EQUAL(value.txCount, 2);
+
+    BOOST_CHECK(blockTree.UpdateAddressBalanceIndex(block2, true, hash2, hash1, 10));
+    BOOST_CHECK(blockTree.ReadTotalSupply(nSupply));
+    BOOST_CHECK_EQUAL(nSupply, 100);
+    BOOST_CHECK(blockTree.ReadAddressBalanceIndex(addr, AddressType::payToPubKeyHash, value));
+    BOOST_CHECK_EQUAL(value.balance, 70);
+    BOOST_CHECK_EQUAL(value.received, 70);
+    BOOST_CHECK_EQUAL(value.txCount, 1);
+
+    // A rebuild from the address index gives the same aggregate, ignoring entries above the given height
+    BOOST_CHECK(blockTree.WriteAddressIndex(block1));
+    BOOST_CHECK(blockTree.WriteAddressIndex(block2));
+    BOOST_CHECK(blockTree.RebuildAddressBalanceIndex(1, hash1));
+    CAddressBalanceValue rebuilt;
+    BOOST_CHECK(blockTree.ReadAddressBalanceIndex(addr, AddressType::payToPubKeyHash, rebuilt));
+    BOOST_CHECK_EQUAL(rebuilt.balance, value.balance);
+    BOOST_CHECK_EQUAL(rebuilt.received, value.received);
+    BOOST_CHECK_EQUAL(rebuilt.txCount, value.txCount);
+
+    uint256 hashBest;
+    BOOST_CHECK(blockTree.ReadAddressBalanceBestBlock(hashBest));
+    BOOST_CHECK(hashBest == hash1);
+
+    // Paging through the index resumes right after the given key
+    std::vector<CAmount> page;
+    BOOST_CHECK(blockTree.ReadAddressIndex(addr, AddressType::payToPubKeyHash, &block1[0].first, 0, 0,
+            [&page](const CAddressIndexKey &, CAmount amount) { page.push_back(amount); return true; }));
+    BOOST_CHECK_EQUAL(page.size(), 2U);
+    BOOST_CHECK_EQUAL(page[0], 20);
+    BOOST_CHECK_EQUAL(page[1], -50);
+}
+
+BOOST_AUTO_TEST_CASE(coins_background_flush)
+{
+    CCoinsViewDB db(1 << 20, true);
+    uint256 const hash1 = GetRandHash(), hash2 = GetRandHash();
+    COutPoint const out1(GetRandHash(), 0), out2(GetRandHash(), 1);
+    CTxOut txout(50, CScript() << OP_TRUE);
+
+    {
+        CCoinsViewBackgroundFlush flusher(&db);
+        CCoinsViewCache cache(&flusher);
+        cache.AddCoin(out1, Coin(txout, 1, false, false), false);
+        cache.AddCoin(out2, Coin(txout, 1, false, false), false);
+        cache.SetBestBlock(hash1);
+
+        bool fWritten = false;
+        BOOST_CHECK(cache.Flush());
+        // Whether or not the write is done yet, the coins are there
+        BOOST_CHECK(flusher.HaveCoin(out1));
+        BOOST_CHECK(flusher.GetBestBlock() == hash1);
+        flusher.AfterWrite([&fWritten, &db, &out1]() { fWritten = db.HaveCoin(out1); });
+        BOOST_CHECK(flusher.Sync());
+        BOOST_CHECK(fWritten);
+        BOOST_CHECK(db.GetBestBlock() == hash1);
+
+        cache.SpendCoin(out1);
+        cache.SetBestBlock(hash2);
+        BOOST_CHECK(cache.Flush());
+        BOOST_CHECK(!flusher.HaveCoin(out1));
+        BOOST_CHECK(flusher.HaveCoin(out2));
+
+        CCoinsFlushStats stats;
+        BOOST_CHECK(flusher.Sync());
+        flusher.GetStats(stats);
+        BOOST_CHECK_EQUAL(stats.write.nCount, 2U);
+        BOOST_CHECK_EQUAL(stats.nPendingCoins, 0U);
+    }
+
+    // The last write was finished before the flusher went away
+    BOOST_CHECK(!db.HaveCoin(out1));
+    BOOST_CHECK(db.HaveCoin(out2));
+    BOOST_CHECK(db.GetBestBlock() == hash2);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
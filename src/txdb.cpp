@@ -12,9 +12,16 @@
 #include "validation.h"
 #include "consensus/consensus.h"
 #include "base58.h"
+#include "ctpl.h"
+#include "primitives/zerocoin.h"
 
 #include <stdint.h>
 
+#include <deque>
+#include <future>
+#include <map>
+#include <set>
+
 #include <boost/thread.hpp>
 
 static const char DB_COIN = 'C';
@@ -23,9 +30,15 @@ static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
 static const char DB_ADDRESSINDEX = 'a';
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_ADDRESSBALANCEINDEX = 'A';
+static const char DB_ADDRESSBALANCE_BEST_BLOCK = 'W';
 static const char DB_TIMESTAMPINDEX = 's';
 static const char DB_SPENTINDEX = 'p';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_SIGMA_MINT = 'g';
+static const char DB_SIGMA_MINT_HASH = 'h';
+static const char DB_SIGMA_SPEND = 'z';
+static const char DB_SIGMA_BEST_BLOCK = 'Z';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_FLAG = 'F';
@@ -106,6 +119,221 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
+bool CCoinsViewDB::WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    CDBBatch batch(db);
+    size_t changed = 0;
+    for (CCoinsMap::const_iterator it = mapCoins.begin(); it != mapCoins.end(); ++it) {
+        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+            CoinEntry entry(&it->first);
+            if (it->second.coin.IsSpent())
+                batch.Erase(entry);
+            else
+                batch.Write(entry, it->second.coin);
+            changed++;
+        }
+    }
+    if (!hashBlock.IsNull())
+        batch.Write(DB_BEST_BLOCK, hashBlock);
+
+    bool ret = db.WriteBatch(batch);
+    LogPrint("coindb", "Committed %u changed transaction outputs (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)mapCoins.size());
+    return ret;
+}
+
+CCoinsViewBackgroundFlush::CCoinsViewBackgroundFlush(CCoinsViewDB *dbIn) :
+    CCoinsViewBacked(dbIn), db(dbIn), fWriting(false), fFailed(false), fStop(false)
+{
+    thread = std::thread(&CCoinsViewBackgroundFlush::ThreadWrite, this);
+}
+
+CCoinsViewBackgroundFlush::~CCoinsViewBackgroundFlush()
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        fStop = true;
+        cond.notify_all();
+    }
+    // An outstanding write is finished first
+    thread.join();
+}
+
+void CCoinsViewBackgroundFlush::ThreadWrite()
+{
+    RenameThread("bitcoin-coinsflush");
+
+    std::unique_lock<std::mutex> lock(cs);
+    while (true) {
+        cond.wait(lock, [this] { return fWriting || fStop; });
+        if (!fWriting)
+            break;
+        uint256 hashBlock = hashWriting;
+        lock.unlock();
+
+        // GetCoin looks into the entries concurrently, neither side modifies them until fWriting is cleared.
+        // CDBWrapper throws on I/O errors and corruption, which must not escape this thread.
+        int64_t nStart = GetTimeMicros();
+        bool fWritten = false;
+        try {
+            fWritten = db->WriteCoins(*pmapWriting, hashBlock);
+        } catch (const std::runtime_error& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+        }
+        int64_t nWriteMicros = GetTimeMicros() - nStart;
+
+        lock.lock();
+        stats.write.Add(nWriteMicros);
+        if (fWritten)
+            stats.nCoinsWritten += pmapWriting->size();
+        else
+            fFailed = true;
+        // Hooks may be added while the earlier ones run, keep going until there are none left
+        while (!vAfterWrite.empty()) {
+            std::vector<std::function<void()> > vRun;
+            vRun.swap(vAfterWrite);
+            if (fFailed)
+                continue;
+            lock.unlock();
+            bool fHooksDone = true;
+            try {
+                for (const std::function<void()>& fn : vRun)
+                    fn();
+            } catch (const std::runtime_error& e) {
+                LogPrintf("%s: %s\n", __func__, e.what());
+                fHooksDone = false;
+            }
+            lock.lock();
+            if (!fHooksDone)
+                fFailed = true;
+        }
+        if (fFailed) {
+            // The entries stay readable: the database doesn't have them, and reading it instead would return stale
+            // coins. Further writes are refused, the node shuts down.
+            fWriting = false;
+            cond.notify_all();
+            lock.unlock();
+            AbortNode(strprintf("Failed to write to coin database at %s", hashBlock.ToString()), "");
+            lock.lock();
+            continue;
+        }
+        // The entries are freed outside of the lock, that can take a while for a large cache
+        std::unique_ptr<CCoinsMap> pmapWritten = std::move(pmapWriting);
+        hashWriting.SetNull();
+        fWriting = false;
+        cond.notify_all();
+        lock.unlock();
+        pmapWritten.reset();
+        LogPrint("coindb", "%s: wrote coins at %s in %.2fms\n", __func__, hashBlock.ToString(), nWriteMicros * 0.001);
+        lock.lock();
+    }
+}
+
+void CCoinsViewBackgroundFlush::WaitForWrite(std::unique_lock<std::mutex> &lock) const
+{
+    cond.wait(lock, [this] { return !fWriting; });
+}
+
+bool CCoinsViewBackgroundFlush::GetCoin(const COutPoint &outpoint, Coin &coin) const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (pmapWriting) {
+            CCoinsMap::const_iterator it = pmapWriting->find(outpoint);
+            if (it != pmapWriting->end()) {
+                if (it->second.coin.IsSpent())
+                    return false;
+                coin = it->second.coin;
+                return true;
+            }
+        }
+    }
+    return base->GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewBackgroundFlush::HaveCoin(const COutPoint &outpoint) const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (pmapWriting) {
+            CCoinsMap::const_iterator it = pmapWriting->find(outpoint);
+            if (it != pmapWriting->end())
+                return !it->second.coin.IsSpent();
+        }
+    }
+    return base->HaveCoin(outpoint);
+}
+
+uint256 CCoinsViewBackgroundFlush::GetBestBlock() const
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (pmapWriting && !hashWriting.IsNull())
+            return hashWriting;
+    }
+    return base->GetBestBlock();
+}
+
+bool CCoinsViewBackgroundFlush::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock)
+{
+    std::unique_lock<std::mutex> lock(cs);
+    WaitForWrite(lock);
+    if (fFailed)
+        return false;
+
+    // Clean entries come along, they are still valid reads until the write is done
+    pmapWriting.reset(new CCoinsMap(std::move(mapCoins)));
+    mapCoins.clear();
+    hashWriting = hashBlock;
+    fWriting = true;
+    cond.notify_all();
+    return true;
+}
+
+CCoinsViewCursor *CCoinsViewBackgroundFlush::Cursor() const
+{
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        WaitForWrite(lock);
+    }
+    return base->Cursor();
+}
+
+void CCoinsViewBackgroundFlush::AfterWrite(std::function<void()> fn)
+{
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (fFailed)
+            return;
+        if (fWriting) {
+            vAfterWrite.push_back(std::move(fn));
+            return;
+        }
+    }
+    fn();
+}
+
+bool CCoinsViewBackgroundFlush::Sync()
+{
+    std::unique_lock<std::mutex> lock(cs);
+    int64_t nStart = GetTimeMicros();
+    WaitForWrite(lock);
+    stats.wait.Add(GetTimeMicros() - nStart);
+    return !fFailed;
+}
+
+void CCoinsViewBackgroundFlush::AddPause(int64_t nMicros)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    stats.pause.Add(nMicros);
+}
+
+void CCoinsViewBackgroundFlush::GetStats(CCoinsFlushStats &statsRet) const
+{
+    std::lock_guard<std::mutex> lock(cs);
+    statsRet = stats;
+    statsRet.nPendingCoins = pmapWriting ? pmapWriting->size() : 0;
+    statsRet.hashPendingBlock = hashWriting;
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
 }
 
@@ -236,18 +464,36 @@ bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddres
 
 bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, AddressType type,
                                            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
+    return ReadAddressUnspentIndex(addressHash, type, NULL,
+            [&unspentOutputs](const CAddressUnspentKey &key, const CAddressUnspentValue &value) {
+                unspentOutputs.push_back(make_pair(key, value));
+                return true;
+            });
+}
+
+bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, AddressType type, const CAddressUnspentKey *pAfter,
+                                           boost::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)> visitor) {
 
     boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
 
-    pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    if (pAfter) {
+        pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, *pAfter));
+    } else {
+        pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    }
 
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
         std::pair<char,CAddressUnspentKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash) {
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash && key.second.type == type) {
+            if (pAfter && key.second.txhash == pAfter->txhash && key.second.index == pAfter->index) {
+                pcursor->Next();
+                continue;
+            }
             CAddressUnspentValue nValue;
             if (pcursor->GetValue(nValue)) {
-                unspentOutputs.push_back(make_pair(key.second, nValue));
+                if (!visitor(key.second, nValue))
+                    break;
                 pcursor->Next();
             } else {
                 return error("failed to get address unspent value");
@@ -278,10 +524,21 @@ bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKe
 bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, AddressType type,
                                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                                     int start, int end) {
+    return ReadAddressIndex(addressHash, type, NULL, start, end,
+            [&addressIndex](const CAddressIndexKey &key, CAmount value) {
+                addressIndex.push_back(make_pair(key, value));
+                return true;
+            });
+}
+
+bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, AddressType type, const CAddressIndexKey *pAfter, int start, int end,
+                                    boost::function<bool(const CAddressIndexKey&, CAmount)> visitor) {
 
     boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
 
-    if (start > 0 && end > 0) {
+    if (pAfter) {
+        pcursor->Seek(make_pair(DB_ADDRESSINDEX, *pAfter));
+    } else if (start > 0 && end > 0) {
         pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
     } else {
         pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
@@ -294,9 +551,15 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, AddressType type,
             if (end > 0 && key.second.blockHeight > end) {
                 break;
             }
+            if (pAfter && key.second.blockHeight == pAfter->blockHeight && key.second.txindex == pAfter->txindex
+                    && key.second.txhash == pAfter->txhash && key.second.index == pAfter->index && key.second.spending == pAfter->spending) {
+                pcursor->Next();
+                continue;
+            }
             CAmount nValue;
             if (pcursor->GetValue(nValue)) {
-                addressIndex.push_back(make_pair(key.second, nValue));
+                if (!visitor(key.second, nValue))
+                    break;
                 pcursor->Next();
             } else {
                 return error("failed to get address index value");
@@ -309,6 +572,232 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, AddressType type,
     return true;
 }
 
+namespace {
+
+typedef std::pair<AddressType, uint160> AddressBalanceKey;
+
+void ApplyAddressIndexEntry(CAddressBalanceValue &value, CAmount amount, int sign) {
+    value.balance += sign * amount;
+    if (amount > 0)
+        value.received += sign * amount;
+}
+
+}
+
+bool CBlockTreeDB::UpdateAddressBalanceIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect, bool fUndo,
+                                             const uint256 &hashFrom, const uint256 &hashTo, CAmount nSupplyDelta) {
+    uint256 hashBestBlock;
+    if (ReadAddressBalanceBestBlock(hashBestBlock) && hashBestBlock != hashFrom) {
+        LogPrint("addressindex", "%s: aggregates are at %s, not at %s, skipping\n", __func__, hashBestBlock.ToString(), hashFrom.ToString());
+        return true;
+    }
+
+    int const sign = fUndo ? -1 : 1;
+
+    // Aggregate the block's entries per address first, a transaction touching an address several times counts once
+    std::map<AddressBalanceKey, CAddressBalanceValue> deltas;
+    std::set<std::pair<AddressBalanceKey, uint256> > seenTxs;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        AddressBalanceKey address(it->first.type, it->first.hashBytes);
+        CAddressBalanceValue &delta = deltas[address];
+        ApplyAddressIndexEntry(delta, it->second, sign);
+        if (seenTxs.insert(std::make_pair(address, it->first.txhash)).second)
+            delta.txCount += sign;
+    }
+
+    CDBBatch batch(*this);
+    for (std::map<AddressBalanceKey, CAddressBalanceValue>::const_iterator it=deltas.begin(); it!=deltas.end(); it++) {
+        CAddressIndexIteratorKey key(it->first.first, it->first.second);
+        CAddressBalanceValue value;
+        Read(make_pair(DB_ADDRESSBALANCEINDEX, key), value);
+        value.balance += it->second.balance;
+        value.received += it->second.received;
+        value.txCount += it->second.txCount;
+        if (value.txCount <= 0) {
+            batch.Erase(make_pair(DB_ADDRESSBALANCEINDEX, key));
+        } else {
+            batch.Write(make_pair(DB_ADDRESSBALANCEINDEX, key), value);
+        }
+    }
+    // The supply goes into the same batch, so it moves with the aggregates' best block
+    if (nSupplyDelta != 0) {
+        CAmount nSupply = 0;
+        Read(DB_TOTAL_SUPPLY, nSupply);
+        batch.Write(DB_TOTAL_SUPPLY, nSupply + sign * nSupplyDelta);
+    }
+    batch.Write(DB_ADDRESSBALANCE_BEST_BLOCK, hashTo);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadAddressBalanceIndex(uint160 addressHash, AddressType type, CAddressBalanceValue &value) {
+    value.SetNull();
+    if (!Exists(make_pair(DB_ADDRESSBALANCEINDEX, CAddressIndexIteratorKey(type, addressHash))))
+        return true;
+    return Read(make_pair(DB_ADDRESSBALANCEINDEX, CAddressIndexIteratorKey(type, addressHash)), value);
+}
+
+bool CBlockTreeDB::ReadAddressBalanceBestBlock(uint256 &hashBestBlock) {
+    return Read(DB_ADDRESSBALANCE_BEST_BLOCK, hashBestBlock);
+}
+
+bool CBlockTreeDB::RebuildAddressBalanceIndex(int nMaxHeight, const uint256 &hashBestBlock) {
+    // Batches are written out once they grow past this size
+    size_t const nMaxBatchSize = 16 << 20;
+
+    // Drop the old aggregates
+    {
+        CDBBatch batch(*this);
+        boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+        pcursor->Seek(make_pair(DB_ADDRESSBALANCEINDEX, CAddressIndexIteratorKey()));
+        while (pcursor->Valid()) {
+            boost::this_thread::interruption_point();
+            std::pair<char,CAddressIndexIteratorKey> key;
+            if (!pcursor->GetKey(key) || key.first != DB_ADDRESSBALANCEINDEX)
+                break;
+            batch.Erase(key);
+            if (batch.SizeEstimate() > nMaxBatchSize) {
+                if (!WriteBatch(batch))
+                    return false;
+                batch.Clear();
+            }
+            pcursor->Next();
+        }
+        batch.Erase(DB_ADDRESSBALANCE_BEST_BLOCK);
+        if (!WriteBatch(batch))
+            return false;
+    }
+
+    // Address index keys are ordered by address and then by height, so one pass with O(1) state per address is enough
+    CDBBatch batch(*this);
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey()));
+
+    bool fHaveAddress = false;
+    AddressBalanceKey address;
+    uint256 lastTx;
+    CAddressBalanceValue value;
+    auto flushAddress = [&]() {
+        if (fHaveAddress && value.txCount > 0)
+            batch.Write(make_pair(DB_ADDRESSBALANCEINDEX, CAddressIndexIteratorKey(address.first, address.second)), value);
+    };
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX)
+            break;
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("failed to get address index value");
+
+        AddressBalanceKey current(key.second.type, key.second.hashBytes);
+        if (!fHaveAddress || current != address) {
+            flushAddress();
+            fHaveAddress = true;
+            address = current;
+            lastTx.SetNull();
+            value.SetNull();
+        }
+
+        // Entries above the flushed tip belong to blocks that will be connected (and counted) again
+        if (key.second.blockHeight <= nMaxHeight) {
+            ApplyAddressIndexEntry(value, nValue, 1);
+            if (key.second.txhash != lastTx) {
+                value.txCount++;
+                lastTx = key.second.txhash;
+            }
+        }
+
+        if (batch.SizeEstimate() > nMaxBatchSize) {
+            if (!WriteBatch(batch))
+                return false;
+            batch.Clear();
+        }
+        pcursor->Next();
+    }
+    flushAddress();
+    batch.Write(DB_ADDRESSBALANCE_BEST_BLOCK, hashBestBlock);
+    return WriteBatch(batch, true);
+}
+
+bool CBlockTreeDB::UpdateSigmaIndex(const CSigmaIndexBlock &block, bool fUndo, const uint256 &hashFrom, const uint256 &hashTo) {
+    uint256 hashBestBlock;
+    if (ReadSigmaIndexBestBlock(hashBestBlock) && hashBestBlock != hashFrom) {
+        LogPrint("sigma", "%s: index is at %s, not at %s, skipping\n", __func__, hashBestBlock.ToString(), hashFrom.ToString());
+        return true;
+    }
+
+    CDBBatch batch(*this);
+    for (std::vector<std::pair<CSigmaMintIndexKey, CSigmaMintIndexValue> >::const_iterator it=block.mints.begin(); it!=block.mints.end(); it++) {
+        uint256 const hash = primitives::GetPubCoinValueHash(it->second.pubCoin);
+        if (fUndo) {
+            batch.Erase(make_pair(DB_SIGMA_MINT, it->first));
+            batch.Erase(make_pair(DB_SIGMA_MINT_HASH, hash));
+        } else {
+            batch.Write(make_pair(DB_SIGMA_MINT, it->first), it->second);
+            batch.Write(make_pair(DB_SIGMA_MINT_HASH, hash), it->first);
+        }
+    }
+    for (std::vector<CSigmaSpendIndexValue>::const_iterator it=block.spends.begin(); it!=block.spends.end(); it++) {
+        uint256 const hash = primitives::GetSerialHash(it->serial);
+        if (fUndo)
+            batch.Erase(make_pair(DB_SIGMA_SPEND, hash));
+        else
+            batch.Write(make_pair(DB_SIGMA_SPEND, hash), *it);
+    }
+    batch.Write(DB_SIGMA_BEST_BLOCK, hashTo);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadSigmaMint(const uint256 &pubCoinValueHash, CSigmaMintIndexKey &key, CSigmaMintIndexValue &value) {
+    return Read(make_pair(DB_SIGMA_MINT_HASH, pubCoinValueHash), key) && Read(make_pair(DB_SIGMA_MINT, key), value);
+}
+
+bool CBlockTreeDB::ReadSigmaSpend(const uint256 &serialHash, CSigmaSpendIndexValue &value) {
+    return Read(make_pair(DB_SIGMA_SPEND, serialHash), value);
+}
+
+bool CBlockTreeDB::ReadSigmaIndexBestBlock(uint256 &hashBestBlock) {
+    return Read(DB_SIGMA_BEST_BLOCK, hashBestBlock);
+}
+
+namespace {
+
+//! Erase every entry of one table, keys of a table are the prefix followed by Key
+template<typename Key>
+bool EraseTable(CBlockTreeDB &db, char prefix, CDBBatch &batch, size_t nMaxBatchSize) {
+    boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+    pcursor->Seek(make_pair(prefix, Key()));
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, Key> key;
+        if (!pcursor->GetKey(key) || key.first != prefix)
+            break;
+        batch.Erase(key);
+        if (batch.SizeEstimate() > nMaxBatchSize) {
+            if (!db.WriteBatch(batch))
+                return false;
+            batch.Clear();
+        }
+        pcursor->Next();
+    }
+    return true;
+}
+
+}
+
+bool CBlockTreeDB::WipeSigmaIndex() {
+    // Batches are written out once they grow past this size
+    size_t const nMaxBatchSize = 16 << 20;
+
+    CDBBatch batch(*this);
+    if (!EraseTable<CSigmaMintIndexKey>(*this, DB_SIGMA_MINT, batch, nMaxBatchSize) ||
+        !EraseTable<uint256>(*this, DB_SIGMA_MINT_HASH, batch, nMaxBatchSize) ||
+        !EraseTable<uint256>(*this, DB_SIGMA_SPEND, batch, nMaxBatchSize))
+        return false;
+    batch.Erase(DB_SIGMA_BEST_BLOCK);
+    return WriteBatch(batch, true);
+}
 
 bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
     CDBBatch batch(*this);
@@ -348,57 +837,167 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+namespace {
+
+/** Number of block index records handed to a single worker during LoadBlockIndexGuts */
+const size_t BLOCK_INDEX_LOAD_CHUNK_SIZE = 4096;
+
+/** A deserialized block index record with its header hash and proof of work check, both computed by the worker */
+struct DiskBlockIndexEntry
+{
+    CDiskBlockIndex diskindex;
+    uint256 hash;
+    bool fValidPoW;
+};
+
+typedef std::pair<bool, std::vector<DiskBlockIndexEntry> > DiskBlockIndexChunk;
+
+void HashDiskBlockIndex(DiskBlockIndexEntry & entry, Consensus::Params const & consensusParams)
+{
+    entry.hash = entry.diskindex.GetBlockHash();
+    entry.fValidPoW = entry.diskindex.nNonce == 0 || CheckProofOfWork(entry.hash, entry.diskindex.nBits, consensusParams);
+}
+
+DiskBlockIndexChunk DeserializeBlockIndexChunk(std::vector<CDataStream> & records, Consensus::Params const & consensusParams)
+{
+    DiskBlockIndexChunk result;
+    result.first = true;
+    result.second.resize(records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        try {
+            records[i] >> result.second[i].diskindex;
+        } catch (const std::exception&) {
+            result.first = false;
+            result.second.clear();
+            break;
+        }
+        // Header hashing dominates loading, so it is done here rather than when the chunk is applied
+        HashDiskBlockIndex(result.second[i], consensusParams);
+    }
+    return result;
+}
+
+bool InsertDiskBlockIndex(DiskBlockIndexEntry const & entry, boost::function<CBlockIndex*(const uint256&)> const & insertBlockIndex)
+{
+    CDiskBlockIndex const & diskindex = entry.diskindex;
+
+    // Construct block index object
+    CBlockIndex* pindexNew = insertBlockIndex(entry.hash);
+    pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
+    pindexNew->nHeight        = diskindex.nHeight;
+    pindexNew->nFile          = diskindex.nFile;
+    pindexNew->nDataPos       = diskindex.nDataPos;
+    pindexNew->nUndoPos       = diskindex.nUndoPos;
+    pindexNew->nVersion       = diskindex.nVersion;
+    pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+    pindexNew->nTime          = diskindex.nTime;
+    pindexNew->nBits          = diskindex.nBits;
+    pindexNew->nNonce         = diskindex.nNonce;
+    pindexNew->nStatus        = diskindex.nStatus;
+    pindexNew->nTx            = diskindex.nTx;
+
+    pindexNew->accumulatorChanges = diskindex.accumulatorChanges;
+    pindexNew->mintedPubCoins     = diskindex.mintedPubCoins;
+    pindexNew->spentSerials       = diskindex.spentSerials;
+
+    pindexNew->sigmaMintedPubCoins   = diskindex.sigmaMintedPubCoins;
+    pindexNew->sigmaSpentSerials     = diskindex.sigmaSpentSerials;
+    pindexNew->nStakeModifier = diskindex.nStakeModifier;
+    pindexNew->vchBlockSig    = diskindex.vchBlockSig; // qtum
+
+    if (!entry.fValidPoW)
+        return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexNew->ToString());
+
+    return true;
+}
+
+}
+
+bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex, int nThreads)
 {
     auto consensusParams = Params().GetConsensus();
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
     pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
-    // Load mapBlockIndex
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
-
-                pindexNew->accumulatorChanges = diskindex.accumulatorChanges;
-                pindexNew->mintedPubCoins     = diskindex.mintedPubCoins;
-                pindexNew->spentSerials       = diskindex.spentSerials;
-
-                pindexNew->sigmaMintedPubCoins   = diskindex.sigmaMintedPubCoins;
-                pindexNew->sigmaSpentSerials     = diskindex.sigmaSpentSerials;
-                pindexNew->nStakeModifier = diskindex.nStakeModifier;
-                pindexNew->vchBlockSig    = diskindex.vchBlockSig; // qtum
-
-                if (pindexNew->nNonce != 0 && !CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, consensusParams))
-                        return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexNew->ToString());
+    if (nThreads <= 1) {
+        // Load mapBlockIndex
+        while (pcursor->Valid()) {
+            boost::this_thread::interruption_point();
+            std::pair<char, uint256> key;
+            if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
+                DiskBlockIndexEntry entry;
+                if (pcursor->GetValue(entry.diskindex)) {
+                    HashDiskBlockIndex(entry, consensusParams);
+                    if (!InsertDiskBlockIndex(entry, insertBlockIndex))
+                        return false;
+                    pcursor->Next();
+                } else {
+                    return error("LoadBlockIndex() : failed to read value");
+                }
+            } else {
+                break;
+            }
+        }
+        return true;
+    }
 
+    // The database cursor is walked on this thread while the records (which carry the zerocoin and sigma
+    // mint/spend vectors and are expensive to deserialize) are deserialized, hashed and checked against their
+    // proof of work in chunks on worker threads.
+    // Chunks are applied to mapBlockIndex in cursor order, keeping at most two chunks per worker in flight.
+    ctpl::thread_pool workerPool(nThreads);
+    RenameThreadPool(workerPool, "index-loadblk");
+
+    std::deque<std::future<DiskBlockIndexChunk> > pending;
+    auto applyFront = [&]() -> bool {
+        DiskBlockIndexChunk chunk = pending.front().get();
+        pending.pop_front();
+        if (!chunk.first)
+            return error("LoadBlockIndex() : failed to read value");
+        for (DiskBlockIndexEntry const & entry : chunk.second) {
+            if (!InsertDiskBlockIndex(entry, insertBlockIndex))
+                return false;
+        }
+        return true;
+    };
+
+    bool fSuccess = true;
+    std::vector<CDataStream> records;
+    records.reserve(BLOCK_INDEX_LOAD_CHUNK_SIZE);
+    while (fSuccess) {
+        boost::this_thread::interruption_point();
+        bool fEnd = true;
+        if (pcursor->Valid()) {
+            std::pair<char, uint256> key;
+            if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
+                records.emplace_back(pcursor->GetValue());
                 pcursor->Next();
-            } else {
-                return error("LoadBlockIndex() : failed to read value");
+                fEnd = false;
             }
-        } else {
-            break;
         }
+
+        if (records.size() >= BLOCK_INDEX_LOAD_CHUNK_SIZE || (fEnd && !records.empty())) {
+            auto chunk = std::make_shared<std::vector<CDataStream> >(std::move(records));
+            records.clear();
+            records.reserve(BLOCK_INDEX_LOAD_CHUNK_SIZE);
+            pending.emplace_back(workerPool.push([chunk, &consensusParams](int threadId) {
+                return DeserializeBlockIndexChunk(*chunk, consensusParams);
+            }));
+        }
+
+        while (fSuccess && !pending.empty() && (fEnd || pending.size() > 2 * (size_t)nThreads))
+            fSuccess = applyFront();
+
+        if (fEnd)
+            break;
     }
 
-    return true;
+    // Let the workers finish anything still queued before the pool goes out of scope
+    for (auto & f : pending)
+        f.wait();
+
+    return fSuccess;
 }
 
 int CBlockTreeDB::GetBlockIndexVersion()
@@ -9,10 +9,17 @@
 #include "coins.h"
 #include "dbwrapper.h"
 #include "chain.h"
+#include "latencystats.h"
 #include "spentindex.h"
+#include "sigmaindex.h"
 
+#include <condition_variable>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -82,6 +89,9 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
 
+    //! Like BatchWrite, but leaves mapCoins alone so that it can be read while it is written
+    bool WriteCoins(const CCoinsMap &mapCoins, const uint256 &hashBlock);
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
@@ -109,6 +119,69 @@ private:
     friend class CCoinsViewDB;
 };
 
+struct CCoinsFlushStats
+{
+    //! Time full flushes held up block validation
+    CLatencyHistogram pause;
+    //! Part of the pause spent in Sync, waiting for a write to finish
+    CLatencyHistogram wait;
+    //! Time the writes to the coins database took
+    CLatencyHistogram write;
+    uint64_t nCoinsWritten = 0;
+    //! Entries of the write in progress, zero if there is none
+    size_t nPendingCoins = 0;
+    uint256 hashPendingBlock;
+};
+
+/**
+ * Writes flushed coins to the database on a background thread, so that flushing a large cache doesn't stall block
+ * validation. BatchWrite takes the entries of the cache over and returns right away, reads are answered from them
+ * until they are on disk. Only one write is outstanding at a time: BatchWrite waits for the previous one to finish.
+ * Each write is still a single atomic batch, the database never holds coins of two different best blocks.
+ */
+class CCoinsViewBackgroundFlush : public CCoinsViewBacked
+{
+private:
+    CCoinsViewDB *db;
+
+    mutable std::mutex cs;
+    mutable std::condition_variable cond;
+    //! Entries being written and the block they are at. Not modified while fWriting is set. Kept after a failed write,
+    //! reads keep seeing them instead of the stale database.
+    std::unique_ptr<CCoinsMap> pmapWriting;
+    uint256 hashWriting;
+    bool fWriting;
+    bool fFailed;
+    bool fStop;
+    std::vector<std::function<void()> > vAfterWrite;
+    CCoinsFlushStats stats;
+    std::thread thread;
+
+    void ThreadWrite();
+    void WaitForWrite(std::unique_lock<std::mutex> &lock) const;
+
+public:
+    CCoinsViewBackgroundFlush(CCoinsViewDB *dbIn);
+    ~CCoinsViewBackgroundFlush();
+
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    bool HaveCoin(const COutPoint &outpoint) const override;
+    uint256 GetBestBlock() const override;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    CCoinsViewCursor *Cursor() const override;
+
+    /**
+     * Runs fn on the writer thread once the outstanding write is on disk, or right away if there is none. fn is
+     * dropped if the write fails. It must not take cs_main, the next flush waits for it while holding it.
+     */
+    void AfterWrite(std::function<void()> fn);
+    //! Waits for the outstanding write. Returns false if a write has failed.
+    bool Sync();
+
+    void AddPause(int64_t nMicros);
+    void GetStats(CCoinsFlushStats &statsRet) const;
+};
+
 /** Access to the block database (blocks/index/) */
 class CBlockTreeDB : public CDBWrapper
 {
@@ -136,11 +209,47 @@ public:
                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                           int start = 0, int end = 0);
 
+    /**
+     * Streams address index entries (unspent outputs) of one address in key order straight from the database cursor.
+     * Iteration starts right after pAfter if it is given and stops as soon as the visitor returns false.
+     */
+    bool ReadAddressIndex(uint160 addressHash, AddressType type, const CAddressIndexKey *pAfter, int start, int end,
+                          boost::function<bool(const CAddressIndexKey&, CAmount)> visitor);
+    bool ReadAddressUnspentIndex(uint160 addressHash, AddressType type, const CAddressUnspentKey *pAfter,
+                                 boost::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)> visitor);
+
+    /**
+     * Applies (or with fUndo reverts) a block's address index entries to the per-address aggregates, and its
+     * nSupplyDelta to the total supply. The update is skipped if the aggregates aren't at hashFrom, i.e. the block was
+     * already applied before an unclean shutdown or is reconnected by VerifyDB.
+     */
+    bool UpdateAddressBalanceIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect, bool fUndo,
+                                   const uint256 &hashFrom, const uint256 &hashTo, CAmount nSupplyDelta = 0);
+    bool ReadAddressBalanceIndex(uint160 addressHash, AddressType type, CAddressBalanceValue &value);
+    bool ReadAddressBalanceBestBlock(uint256 &hashBestBlock);
+    //! Recomputes all per-address aggregates from the address index entries up to nMaxHeight
+    bool RebuildAddressBalanceIndex(int nMaxHeight, const uint256 &hashBestBlock);
+
+    /**
+     * Adds (or with fUndo removes) a block's sigma mints and spends. As for the address balances the update is skipped
+     * if the index isn't at hashFrom, i.e. the block was already applied before an unclean shutdown.
+     */
+    bool UpdateSigmaIndex(const CSigmaIndexBlock &block, bool fUndo, const uint256 &hashFrom, const uint256 &hashTo);
+    bool ReadSigmaMint(const uint256 &pubCoinValueHash, CSigmaMintIndexKey &key, CSigmaMintIndexValue &value);
+    bool ReadSigmaSpend(const uint256 &serialHash, CSigmaSpendIndexValue &value);
+    bool ReadSigmaIndexBestBlock(uint256 &hashBestBlock);
+    //! Drops all sigma mints and spends, they are then added again block by block
+    bool WipeSigmaIndex();
+
     bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &vect);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
-    bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+    /**
+     * Loads all block index records through insertBlockIndex. With nThreads > 1 the records are
+     * deserialized in parallel chunks while the database cursor keeps prefetching.
+     */
+    bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex, int nThreads = 1);
     int GetBlockIndexVersion();
     int GetBlockIndexVersion(uint256 const & blockHash);
     bool AddTotalSupply(CAmount const & supply);
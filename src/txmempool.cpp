@@ -560,6 +560,9 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
         eraseProTxRef(proTx.proTxHash, it->GetTx().GetHash());
     }
 
+    removeAddressIndex(hash);
+    removeSpentIndex(hash);
+
     totalTxSize -= it->GetTxSize();
     cachedInnerUsage -= it->DynamicMemoryUsage();
     cachedInnerUsage -= memusage::DynamicUsage(mapLinks[it].parents) + memusage::DynamicUsage(mapLinks[it].children);
@@ -573,6 +576,7 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
 {
     LOCK(cs);
     const CTransaction& tx = entry.GetTx();
+    CMempoolAddressIndex::DeltaList deltas;
     std::vector<CMempoolAddressDeltaKey> inserted;
 
     uint256 txhash = tx.GetHash();
@@ -587,13 +591,13 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
             vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22);
             CMempoolAddressDeltaKey key(AddressType::payToScriptHash, uint160(hashBytes), txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(make_pair(key, delta));
+            deltas.push_back(make_pair(key, delta));
             inserted.push_back(key);
         } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
             vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23);
             CMempoolAddressDeltaKey key(AddressType::payToPubKeyHash, uint160(hashBytes), txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(make_pair(key, delta));
+            deltas.push_back(make_pair(key, delta));
             inserted.push_back(key);
         }
     }
@@ -603,29 +607,27 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
         if (out.scriptPubKey.IsPayToScriptHash()) {
             vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
             CMempoolAddressDeltaKey key(AddressType::payToScriptHash, uint160(hashBytes), txhash, k, 0);
-            mapAddress.insert(make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
+            deltas.push_back(make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
             inserted.push_back(key);
         } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
             vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-            std::pair<addressDeltaMap::iterator,bool> ret;
             CMempoolAddressDeltaKey key(AddressType::payToPubKeyHash, uint160(hashBytes), txhash, k, 0);
-            mapAddress.insert(make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
+            deltas.push_back(make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
             inserted.push_back(key);
         }
     }
 
+    addressIndex.Add(deltas);
     mapAddressInserted.insert(make_pair(txhash, inserted));
 }
 
 bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, AddressType> > &addresses,
-                                 std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results)
+                                 std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results) const
 {
-    LOCK(cs);
     for (std::vector<std::pair<uint160, AddressType> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        addressDeltaMap::iterator ait = mapAddress.lower_bound(CMempoolAddressDeltaKey((*it).second, (*it).first));
-        while (ait != mapAddress.end() && (*ait).first.addressBytes == (*it).first && (*ait).first.type == (*it).second) {
-            results.push_back(*ait);
-            ait++;
+        CMempoolAddressIndex::DeltaListRef deltas = addressIndex.Get((*it).first, (*it).second);
+        if (deltas) {
+            results.insert(results.end(), deltas->begin(), deltas->end());
         }
     }
     return true;
@@ -637,10 +639,7 @@ bool CTxMemPool::removeAddressIndex(const uint256 txhash)
     addressDeltaMapInserted::iterator it = mapAddressInserted.find(txhash);
 
     if (it != mapAddressInserted.end()) {
-        std::vector<CMempoolAddressDeltaKey> keys = (*it).second;
-        for (std::vector<CMempoolAddressDeltaKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapAddress.erase(*mit);
-        }
+        addressIndex.Remove((*it).second);
         mapAddressInserted.erase(it);
     }
 
@@ -652,6 +651,7 @@ void CTxMemPool::addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCac
     LOCK(cs);
 
     const CTransaction& tx = entry.GetTx();
+    std::vector<CMempoolSpentIndex::Entry> entries;
     std::vector<CSpentIndexKey> inserted;
 
     uint256 txhash = tx.GetHash();
@@ -679,25 +679,18 @@ void CTxMemPool::addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCac
         CSpentIndexKey key = CSpentIndexKey(input.prevout.hash, input.prevout.n);
         CSpentIndexValue value = CSpentIndexValue(txhash, j, -1, prevout.nValue, addressType, addressHash);
 
-        mapSpent.insert(make_pair(key, value));
+        entries.push_back(make_pair(key, value));
         inserted.push_back(key);
 
     }
 
+    spentIndex.Add(entries);
     mapSpentInserted.insert(make_pair(txhash, inserted));
 }
 
-bool CTxMemPool::getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
+bool CTxMemPool::getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) const
 {
-    LOCK(cs);
-    mapSpentIndex::iterator it;
-
-    it = mapSpent.find(key);
-    if (it != mapSpent.end()) {
-        value = it->second;
-        return true;
-    }
-    return false;
+    return spentIndex.Get(key, value);
 }
 
 bool CTxMemPool::removeSpentIndex(const uint256 txhash)
@@ -706,10 +699,7 @@ bool CTxMemPool::removeSpentIndex(const uint256 txhash)
     mapSpentIndexInserted::iterator it = mapSpentInserted.find(txhash);
 
     if (it != mapSpentInserted.end()) {
-        std::vector<CSpentIndexKey> keys = (*it).second;
-        for (std::vector<CSpentIndexKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapSpent.erase(*mit);
-        }
+        spentIndex.Remove((*it).second);
         mapSpentInserted.erase(it);
     }
 
@@ -1017,6 +1007,10 @@ void CTxMemPool::_clear()
     mapNextTx.clear();
     mapProTxAddresses.clear();
     mapProTxPubKeyIDs.clear();
+    addressIndex.Clear();
+    mapAddressInserted.clear();
+    spentIndex.Clear();
+    mapSpentInserted.clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
     lastRollingFeeUpdate = GetTime();
@@ -1718,3 +1712,133 @@ void CTxPoolAggregate::removeRecursive(const CTransaction &tx, MemPoolRemovalRea
 }
 
 SaltedTxidHasher::SaltedTxidHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+CMempoolAddressIndex::AddressKeyHasher::AddressKeyHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+size_t CMempoolAddressIndex::AddressKeyHasher::operator()(const AddressKey &key) const
+{
+    return CSipHasher(k0, k1).Write(key.first.begin(), key.first.size()).Write((uint64_t)key.second).Finalize();
+}
+
+CMempoolAddressIndex::CMempoolAddressIndex() {}
+
+void CMempoolAddressIndex::Add(const DeltaList &deltas)
+{
+    // Group the tx's entries per address so that each list is copied once
+    std::map<AddressKey, DeltaList> grouped;
+    for (const Delta &delta : deltas)
+        grouped[std::make_pair(delta.first.addressBytes, delta.first.type)].push_back(delta);
+
+    CMempoolAddressDeltaKeyCompare const compare;
+    for (auto &group : grouped) {
+        Shard &shard = GetShard(group.first);
+        std::lock_guard<std::mutex> lock(shard.cs);
+        DeltaListRef &current = shard.map[group.first];
+
+        std::shared_ptr<DeltaList> updated = std::make_shared<DeltaList>();
+        updated->reserve((current ? current->size() : 0) + group.second.size());
+        if (current)
+            updated->insert(updated->end(), current->begin(), current->end());
+        for (const Delta &delta : group.second) {
+            auto pos = std::lower_bound(updated->begin(), updated->end(), delta,
+                    [&compare](const Delta &a, const Delta &b) { return compare(a.first, b.first); });
+            if (pos != updated->end() && !compare(delta.first, pos->first))
+                continue;   // already there, same as std::map::insert
+            updated->insert(pos, delta);
+        }
+        current = updated;
+    }
+}
+
+void CMempoolAddressIndex::Remove(const std::vector<CMempoolAddressDeltaKey> &keys)
+{
+    std::map<AddressKey, std::vector<CMempoolAddressDeltaKey> > grouped;
+    for (const CMempoolAddressDeltaKey &key : keys)
+        grouped[std::make_pair(key.addressBytes, key.type)].push_back(key);
+
+    CMempoolAddressDeltaKeyCompare const compare;
+    for (auto &group : grouped) {
+        Shard &shard = GetShard(group.first);
+        std::lock_guard<std::mutex> lock(shard.cs);
+        auto it = shard.map.find(group.first);
+        if (it == shard.map.end())
+            continue;
+
+        std::shared_ptr<DeltaList> updated = std::make_shared<DeltaList>();
+        updated->reserve(it->second->size());
+        for (const Delta &delta : *it->second) {
+            bool fRemoved = false;
+            for (const CMempoolAddressDeltaKey &key : group.second) {
+                if (!compare(key, delta.first) && !compare(delta.first, key)) {
+                    fRemoved = true;
+                    break;
+                }
+            }
+            if (!fRemoved)
+                updated->push_back(delta);
+        }
+
+        if (updated->empty())
+            shard.map.erase(it);
+        else
+            it->second = updated;
+    }
+}
+
+CMempoolAddressIndex::DeltaListRef CMempoolAddressIndex::Get(const uint160 &addressHash, AddressType type) const
+{
+    AddressKey key(addressHash, type);
+    const Shard &shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.cs);
+    auto it = shard.map.find(key);
+    return it != shard.map.end() ? it->second : DeltaListRef();
+}
+
+void CMempoolAddressIndex::Clear()
+{
+    for (Shard &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.cs);
+        shard.map.clear();
+    }
+}
+
+CMempoolSpentIndex::SpentKeyHasher::SpentKeyHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+CMempoolSpentIndex::CMempoolSpentIndex() {}
+
+void CMempoolSpentIndex::Add(const std::vector<Entry> &entries)
+{
+    for (const Entry &entry : entries) {
+        Shard &shard = GetShard(entry.first);
+        std::lock_guard<std::mutex> lock(shard.cs);
+        shard.map.insert(entry);
+    }
+}
+
+void CMempoolSpentIndex::Remove(const std::vector<CSpentIndexKey> &keys)
+{
+    for (const CSpentIndexKey &key : keys) {
+        Shard &shard = GetShard(key);
+        std::lock_guard<std::mutex> lock(shard.cs);
+        shard.map.erase(key);
+    }
+}
+
+bool CMempoolSpentIndex::Get(const CSpentIndexKey &key, CSpentIndexValue &value) const
+{
+    const Shard &shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.cs);
+    auto it = shard.map.find(key);
+    if (it == shard.map.end())
+        return false;
+    value = it->second;
+    return true;
+}
+
+void CMempoolSpentIndex::Clear()
+{
+    for (Shard &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.cs);
+        shard.map.clear();
+    }
+}
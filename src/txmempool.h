@@ -7,7 +7,9 @@
 #define BITCOIN_TXMEMPOOL_H
 
 #include <memory>
+#include <mutex>
 #include <set>
+#include <unordered_map>
 #include "addressindex.h"
 #include "spentindex.h"
 #include <map>
@@ -34,6 +36,8 @@
 class CAutoFile;
 class CBlockIndex;
 
+namespace sigma { struct CSigmaSpendSummary; }
+
 inline double AllowFreeThreshold()
 {
     return COIN * 576 / 250;
@@ -114,6 +118,9 @@ private:
     CAmount nModFeesWithAncestors;
     int64_t nSigOpCostWithAncestors;
 
+    //! Parsed spend inputs of a sigma spend, so the miner and conflict checks don't reparse the proofs
+    std::shared_ptr<const sigma::CSigmaSpendSummary> sigmaSpendSummary;
+
 public:
     CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFee,
                     int64_t _nTime, unsigned int _entryHeight,
@@ -138,6 +145,9 @@ public:
     int64_t GetModifiedFee() const { return nFee + feeDelta; }
     size_t DynamicMemoryUsage() const { return nUsageSize; }
     const LockPoints& GetLockPoints() const { return lockPoints; }
+    //! Null unless the transaction is a sigma spend accepted through AcceptToMemoryPool
+    const sigma::CSigmaSpendSummary* GetSigmaSpendSummary() const { return sigmaSpendSummary.get(); }
+    void SetSigmaSpendSummary(std::shared_ptr<const sigma::CSigmaSpendSummary> summary) { sigmaSpendSummary = std::move(summary); }
 
     // Adjusts the descendant state, if this entry is not dirty.
     void UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
@@ -369,6 +379,91 @@ public:
     }
 };
 
+/**
+ * Mempool address index (-addressindex). Entries are grouped per address into immutable lists which are replaced as a
+ * whole on every change, readers only take a short per-shard lock to grab a reference to the current list. Lookups
+ * therefore never wait for CTxMemPool::cs and never hold a lock while the result is being built.
+ */
+class CMempoolAddressIndex
+{
+public:
+    typedef std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> Delta;
+    typedef std::vector<Delta> DeltaList;
+    typedef std::shared_ptr<const DeltaList> DeltaListRef;
+
+    CMempoolAddressIndex();
+
+    void Add(const DeltaList &deltas);
+    void Remove(const std::vector<CMempoolAddressDeltaKey> &keys);
+    //! Returns a snapshot of the entries of the address sorted by key, or null if there are none
+    DeltaListRef Get(const uint160 &addressHash, AddressType type) const;
+    void Clear();
+
+private:
+    typedef std::pair<uint160, AddressType> AddressKey;
+
+    class AddressKeyHasher
+    {
+    private:
+        const uint64_t k0, k1;
+    public:
+        AddressKeyHasher();
+        size_t operator()(const AddressKey &key) const;
+    };
+
+    static const size_t SHARD_COUNT = 16;
+
+    struct Shard {
+        mutable std::mutex cs;
+        std::unordered_map<AddressKey, DeltaListRef, AddressKeyHasher> map;
+    };
+
+    AddressKeyHasher hasher;
+    Shard shards[SHARD_COUNT];
+
+    Shard &GetShard(const AddressKey &key) { return shards[hasher(key) % SHARD_COUNT]; }
+    const Shard &GetShard(const AddressKey &key) const { return shards[hasher(key) % SHARD_COUNT]; }
+};
+
+/** Mempool spent index (-spentindex), a sharded hash map so that lookups don't contend with CTxMemPool::cs. */
+class CMempoolSpentIndex
+{
+public:
+    typedef std::pair<CSpentIndexKey, CSpentIndexValue> Entry;
+
+    CMempoolSpentIndex();
+
+    void Add(const std::vector<Entry> &entries);
+    void Remove(const std::vector<CSpentIndexKey> &keys);
+    bool Get(const CSpentIndexKey &key, CSpentIndexValue &value) const;
+    void Clear();
+
+private:
+    class SpentKeyHasher
+    {
+    private:
+        const uint64_t k0, k1;
+    public:
+        SpentKeyHasher();
+        size_t operator()(const CSpentIndexKey &key) const {
+            return SipHashUint256Extra(k0, k1, key.txid, key.outputIndex);
+        }
+    };
+
+    static const size_t SHARD_COUNT = 16;
+
+    struct Shard {
+        mutable std::mutex cs;
+        std::unordered_map<CSpentIndexKey, CSpentIndexValue, SpentKeyHasher> map;
+    };
+
+    SpentKeyHasher hasher;
+    Shard shards[SHARD_COUNT];
+
+    Shard &GetShard(const CSpentIndexKey &key) { return shards[hasher(key) % SHARD_COUNT]; }
+    const Shard &GetShard(const CSpentIndexKey &key) const { return shards[hasher(key) % SHARD_COUNT]; }
+};
+
 /**
  * CTxMemPool stores valid-according-to-the-current-best-chain transactions
  * that may be included in the next block.
@@ -527,16 +622,15 @@ private:
     typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
     txlinksMap mapLinks;
 
-    typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> addressDeltaMap;
-    addressDeltaMap mapAddress;
+    // The lookup side of the address and spent indexes has its own locking, the per-tx bookkeeping is guarded by cs
+    CMempoolAddressIndex addressIndex;
 
-    typedef std::map<uint256, std::vector<CMempoolAddressDeltaKey> > addressDeltaMapInserted;
+    typedef std::unordered_map<uint256, std::vector<CMempoolAddressDeltaKey>, SaltedTxidHasher> addressDeltaMapInserted;
     addressDeltaMapInserted mapAddressInserted;
 
-    typedef std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare> mapSpentIndex;
-    mapSpentIndex mapSpent;
+    CMempoolSpentIndex spentIndex;
 
-    typedef std::map<uint256, std::vector<CSpentIndexKey> > mapSpentIndexInserted;
+    typedef std::unordered_map<uint256, std::vector<CSpentIndexKey>, SaltedTxidHasher> mapSpentIndexInserted;
     mapSpentIndexInserted mapSpentInserted;
 
     std::multimap<uint256, uint256> mapProTxRefs; // proTxHash -> transaction (all TXs that refer to an existing proTx)
@@ -576,12 +670,14 @@ public:
     bool addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry, setEntries &setAncestors, bool validFeeEstimate = true);
 
     void addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
+    //! Doesn't take cs, see CMempoolAddressIndex
     bool getAddressIndex(std::vector<std::pair<uint160, AddressType> > &addresses,
-                         std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results);
+                         std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results) const;
     bool removeAddressIndex(const uint256 txhash);
 
     void addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
-    bool getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
+    //! Doesn't take cs, see CMempoolSpentIndex
+    bool getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) const;
     bool removeSpentIndex(const uint256 txhash);
 
     void removeRecursive(const CTransaction &tx, MemPoolRemovalReason reason = MemPoolRemovalReason::UNKNOWN);
@@ -88,6 +88,9 @@
 #include <boost/program_options/detail/config_file.hpp>
 #include <boost/program_options/parsers.hpp>
 #include <boost/thread.hpp>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <openssl/crypto.h>
 #include <openssl/rand.h>
 #include <openssl/conf.h>
@@ -125,6 +128,7 @@ bool fPrintToDebugLog = true;
 bool fLogTimestamps = DEFAULT_LOGTIMESTAMPS;
 bool fLogTimeMicros = DEFAULT_LOGTIMEMICROS;
 bool fLogIPs = DEFAULT_LOGIPS;
+std::atomic<int> nLogRateLimit(DEFAULT_DEBUG_RATE_LIMIT);
 
 
 std::atomic<bool> fReopenDebugLog(false);
@@ -210,6 +214,37 @@ static FILE* fileout = NULL;
 static boost::mutex* mutexDebugLog = NULL;
 static list<string> *vMsgsBeforeOpenLog;
 
+/** Bytes of queued log messages at which LogPrintStr waits for the writer thread to catch up */
+static const size_t MAX_LOG_QUEUE_BYTES = 8 * 1024 * 1024;
+/** Seconds between fsyncs of debug.log while the writer thread is running */
+static const int64_t LOG_FSYNC_INTERVAL = 10;
+
+/**
+ * State of the debug.log writer thread. Like mutexDebugLog it is created once
+ * and leaked, so logging from global destructors keeps working.
+ */
+struct CLogWriterState
+{
+    std::mutex cs;
+    std::condition_variable condQueued;
+    std::condition_variable condSpace;
+    std::vector<std::string> vQueue;
+    size_t nQueueBytes = 0;
+    bool fActive = false;
+    std::thread thread;
+};
+static CLogWriterState* logWriter = NULL;
+
+/** Per category state for -debugratelimit */
+struct CLogRateState
+{
+    int64_t nWindowStart = 0;
+    int nMessages = 0;
+    int nSuppressed = 0;
+};
+static std::mutex* mutexLogRate = NULL;
+static std::map<std::string, CLogRateState>* mapLogRate = NULL;
+
 static int FileWriteStr(const std::string &str, FILE *fp)
 {
     return fwrite(str.data(), 1, str.size(), fp);
@@ -220,6 +255,9 @@ static void DebugPrintInit()
     assert(mutexDebugLog == NULL);
     mutexDebugLog = new boost::mutex();
     vMsgsBeforeOpenLog = new list<string>;
+    logWriter = new CLogWriterState();
+    mutexLogRate = new std::mutex();
+    mapLogRate = new std::map<std::string, CLogRateState>();
 }
 
 void OpenDebugLog()
@@ -276,6 +314,35 @@ bool LogAcceptCategory(const char* category)
     return true;
 }
 
+bool LogAcceptRate(const char* category)
+{
+    int nLimit = nLogRateLimit;
+    if (nLimit <= 0 || category == NULL)
+        return true;
+
+    boost::call_once(&DebugPrintInit, debugPrintInitFlag);
+    int64_t nNow = GetTime();
+    int nSuppressed = 0;
+    {
+        std::lock_guard<std::mutex> lock(*mutexLogRate);
+        CLogRateState& state = (*mapLogRate)[category];
+        if (nNow != state.nWindowStart) {
+            nSuppressed = state.nSuppressed;
+            state.nWindowStart = nNow;
+            state.nMessages = 0;
+            state.nSuppressed = 0;
+        }
+        if (state.nMessages >= nLimit) {
+            state.nSuppressed++;
+            return false;
+        }
+        state.nMessages++;
+    }
+    if (nSuppressed > 0)
+        LogPrintStr(strprintf("Suppressed %d %s messages over -debugratelimit=%d\n", nSuppressed, category, nLimit));
+    return true;
+}
+
 /**
  * fStartedNewLine is a state variable held by the calling context that will
  * suppress printing of the timestamp when multiple calls are made that don't
@@ -321,6 +388,24 @@ int LogPrintStr(const std::string &str)
     else if (fPrintToDebugLog)
     {
         boost::call_once(&DebugPrintInit, debugPrintInitFlag);
+
+        // Queue for the writer thread when it is running. The writer's own messages
+        // are written directly, it can't wait for itself.
+        {
+            std::unique_lock<std::mutex> lock(logWriter->cs);
+            if (logWriter->fActive && std::this_thread::get_id() != logWriter->thread.get_id()) {
+                logWriter->condSpace.wait(lock, [] { return !logWriter->fActive || logWriter->nQueueBytes < MAX_LOG_QUEUE_BYTES; });
+                if (logWriter->fActive) {
+                    ret = strTimestamped.size();
+                    logWriter->nQueueBytes += strTimestamped.size();
+                    logWriter->vQueue.push_back(std::move(strTimestamped));
+                    if (logWriter->vQueue.size() == 1)
+                        logWriter->condQueued.notify_one();
+                    return ret;
+                }
+            }
+        }
+
         boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
 
         // buffer if we haven't opened the log yet
@@ -345,6 +430,86 @@ int LogPrintStr(const std::string &str)
     return ret;
 }
 
+static void ThreadLogWriter()
+{
+    RenameThread("index-logwriter");
+
+    std::vector<std::string> vBatch;
+    std::string strBatch;
+    int64_t nLastFsync = GetTime();
+    bool fUnsynced = false;
+    std::unique_lock<std::mutex> lock(logWriter->cs);
+    while (true) {
+        logWriter->condQueued.wait_for(lock, std::chrono::seconds(LOG_FSYNC_INTERVAL),
+            [] { return !logWriter->vQueue.empty() || !logWriter->fActive; });
+        bool fStop = !logWriter->fActive;
+        vBatch.swap(logWriter->vQueue);
+        logWriter->nQueueBytes = 0;
+        logWriter->condSpace.notify_all();
+        lock.unlock();
+
+        // debug.log is unbuffered, so join the batch and write it with a single call
+        strBatch.clear();
+        for (const std::string& str : vBatch)
+            strBatch += str;
+        vBatch.clear();
+        if (!strBatch.empty()) {
+            boost::mutex::scoped_lock scoped_lock(*mutexDebugLog);
+            if (fileout == NULL) {
+                assert(vMsgsBeforeOpenLog);
+                vMsgsBeforeOpenLog->push_back(strBatch);
+            } else {
+                if (fReopenDebugLog) {
+                    fReopenDebugLog = false;
+                    boost::filesystem::path pathDebug = GetDataDir() / "debug.log";
+                    if (freopen(pathDebug.string().c_str(),"a",fileout) != NULL)
+                        setbuf(fileout, NULL); // unbuffered
+                }
+                FileWriteStr(strBatch, fileout);
+                fUnsynced = true;
+            }
+        }
+        if (fUnsynced && (fStop || GetTime() - nLastFsync >= LOG_FSYNC_INTERVAL)) {
+            FileCommit(fileout);
+            fUnsynced = false;
+            nLastFsync = GetTime();
+        }
+
+        lock.lock();
+        if (fStop && logWriter->vQueue.empty())
+            break;
+    }
+}
+
+void StartLogWriter()
+{
+    if (fPrintToConsole || !fPrintToDebugLog)
+        return;
+
+    boost::call_once(&DebugPrintInit, debugPrintInitFlag);
+    std::lock_guard<std::mutex> lock(logWriter->cs);
+    if (logWriter->fActive)
+        return;
+    logWriter->fActive = true;
+    logWriter->thread = std::thread(ThreadLogWriter);
+}
+
+void StopLogWriter()
+{
+    if (logWriter == NULL)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(logWriter->cs);
+        if (!logWriter->fActive)
+            return;
+        logWriter->fActive = false;
+        logWriter->condQueued.notify_one();
+        logWriter->condSpace.notify_all();
+    }
+    logWriter->thread.join();
+}
+
 /** Interpret string as boolean, for argument parsing */
 static bool InterpretBool(const std::string& strValue)
 {
@@ -35,6 +35,10 @@
 static const bool DEFAULT_LOGTIMEMICROS = false;
 static const bool DEFAULT_LOGIPS        = false;
 static const bool DEFAULT_LOGTIMESTAMPS = true;
+/** Default for -logasync, write debug.log from a background thread */
+static const bool DEFAULT_LOGASYNC      = true;
+/** Default for -debugratelimit, messages per second per LogPrint category, 0 for no limit */
+static const int DEFAULT_DEBUG_RATE_LIMIT = 0;
 
 /** Signals for translation. */
 class CTranslationInterface
@@ -55,6 +59,7 @@ extern bool fPrintToDebugLog;
 extern bool fLogTimestamps;
 extern bool fLogTimeMicros;
 extern bool fLogIPs;
+extern std::atomic<int> nLogRateLimit;
 extern std::atomic<bool> fReopenDebugLog;
 extern CTranslationInterface translationInterface;
 
@@ -90,11 +95,17 @@ bool SetupNetworking();
 
 /** Return true if log accepts specified category */
 bool LogAcceptCategory(const char* category);
+/** Return true if a message for the accepted category is within -debugratelimit */
+bool LogAcceptRate(const char* category);
 /** Send a string to the log output */
 int LogPrintStr(const std::string &str);
+/** Hand debug.log writes to a background thread from now on */
+void StartLogWriter();
+/** Write out everything queued and go back to writing debug.log directly */
+void StopLogWriter();
 
 #define LogPrint(category, ...) do { \
-    if (LogAcceptCategory((category))) { \
+    if (LogAcceptCategory((category)) && LogAcceptRate((category))) { \
         LogPrintStr(tfm::format(__VA_ARGS__)); \
     } \
 } while(0)
@@ -13,6 +13,7 @@
 
 #include "arith_uint256.h"
 #include "blacklist/blacklist.h"
+#include "blockcache.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
@@ -74,7 +75,11 @@
 #include "llmq/quorums_instantsend.h"
 #include "llmq/quorums_chainlocks.h"
 
+#include "ctpl.h"
+
 #include <atomic>
+#include <deque>
+#include <future>
 #include <sstream>
 #include <chrono>
 
@@ -118,6 +123,7 @@ bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
 size_t nCoinCacheUsage = 5000 * 300;
+bool fCoinsBackgroundFlush = DEFAULT_DB_BACKGROUND_FLUSH;
 uint64_t nPruneTarget = 0;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
 bool fEnableReplacement = DEFAULT_ENABLE_REPLACEMENT;
@@ -265,6 +271,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 }
 
 CCoinsViewCache *pcoinsTip = NULL;
+CCoinsViewBackgroundFlush *pcoinsflusher = NULL;
 CBlockTreeDB *pblocktree = NULL;
 
 enum FlushStateMode {
@@ -795,6 +802,7 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
     sigma::CSigmaState *sigmaState = sigma::CSigmaState::GetState();
     vector<Scalar> zcSpendSerialsV3;
     vector<GroupElement> zcMintPubcoinsV3;
+    std::shared_ptr<const sigma::CSigmaSpendSummary> sigmaSpendSummary;
     {
     LOCK(pool.cs); // protect pool.mapNextTx
     if (tx.IsZerocoinSpend()) {
@@ -824,20 +832,24 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
         zcSpendSerials.push_back(zcSpendSerial);
     }
     else if (tx.IsSigmaSpend()) {
+        // Parse the spends once, the summary is kept on the mempool entry
+        std::shared_ptr<sigma::CSigmaSpendSummary> summary = std::make_shared<sigma::CSigmaSpendSummary>();
+        if (!sigma::GetSigmaSpendSummary(tx, *summary))
+            return state.Invalid(false, REJECT_INVALID, "txn-invalid-zerocoin-spend");
 
-        BOOST_FOREACH(const CTxIn &txin, tx.vin)
+        for (const sigma::CSigmaSpendHeader& spend : summary->spends)
         {
-            Scalar zcSpendSerial = sigma::GetSigmaSpendSerialNumber(tx, txin);
             Scalar zero;
 
-            if (zcSpendSerial == zero)
+            if (spend.serial == zero)
                 return state.Invalid(false, REJECT_INVALID, "txn-invalid-zerocoin-spend");
-            if (!sigmaState->CanAddSpendToMempool(zcSpendSerial)) {
-                LogPrintf("AcceptToMemoryPool(): sigma serial number %s has been used\n", zcSpendSerial.tostring());
+            if (!sigmaState->CanAddSpendToMempool(spend.serial)) {
+                LogPrintf("AcceptToMemoryPool(): sigma serial number %s has been used\n", spend.serial.tostring());
                 return state.Invalid(false, REJECT_CONFLICT, "txn-mempool-conflict");
             }
-            zcSpendSerialsV3.push_back(zcSpendSerial);
+            zcSpendSerialsV3.push_back(spend.serial);
         }
+        sigmaSpendSummary = summary;
     }
     else {
         BOOST_FOREACH(const CTxIn &txin, tx.vin)
@@ -951,7 +963,7 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
             //
         }
         else if (tx.IsSigmaSpend()) {
-            nValueIn = sigma::GetSigmaSpendInput(tx);
+            nValueIn = sigmaSpendSummary->nAmount;
         }
 
         // we have all inputs cached now, so switch back to dummy, so we don't need to keep lock on mempool
@@ -993,6 +1005,7 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
 
             CTxMemPoolEntry entry(ptx, nFees, nAcceptTime, chainActive.Height(),
                                 inChainInputValue, fSpendsCoinbase, nSigOpsCost, lp);
+            entry.SetSigmaSpendSummary(sigmaSpendSummary);
             unsigned int nSize = entry.GetTxSize();
 
             // Check that the transaction doesn't have an excessive number of
@@ -1308,6 +1321,7 @@ bool AcceptToMemoryPoolWorker(CTxMemPool& pool, CValidationState& state, const C
             CTxMemPool::setEntries setAncestors;
             CTxMemPoolEntry entry(ptx, nFees, GetTime(), chainActive.Height(),
                                 inChainInputValue, fSpendsCoinbase, nSigOpsCost, lp);
+            entry.SetSigmaSpendSummary(sigmaSpendSummary);
             pool.addUnchecked(hash, entry, setAncestors, !IsInitialBlockDownload());
             if (tx.IsZerocoinSpend()) {
                 pool.countZCSpend++;
@@ -1485,6 +1499,41 @@ bool GetAddressUnspent(uint160 addressHash, AddressType type,
     return true;
 }
 
+bool GetAddressIndex(uint160 addressHash, AddressType type, const CAddressIndexKey *pAfter, int start, int end,
+                     boost::function<bool(const CAddressIndexKey&, CAmount)> visitor)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressIndex(addressHash, type, pAfter, start, end, visitor))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
+bool GetAddressUnspent(uint160 addressHash, AddressType type, const CAddressUnspentKey *pAfter,
+                       boost::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)> visitor)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, pAfter, visitor))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
+bool GetAddressBalance(uint160 addressHash, AddressType type, CAddressBalanceValue &value)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressBalanceIndex(addressHash, type, value))
+        return error("unable to get balance for address");
+
+    return true;
+}
+
 
 
 //////////////////////////////////////////////////////////////////////////////
@@ -1548,6 +1597,56 @@ bool ReadBlockFromDisk(CBlock &block, const CBlockIndex *pindex, const Consensus
     return true;
 }
 
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart)
+{
+    // WriteBlockToDisk puts the message start and the length right before the block
+    CDiskBlockPos pos = pindex->GetBlockPos();
+    if (pos.nPos < CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int))
+        return error("%s: invalid block position %s", __func__, pos.ToString());
+    pos.nPos -= CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int);
+
+    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+
+    try {
+        CMessageHeader::MessageStartChars blockStart;
+        unsigned int nSize;
+        filein >> FLATDATA(blockStart) >> nSize;
+        if (memcmp(blockStart, messageStart, CMessageHeader::MESSAGE_START_SIZE) != 0)
+            return error("%s: block magic mismatch at %s", __func__, pos.ToString());
+        if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+            return error("%s: invalid block size %u at %s", __func__, nSize, pos.ToString());
+        block.resize(nSize);
+        filein.read((char*)block.data(), nSize);
+    }
+    catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+    }
+
+    // The header fields are stored in the index, compare bytes instead of hashing the header
+    CDataStream ssHeader(SER_DISK, CLIENT_VERSION);
+    ssHeader << pindex->GetBlockHeader();
+    if (ssHeader.size() > block.size() || memcmp(ssHeader.data(), block.data(), ssHeader.size()) != 0)
+        return error("%s: block header doesn't match index for %s at %s", __func__, pindex->ToString(), pindex->GetBlockPos().ToString());
+    return true;
+}
+
+std::shared_ptr<const CBlock> ReadBlockFromDiskCached(const CBlockIndex* pindex, const Consensus::Params& consensusParams, bool fStore)
+{
+    uint256 hash = pindex->GetBlockHash();
+    std::shared_ptr<const CBlock> pblock = blockCache.Get(hash);
+    if (pblock)
+        return pblock;
+
+    std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+    if (!ReadBlockFromDisk(*pblockRead, pindex, consensusParams))
+        return nullptr;
+    if (fStore)
+        blockCache.Insert(hash, pblockRead);
+    return pblockRead;
+}
+
 bool ReadBlockHeaderFromDisk(CBlock &block, const CDiskBlockPos &pos) {
     CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
@@ -2193,12 +2292,21 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
                 error("Failed to write address unspent index");
                 return DISCONNECT_FAILED;
             }
-            if (!pblocktree->AddTotalSupply(-(block.vtx[0]->GetValueOut() - nFees))) {
-                AbortNode(state, "Failed to write total supply");
-                error("Failed to write total supply");
+            if (!pblocktree->UpdateAddressBalanceIndex(dbIndexHelper.getAddressIndex(), true, pindex->GetBlockHash(), pindex->pprev->GetBlockHash(),
+                                                       block.vtx[0]->GetValueOut() - nFees)) {
+                AbortNode(state, "Failed to write address balance index");
+                error("Failed to write address balance index");
                 return DISCONNECT_FAILED;
             }
         }
+
+        CSigmaIndexBlock sigmaIndexEntries;
+        sigma::GetSigmaIndexEntries(pindex, NULL, sigmaIndexEntries);
+        if (!pblocktree->UpdateSigmaIndex(sigmaIndexEntries, true, pindex->GetBlockHash(), pindex->pprev->GetBlockHash())) {
+            AbortNode(state, "Failed to write sigma index");
+            error("Failed to write sigma index");
+            return DISCONNECT_FAILED;
+        }
     }
 
     /*
@@ -2743,8 +2851,11 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (!pblocktree->UpdateAddressUnspentIndex(dbIndexHelper.getAddressUnspentIndex()))
             return AbortNode(state, "Failed to write address unspent index");
 
-        if (!pblocktree->AddTotalSupply(block.vtx[0]->GetValueOut() - nFees))
-            return AbortNode(state, "Failed to write total supply");
+        // Also updates the total supply, unless the block was counted already (VerifyDB reconnecting it, or a replay
+        // after an unclean shutdown)
+        if (!pblocktree->UpdateAddressBalanceIndex(dbIndexHelper.getAddressIndex(), false, pindex->pprev->GetBlockHash(), pindex->GetBlockHash(),
+                                                   block.vtx[0]->GetValueOut() - nFees))
+            return AbortNode(state, "Failed to write address balance index");
     }
 
     if (fSpentIndex)
@@ -2756,6 +2867,11 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash())))
             return AbortNode(state, "Failed to write timestamp index");
 
+    CSigmaIndexBlock sigmaIndexEntries;
+    sigma::GetSigmaIndexEntries(pindex, &block, sigmaIndexEntries);
+    if (!pblocktree->UpdateSigmaIndex(sigmaIndexEntries, false, pindex->pprev->GetBlockHash(), pindex->GetBlockHash()))
+        return AbortNode(state, "Failed to write sigma index");
+
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
@@ -2884,6 +3000,12 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode, int n
     int64_t cacheSize = pcoinsTip->DynamicMemoryUsage() * DB_PEAK_USAGE_FACTOR;
     cacheSize += evoDb->GetMemoryUsage() * EVO_DB_USAGE_FACTOR * DB_PEAK_USAGE_FACTOR;
     int64_t nTotalSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
+    // Coins that are being written in the background still take up memory. Flush at half the space so that both
+    // fit, the previous write is then normally done by the time the cache fills up again. Pruning flushes are written
+    // in the foreground, block files are unlinked right after the flush and the coins must be on disk by then.
+    bool fBackgroundFlush = fCoinsBackgroundFlush && pcoinsflusher && mode != FLUSH_STATE_ALWAYS && !fFlushForPrune;
+    if (fCoinsBackgroundFlush && pcoinsflusher)
+        nTotalSpace /= 2;
     // The cache is large and we're within 10% and 10 MiB of the limit, but we have time now (not in the middle of a block processing).
     bool fCacheLarge = mode == FLUSH_STATE_PERIODIC && cacheSize > std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE * 1024 * 1024);
     // The cache is over the limit, we have to write now.
@@ -2919,9 +3041,12 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode, int n
                 return AbortNode(state, "Failed to write to block index database");
             }
         }
-        // Finally remove any pruned files
-        if (fFlushForPrune)
+        // Finally remove any pruned files, once a coins write still running in the background is done
+        if (fFlushForPrune) {
+            if (pcoinsflusher && !pcoinsflusher->Sync())
+                return AbortNode(state, "Failed to write to coin database");
             UnlinkPrunedFiles(setFilesToPrune);
+        }
         nLastWrite = nNow;
     }
     // Flush best chain related state. This can only be done if the blocks / block index write was also done.
@@ -2933,12 +3058,47 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode, int n
         // overwrite one. Still, use a conservative safety factor of 2.
         if (!CheckDiskSpace(48 * 2 * 2 * pcoinsTip->GetCacheSize()))
             return state.Error("out of disk space");
+        int64_t nFlushStart = GetTimeMicros();
+        size_t nFlushCoins = pcoinsTip->GetCacheSize();
+        // EvoDB is committed first, but its best block on disk only moves once the coins are written, so that a crash
+        // can't leave the two at different blocks. This needs the previous coins write to be done.
+        if (pcoinsflusher && !pcoinsflusher->Sync())
+            return AbortNode(state, "Failed to write to coin database");
+        if (!evoDb->CommitRootTransaction(false)) {
+            return AbortNode(state, "Failed to commit EvoDB");
+        }
+        // Snapshot the sigma state at the flushed tip so the next startup doesn't have to replay the whole chain.
+        // The file is written with the coins, it may not get ahead of them either. Serializing the state holds up
+        // validation, so it is only done on periodic flushes and at shutdown, not whenever the cache fills up.
+        uint256 hashFlushed = pcoinsTip->GetBestBlock();
+        std::shared_ptr<CDataStream> ssSigmaState;
+        if (chainActive.Tip() && (mode == FLUSH_STATE_ALWAYS || fPeriodicFlush)) {
+            ssSigmaState = std::make_shared<CDataStream>(SER_DISK, CLIENT_VERSION);
+            sigma::SerializeSigmaStateSnapshot(chainActive.Tip(), *ssSigmaState);
+        }
+        CEvoDB *pevodb = evoDb;
+        std::function<void()> afterWrite = [pevodb, hashFlushed, ssSigmaState]() {
+            if (!pevodb->CommitPendingBestBlock(hashFlushed))
+                AbortNode("Failed to commit EvoDB");
+            // Failing to write the snapshot is not fatal: the state is rebuilt from the block index instead.
+            if (ssSigmaState && !sigma::WriteSigmaStateSnapshotFile(*ssSigmaState))
+                LogPrintf("FlushStateToDisk: failed to write sigma state snapshot\n");
+        };
         // Flush the chainstate (which may refer to block index entries).
         if (!pcoinsTip->Flush())
             return AbortNode(state, "Failed to write to coin database");
-        if (!evoDb->CommitRootTransaction()) {
-            return AbortNode(state, "Failed to commit EvoDB");
+        if (pcoinsflusher) {
+            pcoinsflusher->AfterWrite(afterWrite);
+            if (!fBackgroundFlush && !pcoinsflusher->Sync())
+                return AbortNode(state, "Failed to write to coin database");
+        } else {
+            afterWrite();
         }
+        int64_t nFlushMicros = GetTimeMicros() - nFlushStart;
+        if (pcoinsflusher)
+            pcoinsflusher->AddPause(nFlushMicros);
+        LogPrint("coindb", "%s: flushed %u coins%s, validation paused for %.2fms\n", __func__,
+            (unsigned int)nFlushCoins, fBackgroundFlush ? " in the background" : "", nFlushMicros * 0.001);
         nLastFlush = nNow;
     }
     if (fDoFullFlush || ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) && nNow > nLastSetChain + (int64_t)DATABASE_WRITE_INTERVAL * 1000000)) {
@@ -3183,10 +3343,11 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     // Read block from disk.
     int64_t nTime1 = GetTimeMicros();
     if (!pblock) {
-        std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
-        connectTrace.blocksConnected.emplace_back(pindexNew, pblockNew);
-        if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus()))
+        // Blocks reconnected after a reorg are usually still cached from their first connect
+        std::shared_ptr<const CBlock> pblockNew = ReadBlockFromDiskCached(pindexNew, chainparams.GetConsensus(), false);
+        if (!pblockNew)
             return AbortNode(state, "Failed to read block");
+        connectTrace.blocksConnected.emplace_back(pindexNew, pblockNew);
     } else {
         connectTrace.blocksConnected.emplace_back(pindexNew, pblock);
     }
@@ -3214,6 +3375,8 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
         assert(flushed);
         dbTx->Commit();
     }
+    // Peers and clients ask for the new tip right away, keep it deserialized for them
+    blockCache.Insert(pindexNew->GetBlockHash(), connectTrace.blocksConnected.back().second);
     int64_t nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
     LogPrint("bench", "  - Flush: %.2fms [%.2fs]\n", (nTime4 - nTime3) * 0.001, nTimeFlush * 0.000001);
     // Write the chain state to disk, if necessary.
@@ -3600,6 +3763,7 @@ bool ActivateBestChain(CValidationState &state, const CChainParams& chainparams,
                 const CBlock& block = *(pair.second);
                 for (unsigned int i = 0; i < block.vtx.size(); i++)
                     GetMainSignals().SyncTransaction(*block.vtx[i], pair.first, i);
+                GetMainSignals().BlockConnected(pair.second, pair.first);
             }
         }
         // When we reach this point, we switched to a new tip (stored in pindexNewTip).
@@ -3909,18 +4073,52 @@ bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigne
 }
 
 //btzc: code from vertcoin, add
-bool CheckBlockHeader(const CBlockHeader &block, CValidationState &state, const Consensus::Params &consensusParams, bool fCheckPOW) {
+static bool CheckBlockHeader(const CBlockHeader &block, const uint256 &hash, CValidationState &state, const Consensus::Params &consensusParams, bool fCheckPOW) {
     fCheckPOW = !block.IsProofOfStake() && fCheckPOW;
-    if (fCheckPOW && !CheckProofOfWork(block.GetHash(), block.nBits, consensusParams)) {
-            if (fCheckPOW && !CheckProofOfWork(block.GetHash(), block.nBits, consensusParams)) {
-               return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
-        }
-    }
+    if (fCheckPOW && !CheckProofOfWork(hash, block.nBits, consensusParams))
+        return state.DoS(50, false, REJECT_INVALID, "high-hash", false, "proof of work failed");
     if(block.IsProofOfStake() && block.vchBlockSig.empty())
         return state.DoS(100,false,REJECT_INVALID,"empty-blocksig",false,"Empty block signature for PoS block");
     return true;
 }
 
+bool CheckBlockHeader(const CBlockHeader &block, CValidationState &state, const Consensus::Params &consensusParams, bool fCheckPOW) {
+    // X16Rv2 is expensive, don't hash the header unless the proof of work is actually checked
+    fCheckPOW = !block.IsProofOfStake() && fCheckPOW;
+    return CheckBlockHeader(block, fCheckPOW ? block.GetHash() : uint256(), state, consensusParams, fCheckPOW);
+}
+
+void CheckBlockHeaders(const std::vector<CBlockHeader>& headers, const Consensus::Params& consensusParams, std::vector<uint256>& hashesRet, std::vector<CValidationState>& statesRet, int nThreads)
+{
+    hashesRet.assign(headers.size(), uint256());
+    statesRet.assign(headers.size(), CValidationState());
+
+    auto checkRange = [&](size_t nBegin, size_t nEnd) {
+        for (size_t i = nBegin; i < nEnd; ++i) {
+            hashesRet[i] = headers[i].GetHash();
+            CheckBlockHeader(headers[i], hashesRet[i], statesRet[i], consensusParams, true);
+        }
+    };
+
+    nThreads = std::min<int>(nThreads, headers.size());
+    if (nThreads > 1) {
+        ctpl::thread_pool pool(nThreads);
+        RenameThreadPool(pool, "headercheck");
+        std::vector<std::future<void>> futures;
+        size_t const nChunkSize = (headers.size() + nThreads - 1) / nThreads;
+        for (size_t nBegin = 0; nBegin < headers.size(); nBegin += nChunkSize) {
+            size_t const nEnd = std::min(headers.size(), nBegin + nChunkSize);
+            futures.push_back(pool.push([&checkRange, nBegin, nEnd](int) {
+                checkRange(nBegin, nEnd);
+            }));
+        }
+        for (auto &future : futures)
+            future.get();
+    } else {
+        checkRange(0, headers.size());
+    }
+}
+
 bool GetBlockPublicKey(const CBlock& block, std::vector<unsigned char>& vchPubKey)
 {
     if (block.IsProofOfWork())
@@ -4406,11 +4604,15 @@ bool BroadcastPoSBlock(CBlock* pblock, CWallet& wallet, const CChainParams& chai
     return true;
 }
 
-static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fCheckPOW = true)
+/**
+ * If pcheckedHash is set the header already passed CheckBlockHeader (see CheckBlockHeaders) and
+ * pcheckedHash is its hash, so the expensive part of the header checks is skipped here.
+ */
+static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, const uint256* pcheckedHash = NULL)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
-    uint256 hash = block.GetHash();
+    uint256 hash = pcheckedHash ? *pcheckedHash : block.GetHash();
     BlockMap::iterator miSelf = mapBlockIndex.find(hash);
     CBlockIndex *pindex = NULL;
     if (hash != chainparams.GetConsensus().hashGenesisBlock) {
@@ -4425,7 +4627,7 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), !block.IsProofOfStake()))
+        if (!pcheckedHash && !CheckBlockHeader(block, hash, state, chainparams.GetConsensus(), true))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
@@ -4461,11 +4663,23 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex)
 {
+    // Hashing and proof of work don't depend on the chain, do them on all cores before taking cs_main
+    std::vector<uint256> hashes;
+    std::vector<CValidationState> states;
+    int nThreads = std::min<int>(std::min(GetNumCores(), MAX_HEADER_CHECK_THREADS), headers.size() / 16);
+    CheckBlockHeaders(headers, chainparams.GetConsensus(), hashes, states, nThreads);
+
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+        for (size_t i = 0; i < headers.size(); ++i) {
+            // Keep the serial behaviour: a header that is already known is accepted regardless
+            // of its check result, and nothing after the first failing header is processed
+            if (!states[i].IsValid() && !mapBlockIndex.count(hashes[i])) {
+                state = states[i];
+                return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hashes[i].ToString(), FormatStateMessage(state));
+            }
             CBlockIndex *pindex = NULL; // Use a temp pindex instead of ppindex to avoid a const_cast
-            if (!AcceptBlockHeader(header, state, chainparams, &pindex)) {
+            if (!AcceptBlockHeader(headers[i], state, chainparams, &pindex, &hashes[i])) {
                 return false;
             }
             if (ppindex) {
@@ -4828,7 +5042,7 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
 bool static LoadBlockIndexDB(const CChainParams& chainparams)
 {
     LogPrintf("LoadBlockIndexDB\n");
-    if (!pblocktree->LoadBlockIndexGuts(InsertBlockIndex))
+    if (!pblocktree->LoadBlockIndexGuts(InsertBlockIndex, nScriptCheckThreads))
         return false;
 
     boost::this_thread::interruption_point();
@@ -4946,10 +5160,24 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
 
     PruneBlockIndexCandidates();
 
+    // The per-address aggregates are missing (older database) or were left ahead of the chainstate by an unclean
+    // shutdown: recompute them from the address index
+    if (fAddressIndex) {
+        uint256 hashBalanceBest;
+        if (!pblocktree->ReadAddressBalanceBestBlock(hashBalanceBest) || hashBalanceBest != chainActive.Tip()->GetBlockHash()) {
+            LogPrintf("%s: rebuilding address balance index\n", __func__);
+            uiInterface.InitMessage(_("Rebuilding address balances..."));
+            if (!pblocktree->RebuildAddressBalanceIndex(chainActive.Height(), chainActive.Tip()->GetBlockHash()))
+                return error("%s: failed to rebuild address balance index", __func__);
+        }
+    }
+
     // some blocks in index can change as a result of ZerocoinBuildStateFromIndex() call
     set<CBlockIndex *> changes;
     ZerocoinBuildStateFromIndex(&chainActive, changes);
-    sigma::BuildSigmaStateFromIndex(&chainActive);
+    sigma::BuildSigmaStateFromSnapshot(&chainActive);
+    if (!sigma::SyncSigmaIndex(&chainActive))
+        return error("%s: failed to rebuild sigma index", __func__);
     if (!changes.empty()) {
         setDirtyBlockIndex.insert(changes.begin(), changes.end());
         FlushStateToDisk();
@@ -4973,6 +5201,85 @@ CVerifyDB::~CVerifyDB()
     uiInterface.ShowProgress("", 100);
 }
 
+namespace {
+
+/**
+ * Reads blocks (and optionally their undo data) ahead of CVerifyDB on worker threads so that disk I/O,
+ * deserialization and the PoW hash of ReadBlockFromDisk overlap with the checks on the calling thread.
+ * Blocks must be requested with Prefetch() in the same order in which they are later taken with Get().
+ */
+class CVerifyDBPrefetcher
+{
+public:
+    struct Entry {
+        bool fBlockRead{false};
+        bool fUndoRead{true};
+        CBlock block;
+        CBlockUndo undo;
+    };
+
+private:
+    const Consensus::Params& consensusParams;
+    bool fReadUndo;
+    std::unique_ptr<ctpl::thread_pool> workerPool;
+    std::deque<std::pair<const CBlockIndex*, std::future<std::shared_ptr<Entry> > > > pending;
+
+    static std::shared_ptr<Entry> Read(const CBlockIndex* pindex, const Consensus::Params& params, bool fUndo)
+    {
+        auto entry = std::make_shared<Entry>();
+        entry->fBlockRead = ReadBlockFromDisk(entry->block, pindex, params);
+        if (fUndo && pindex->pprev) {
+            CDiskBlockPos pos = pindex->GetUndoPos();
+            if (!pos.IsNull())
+                entry->fUndoRead = UndoReadFromDisk(entry->undo, pos, pindex->pprev->GetBlockHash());
+        }
+        return entry;
+    }
+
+public:
+    CVerifyDBPrefetcher(const Consensus::Params& params, int nThreads, bool fReadUndoIn) :
+        consensusParams(params), fReadUndo(fReadUndoIn)
+    {
+        if (nThreads > 1) {
+            workerPool.reset(new ctpl::thread_pool(nThreads));
+            RenameThreadPool(*workerPool, "index-verifydb");
+        }
+    }
+
+    ~CVerifyDBPrefetcher()
+    {
+        for (auto& p : pending)
+            p.second.wait();
+    }
+
+    //! Maximum number of blocks read ahead
+    size_t MaxPending() const { return workerPool ? (size_t)workerPool->size() * 4 : 0; }
+    size_t Pending() const { return pending.size(); }
+
+    void Prefetch(const CBlockIndex* pindex)
+    {
+        if (!workerPool)
+            return;
+        const Consensus::Params& params = consensusParams;
+        bool fUndo = fReadUndo;
+        pending.emplace_back(pindex, workerPool->push([pindex, &params, fUndo](int threadId) {
+            return Read(pindex, params, fUndo);
+        }));
+    }
+
+    std::shared_ptr<Entry> Get(const CBlockIndex* pindex)
+    {
+        if (!pending.empty() && pending.front().first == pindex) {
+            std::shared_ptr<Entry> entry = pending.front().second.get();
+            pending.pop_front();
+            return entry;
+        }
+        return Read(pindex, consensusParams, fReadUndo);
+    }
+};
+
+}
+
 bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview, int nCheckLevel, int nCheckDepth)
 {
     LOCK(cs_main);
@@ -4989,6 +5296,24 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
         nCheckDepth = chainActive.Height();
     nCheckLevel = std::max(0, std::min(4, nCheckLevel));
     LogPrintf("Verifying last %i blocks at level %i\n", nCheckDepth, nCheckLevel);
+
+    // Collect the blocks to check first so that they can be read ahead while earlier ones are being checked
+    std::vector<CBlockIndex*> vToCheck;
+    for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev; pindex = pindex->pprev)
+    {
+        if (pindex->nHeight < chainActive.Height()-nCheckDepth)
+            break;
+        if (fPruneMode && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            // If pruning, only go back as far as we have data.
+            LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
+            break;
+        }
+        vToCheck.push_back(pindex);
+    }
+
+    CVerifyDBPrefetcher prefetcher(chainparams.GetConsensus(), nScriptCheckThreads, nCheckLevel >= 2);
+    size_t nPrefetched = 0;
+
     CCoinsViewCache coins(coinsview);
     CBlockIndex* pindexState = chainActive.Tip();
     CBlockIndex* pindexFailure = NULL;
@@ -4996,7 +5321,7 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
     CValidationState state;
     int reportDone = 0;
     LogPrintf("[0%%]...");
-    for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev; pindex = pindex->pprev)
+    for (CBlockIndex* pindex : vToCheck)
     {
         boost::this_thread::interruption_point();
         int percentageDone = std::max(1, std::min(99, (int)(((double)(chainActive.Height() - pindex->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100))));
@@ -5006,16 +5331,12 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
             reportDone = percentageDone/10;
         }
         uiInterface.ShowProgress(_("Verifying blocks..."), percentageDone);
-        if (pindex->nHeight < chainActive.Height()-nCheckDepth)
-            break;
-        if (fPruneMode && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
-            // If pruning, only go back as far as we have data.
-            LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
-            break;
-        }
-        CBlock block;
+        while (nPrefetched < vToCheck.size() && prefetcher.Pending() < prefetcher.MaxPending())
+            prefetcher.Prefetch(vToCheck[nPrefetched++]);
+        std::shared_ptr<CVerifyDBPrefetcher::Entry> entry = prefetcher.Get(pindex);
+        CBlock& block = entry->block;
         // check level 0: read from disk
-        if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
+        if (!entry->fBlockRead)
             return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
         LogPrintf("VerifyDB->CheckBlock() nHeight=%s\n", pindex->nHeight);
         // check level 1: verify block validity
@@ -5023,17 +5344,13 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
             return error("%s: *** found bad block at %d, hash=%s (%s)\n", __func__,
                          pindex->nHeight, pindex->GetBlockHash().ToString(), FormatStateMessage(state));
         // check level 2: verify undo validity
-        if (nCheckLevel >= 2 && pindex) {
-            CBlockUndo undo;
-            CDiskBlockPos pos = pindex->GetUndoPos();
-            if (!pos.IsNull()) {
-                if (!UndoReadFromDisk(undo, pos, pindex->pprev->GetBlockHash()))
-                    return error("VerifyDB(): *** found bad undo data at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
-            }
-        }
+        if (nCheckLevel >= 2 && !entry->fUndoRead)
+            return error("VerifyDB(): *** found bad undo data at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
         // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
         if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
-            DisconnectResult res = DisconnectBlock(block, state, pindex, coins);
+            // pass pfClean so that the memory-only disconnect leaves the address index alone
+            bool fClean;
+            DisconnectResult res = DisconnectBlock(block, state, pindex, coins, &fClean);
             if (res == DISCONNECT_FAILED) {
                 return error("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
             }
@@ -5053,15 +5370,23 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
 
     // check level 4: try reconnecting blocks
     if (nCheckLevel >= 4) {
-        CBlockIndex *pindex = pindexState;
-        while (pindex != chainActive.Tip()) {
+        std::vector<CBlockIndex*> vToConnect;
+        for (CBlockIndex *pindex = pindexState; pindex != chainActive.Tip(); ) {
+            pindex = chainActive.Next(pindex);
+            vToConnect.push_back(pindex);
+        }
+
+        CVerifyDBPrefetcher connectPrefetcher(chainparams.GetConsensus(), nScriptCheckThreads, false);
+        nPrefetched = 0;
+        for (CBlockIndex *pindex : vToConnect) {
             boost::this_thread::interruption_point();
             uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, 100 - (int)(((double)(chainActive.Height() - pindex->nHeight)) / (double)nCheckDepth * 50))));
-            pindex = chainActive.Next(pindex);
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
+            while (nPrefetched < vToConnect.size() && connectPrefetcher.Pending() < connectPrefetcher.MaxPending())
+                connectPrefetcher.Prefetch(vToConnect[nPrefetched++]);
+            std::shared_ptr<CVerifyDBPrefetcher::Entry> entry = connectPrefetcher.Get(pindex);
+            if (!entry->fBlockRead)
                 return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-            if (!ConnectBlock(block, state, pindex, coins, chainparams))
+            if (!ConnectBlock(entry->block, state, pindex, coins, chainparams))
                 return error("VerifyDB(): *** found unconnectable block at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
         }
     }
@@ -34,6 +34,7 @@
 
 #include <atomic>
 
+#include <boost/function.hpp>
 #include <boost/unordered_map.hpp>
 #include <boost/filesystem/path.hpp>
 
@@ -41,6 +42,7 @@ class CBlockIndex;
 class CBlockTreeDB;
 class CBloomFilter;
 class CChainParams;
+class CCoinsViewBackgroundFlush;
 class CInv;
 class CConnman;
 class CScriptCheck;
@@ -91,6 +93,8 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of threads hashing a headers message before it is accepted */
+static const int MAX_HEADER_CHECK_THREADS = 8;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -146,6 +150,8 @@ static const bool DEFAULT_TXINDEX = true;
 static const bool DEFAULT_TIMESTAMPINDEX = false;
 static const bool DEFAULT_ADDRESSINDEX = false;
 static const bool DEFAULT_SPENTINDEX = false;
+/** Default for -dbbackgroundflush */
+static const bool DEFAULT_DB_BACKGROUND_FLUSH = true;
 static const bool DEFAULT_TOR_SETUP = false;
 static const bool DEFAULT_ZAP_WALLET = false;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
@@ -205,6 +211,8 @@ extern int64_t nTransactionFee;
 extern int64_t nMinimumInputValue;
 
 extern size_t nCoinCacheUsage;
+/** Write the coins cache on a background thread when it fills up (-dbbackgroundflush) */
+extern bool fCoinsBackgroundFlush;
 /** A fee rate smaller than this is considered zero fee (for relaying, mining and transaction creation) */
 extern CFeeRate minRelayTxFee;
 /** Absolute maximum transaction fee (in satoshis) used by wallet and mempool (rejects high fee in sendrawtransaction) */
@@ -527,16 +535,38 @@ bool GetAddressIndex(uint160 addressHash, AddressType type,
                      int start = 0, int end = 0);
 bool GetAddressUnspent(uint160 addressHash, AddressType type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+/** Streaming variants: entries are passed to the visitor in index order, starting after pAfter, until it returns false */
+bool GetAddressIndex(uint160 addressHash, AddressType type, const CAddressIndexKey *pAfter, int start, int end,
+                     boost::function<bool(const CAddressIndexKey&, CAmount)> visitor);
+bool GetAddressUnspent(uint160 addressHash, AddressType type, const CAddressUnspentKey *pAfter,
+                       boost::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)> visitor);
+bool GetAddressBalance(uint160 addressHash, AddressType type, CAddressBalanceValue &value);
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, int nHeight, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+/**
+ * Read the block of pindex as it is serialized on disk, without deserializing it. The magic and
+ * length of the record and the header bytes are checked against pindex.
+ */
+bool ReadRawBlockFromDisk(std::vector<unsigned char>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& messageStart);
+/**
+ * Return the block of pindex from the shared block cache, reading it from disk on a miss.
+ * Returns nullptr if the block can't be read. fStore=false doesn't add missed blocks to the
+ * cache, for bulk scans that would just evict the recent blocks.
+ */
+std::shared_ptr<const CBlock> ReadBlockFromDiskCached(const CBlockIndex* pindex, const Consensus::Params& consensusParams, bool fStore = true);
 
 /** Functions for validating blocks and updating the block tree */
 
 /** Context-independent validity checks */
 bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true);
+/**
+ * Run CheckBlockHeader on a batch of headers using up to nThreads worker threads. Does not need cs_main.
+ * hashesRet and statesRet are filled in header order; a header passed if its state is valid.
+ */
+void CheckBlockHeaders(const std::vector<CBlockHeader>& headers, const Consensus::Params& consensusParams, std::vector<uint256>& hashesRet, std::vector<CValidationState>& statesRet, int nThreads);
 bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, bool fCheckMerkleRoot = true, int nHeight = INT_MAX, bool isVerifyDB = false);
 
 bool IsTransactionInChain(const uint256& txId, int& nHeightTx, CTransactionRef tx);
@@ -610,6 +640,9 @@ extern CChain chainActive;
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern CCoinsViewCache *pcoinsTip;
 
+/** Global variable that points to the writer between pcoinsTip and the coins database (protected by cs_main) */
+extern CCoinsViewBackgroundFlush *pcoinsflusher;
+
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
@@ -45,8 +45,13 @@
 #include "rpc/protocol.h"
 
 #include "hdmint/tracker.h"
+#include "ctpl.h"
+#include "saltedhasher.h"
 
 #include <assert.h>
+#include <deque>
+#include <future>
+#include <unordered_set>
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
@@ -769,6 +774,42 @@ void CWallet::AddToSpends(const uint256& wtxid)
     }
 }
 
+void CWallet::UpdateWalletUTXO(const uint256& hash)
+{
+    AssertLockHeld(cs_wallet);
+
+    auto it = mapWallet.find(hash);
+    if (it == mapWallet.end())
+        return;
+
+    const CWalletTx& wtx = it->second;
+    for (unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
+        if (IsMine(wtx.tx->vout[i]) && !IsSpent(hash, i)) {
+            setWalletUTXO.insert(COutPoint(hash, i));
+        } else {
+            setWalletUTXO.erase(COutPoint(hash, i));
+        }
+    }
+}
+
+std::vector<const CWalletTx*> CWallet::GetWalletUTXOTxs() const
+{
+    AssertLockHeld(cs_wallet);
+
+    // setWalletUTXO is ordered by txid, so this keeps the order of mapWallet
+    std::vector<const CWalletTx*> vTxs;
+    const uint256* pLastHash = nullptr;
+    for (const COutPoint& outpoint : setWalletUTXO) {
+        if (pLastHash && *pLastHash == outpoint.hash)
+            continue;
+        pLastHash = &outpoint.hash;
+        auto it = mapWallet.find(outpoint.hash);
+        if (it != mapWallet.end())
+            vTxs.push_back(&it->second);
+    }
+    return vTxs;
+}
+
 uint64_t CWallet::GetStakeWeight() const
 {
     // Choose coins to use
@@ -804,10 +845,9 @@ void CWallet::AvailableCoinsForStaking(std::vector<COutput>& vCoins) const
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const CWalletTx* pcoin : GetWalletUTXOTxs())
         {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
+            const uint256& wtxid = pcoin->GetHash();
             int nDepth = pcoin->GetDepthInMainChain();
 
             if (nDepth < 1)
@@ -822,7 +862,7 @@ void CWallet::AvailableCoinsForStaking(std::vector<COutput>& vCoins) const
             for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
                 isminetype mine = IsMine(pcoin->tx->vout[i]);
                 if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-                    !IsLockedCoin((*it).first, i) && (pcoin->tx->vout[i].nValue > 0))
+                    !IsLockedCoin(wtxid, i) && (pcoin->tx->vout[i].nValue > 0))
                     vCoins.push_back(COutput(pcoin, i, nDepth,
                                              ((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
                                              (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO,
@@ -1497,6 +1537,8 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
             wtx.fFromMe = wtxIn.fFromMe;
             fUpdated = true;
         }
+        // keys might have been imported since the transaction was first seen
+        UpdateWalletUTXO(hash);
     }
 
     //// debug print
@@ -1644,8 +1686,10 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
             // available of the outputs it spends. So force those to be recomputed
             BOOST_FOREACH(const CTxIn& txin, wtx.tx->vin)
             {
-                if (mapWallet.count(txin.prevout.hash))
+                if (mapWallet.count(txin.prevout.hash)) {
                     mapWallet[txin.prevout.hash].MarkDirty();
+                    UpdateWalletUTXO(txin.prevout.hash);
+                }
             }
         }
 
@@ -1768,8 +1812,10 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
             // available of the outputs it spends. So force those to be recomputed
             BOOST_FOREACH(const CTxIn& txin, wtx.tx->vin)
             {
-                if (mapWallet.count(txin.prevout.hash))
+                if (mapWallet.count(txin.prevout.hash)) {
                     mapWallet[txin.prevout.hash].MarkDirty();
+                    UpdateWalletUTXO(txin.prevout.hash);
+                }
             }
         }
     }
@@ -1787,8 +1833,10 @@ void CWallet::SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex,
     // recomputed, also:
     BOOST_FOREACH(const CTxIn& txin, tx.vin)
     {
-        if (mapWallet.count(txin.prevout.hash))
+        if (mapWallet.count(txin.prevout.hash)) {
             mapWallet[txin.prevout.hash].MarkDirty();
+            UpdateWalletUTXO(txin.prevout.hash);
+        }
     }
 }
 
@@ -2367,6 +2415,195 @@ void CWalletTx::GetAccountAmounts(const string& strAccount, CAmount& nReceived,
  * successfully scanned.
  *
  */
+/**
+ * Everything that can make a transaction IsMine() or IsFromMe() without it touching a wallet
+ * transaction: key and script ids, watch-only scripts, HD mint pubcoin hashes and sigma spend serials.
+ * Matching only needs the transaction itself so rescan workers can drop unrelated transactions
+ * before the wallet is locked. Matches are a superset of IsMine(), each of them is still checked by
+ * AddToWalletIfInvolvingMe.
+ */
+class CWalletScanFilter
+{
+public:
+    uint64_t nFingerprint{0};
+    std::unordered_set<uint160, StaticSaltedHasher> setIds;
+    std::set<CScript> setWatchOnly;
+    std::unordered_set<uint256, StaticSaltedHasher> setMintHashes;
+    std::unordered_set<uint256, StaticSaltedHasher> setSpendSerialHashes;
+    // wallets without a database can't look up sigma coins, let AddToWalletIfInvolvingMe decide
+    bool fMatchAllSigma{false};
+
+    bool IsRelevant(const CTransaction& tx) const
+    {
+        for (const CTxIn& txin : tx.vin) {
+            if (txin.IsZerocoinRemint()) {
+                return true;
+            }
+            if (txin.IsSigmaSpend()) {
+                if (fMatchAllSigma) {
+                    return true;
+                }
+                try {
+                    std::unique_ptr<sigma::CoinSpend> spend;
+                    std::tie(spend, std::ignore) = sigma::ParseSigmaSpend(txin);
+                    if (setSpendSerialHashes.count(primitives::GetSerialHash(spend->getCoinSerialNumber()))) {
+                        return true;
+                    }
+                } catch (...) {
+                    // malformed spends are left to the full check
+                    return true;
+                }
+            }
+        }
+        for (const CTxOut& txout : tx.vout) {
+            if (MatchOutput(txout)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    bool MatchOutput(const CTxOut& txout) const
+    {
+        const CScript& script = txout.scriptPubKey;
+        if (setWatchOnly.count(script)) {
+            return true;
+        }
+
+        if (script.IsSigmaMint()) {
+            if (fMatchAllSigma) {
+                return true;
+            }
+            try {
+                return setMintHashes.count(primitives::GetPubCoinValueHash(sigma::ParseSigmaMintScript(script))) != 0;
+            } catch (std::invalid_argument&) {
+                return false;
+            }
+        }
+
+        // same solutions ::IsMine() looks up in the keystore
+        std::vector<std::vector<unsigned char> > vSolutions;
+        txnouttype whichType;
+        if (!Solver(script, whichType, vSolutions)) {
+            return false;
+        }
+        switch (whichType) {
+        case TX_PUBKEY:
+        case TX_ZEROCOINMINT:
+        case TX_ZEROCOINMINTV3:
+            return setIds.count(CPubKey(vSolutions[0]).GetID()) != 0;
+        case TX_PUBKEYHASH:
+        case TX_SCRIPTHASH:
+            return setIds.count(uint160(vSolutions[0])) != 0;
+        case TX_WITNESS_V0_KEYHASH:
+        case TX_WITNESS_V0_SCRIPTHASH:
+            return setIds.count(CScriptID(CScript() << OP_0 << vSolutions[0])) != 0;
+        case TX_MULTISIG:
+            for (size_t i = 1; i + 1 < vSolutions.size(); i++) {
+                if (setIds.count(CPubKey(vSolutions[i]).GetID())) {
+                    return true;
+                }
+            }
+            return false;
+        default:
+            return false;
+        }
+    }
+};
+
+uint64_t CWallet::GetScanFilterFingerprint() const
+{
+    AssertLockHeld(cs_wallet);
+
+    CSipHasher hasher(0, 0);
+    {
+        LOCK(cs_KeyStore);
+        hasher.Write(mapKeyMetadata.size()).Write(mapScripts.size()).Write(setWatchOnly.size());
+    }
+    hasher.Write(zwallet ? (uint64_t)zwallet->GetCount() : 0);
+    return hasher.Finalize();
+}
+
+std::shared_ptr<const CWalletScanFilter> CWallet::CreateScanFilter() const
+{
+    AssertLockHeld(cs_wallet);
+
+    auto filter = std::make_shared<CWalletScanFilter>();
+    filter->nFingerprint = GetScanFilterFingerprint();
+    {
+        LOCK(cs_KeyStore);
+        std::set<CKeyID> setKeys;
+        GetKeys(setKeys);
+        for (const CKeyID& keyID : setKeys) {
+            filter->setIds.insert(keyID);
+        }
+        for (const auto& script : mapScripts) {
+            filter->setIds.insert(script.first);
+        }
+        filter->setWatchOnly = setWatchOnly;
+    }
+
+    if (fFileBacked) {
+        CWalletDB walletdb(strWalletFile);
+        for (const CHDMint& mint : walletdb.ListHDMints()) {
+            filter->setMintHashes.insert(mint.GetPubCoinHash());
+        }
+        std::list<CSigmaSpendEntry> listSpends;
+        walletdb.ListCoinSpendSerial(listSpends);
+        for (const CSigmaSpendEntry& spend : listSpends) {
+            filter->setSpendSerialHashes.insert(primitives::GetSerialHash(spend.coinSerial));
+        }
+    } else {
+        filter->fMatchAllSigma = true;
+    }
+    return filter;
+}
+
+bool CWallet::IsSpendingWalletTx(const CTransaction& tx) const
+{
+    AssertLockHeld(cs_wallet);
+
+    if (mapWallet.count(tx.GetHash())) {
+        return true;
+    }
+    for (const CTxIn& txin : tx.vin) {
+        if (mapWallet.count(txin.prevout.hash) || mapTxSpends.count(txin.prevout)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+namespace {
+
+struct CRescanBlock
+{
+    CBlockIndex* pindex;
+    bool fRead{false};
+    std::shared_ptr<const CBlock> block;
+    std::shared_ptr<const CWalletScanFilter> filter;
+    std::vector<bool> vRelevant;
+};
+
+std::shared_ptr<CRescanBlock> ReadRescanBlock(CBlockIndex* pindex, const std::shared_ptr<const CWalletScanFilter>& filter, const Consensus::Params& consensusParams)
+{
+    auto result = std::make_shared<CRescanBlock>();
+    result->pindex = pindex;
+    result->filter = filter;
+    result->block = ReadBlockFromDiskCached(pindex, consensusParams, false);
+    result->fRead = result->block != nullptr;
+    if (result->fRead) {
+        result->vRelevant.reserve(result->block->vtx.size());
+        for (const auto& tx : result->block->vtx) {
+            result->vRelevant.push_back(filter->IsRelevant(*tx));
+        }
+    }
+    return result;
+}
+
+} // anonymous namespace
+
 CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex *pindexStart, bool fUpdate, bool fRecoverMnemonic)
 {
     CBlockIndex* ret = nullptr;
@@ -2374,6 +2611,9 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex *pindexStart, bool f
     const CChainParams& chainParams = Params();
 
     CBlockIndex* pindex = pindexStart;
+    double dProgressStart;
+    double dProgressTip;
+    std::shared_ptr<const CWalletScanFilter> filter;
     {
         LOCK2(cs_main, cs_wallet);
 
@@ -2389,32 +2629,82 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex *pindexStart, bool f
                 pindex = chainActive.Next(pindex);
 
         ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
-        double dProgressStart = GuessVerificationProgress(chainParams.TxData(), pindex);
-        double dProgressTip = GuessVerificationProgress(chainParams.TxData(), chainActive.Tip());
-        while (pindex)
+        dProgressStart = GuessVerificationProgress(chainParams.TxData(), pindex);
+        dProgressTip = GuessVerificationProgress(chainParams.TxData(), chainActive.Tip());
+        filter = CreateScanFilter();
+    }
+
+    // Blocks are read, deserialized and matched against the filter ahead of time by the workers,
+    // cs_main and cs_wallet are only taken to add the matching transactions of one block at a time
+    int nThreads = std::max(1, std::min(GetNumCores(), 8));
+    size_t nMaxReadAhead = nThreads * 4;
+    ctpl::thread_pool pool(nThreads);
+    RenameThreadPool(pool, "rescan");
+    std::deque<std::future<std::shared_ptr<CRescanBlock> > > readQueue;
+    CBlockIndex* pindexNextRead = pindex;
+
+    while (true) {
         {
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((GuessVerificationProgress(chainParams.TxData(), pindex) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
-            if (GetTime() >= nNow + 60) {
-                nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
+            LOCK(cs_main);
+            while (pindexNextRead && readQueue.size() < nMaxReadAhead) {
+                CBlockIndex* pindexRead = pindexNextRead;
+                readQueue.emplace_back(pool.push([pindexRead, filter, &chainParams](int) {
+                    return ReadRescanBlock(pindexRead, filter, chainParams.GetConsensus());
+                }));
+                pindexNextRead = chainActive.Next(pindexRead);
             }
+        }
+        if (readQueue.empty()) {
+            break;
+        }
 
-            CBlock block;
-            if (ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
-                for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                    AddToWalletIfInvolvingMe(*block.vtx[posInBlock], pindex, posInBlock, fUpdate);
-                }
-                if (!ret) {
-                    ret = pindex;
+        std::shared_ptr<CRescanBlock> result = readQueue.front().get();
+        readQueue.pop_front();
+        pindex = result->pindex;
+
+        if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
+            ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((GuessVerificationProgress(chainParams.TxData(), pindex) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+        if (GetTime() >= nNow + 60) {
+            nNow = GetTime();
+            LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
+        }
+
+        LOCK2(cs_main, cs_wallet);
+
+        if (!chainActive.Contains(pindex)) {
+            // the chain was reorganized while reading ahead, continue from the fork point
+            for (auto& f : readQueue) {
+                f.wait();
+            }
+            readQueue.clear();
+            const CBlockIndex* pindexFork = chainActive.FindFork(pindex);
+            pindexNextRead = pindexFork ? chainActive.Next(pindexFork) : chainActive.Genesis();
+            continue;
+        }
+
+        // keys or mints were added meanwhile, blocks filtered with the old snapshot are matched again
+        if (filter->nFingerprint != GetScanFilterFingerprint()) {
+            filter = CreateScanFilter();
+        }
+
+        if (result->fRead) {
+            const CBlock& block = *result->block;
+            bool fStaleFilter = result->filter != filter;
+            for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
+                const CTransaction& tx = *block.vtx[posInBlock];
+                bool fRelevant = fStaleFilter ? filter->IsRelevant(tx) : result->vRelevant[posInBlock];
+                if (fRelevant || IsSpendingWalletTx(tx)) {
+                    AddToWalletIfInvolvingMe(tx, pindex, posInBlock, fUpdate);
                 }
-            } else {
-                ret = nullptr;
             }
-            pindex = chainActive.Next(pindex);
+            if (!ret) {
+                ret = pindex;
+            }
+        } else {
+            ret = nullptr;
         }
-        ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
     }
+    ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
     return ret;
 }
 
@@ -2841,9 +3131,9 @@ CAmount CWallet::GetBalance(bool fExcludeLocked) const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        // transactions without unspent outputs of ours have no available credit
+        for (const CWalletTx* pcoin : GetWalletUTXOTxs())
         {
-            const CWalletTx* pcoin = &(*it).second;
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableCredit(true, fExcludeLocked);
         }
@@ -3271,10 +3561,21 @@ void CWallet::AvailableCoins(vector <COutput> &vCoins, bool fOnlyConfirmed, cons
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+
+        // Outputs of ours only become IsMine() when mints are added to the wallet, so mints can't rely
+        // on setWalletUTXO. Everything else is always tracked there.
+        std::vector<const CWalletTx*> vTxs;
+        if (nCoinType == ALL_COINS || nCoinType == ONLY_1000) {
+            vTxs = GetWalletUTXOTxs();
+        } else {
+            vTxs.reserve(mapWallet.size());
+            for (const auto& item : mapWallet)
+                vTxs.push_back(&item.second);
+        }
+
+        for (const CWalletTx* pcoin : vTxs)
         {
-            const uint256& wtxid = it->first;
-            const CWalletTx* pcoin = &(*it).second;
+            const uint256& wtxid = pcoin->GetHash();
 
             if (!CheckFinalTx(*pcoin))
                 continue;
@@ -3344,9 +3645,9 @@ void CWallet::AvailableCoins(vector <COutput> &vCoins, bool fOnlyConfirmed, cons
 
 
                 if (!(IsSpent(wtxid, i)) && mine != ISMINE_NO &&
-                    (!IsLockedCoin((*it).first, i) || nCoinType == ONLY_1000) &&
+                    (!IsLockedCoin(wtxid, i) || nCoinType == ONLY_1000) &&
                     (pcoin->tx->vout[i].nValue > 0 || fIncludeZeroValue) &&
-                    (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint((*it).first, i)))) {
+                    (!coinControl || !coinControl->HasSelected() || coinControl->fAllowOtherInputs || coinControl->IsSelected(COutPoint(wtxid, i)))) {
                         vCoins.push_back(COutput(pcoin, i, nDepth,
                                                  ((mine & ISMINE_SPENDABLE) != ISMINE_NO) ||
                                                   (coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO),
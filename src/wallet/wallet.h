@@ -36,6 +36,7 @@
 #include <algorithm>
 #include <atomic>
 #include <map>
+#include <memory>
 #include <set>
 #include <stdexcept>
 #include <stdint.h>
@@ -652,6 +653,8 @@ private:
  * A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
  * and provides the ability to create new transactions.
  */
+class CWalletScanFilter;
+
 class CWallet : public CCryptoKeyStore, public CValidationInterface
 {
 private:
@@ -692,7 +695,18 @@ private:
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
 
+    /* Unspent outputs of ours, kept up to date when transactions are added, abandoned or conflicted */
     std::set<COutPoint> setWalletUTXO;
+    void UpdateWalletUTXO(const uint256& hash);
+    /* Wallet transactions with at least one output in setWalletUTXO, ordered by txid like mapWallet */
+    std::vector<const CWalletTx*> GetWalletUTXOTxs() const;
+
+    /* Snapshot of the keys, scripts and sigma coins used to pre-filter transactions during a rescan */
+    std::shared_ptr<const CWalletScanFilter> CreateScanFilter() const;
+    /* Changes whenever a filter created by CreateScanFilter() could be outdated */
+    uint64_t GetScanFilterFingerprint() const;
+    /* Whether tx spends or conflicts with a wallet transaction, which no scan filter can know about */
+    bool IsSpendingWalletTx(const CTransaction& tx) const;
 
     /* Mark a transaction (and its in-wallet descendants) as conflicting with a particular block. */
     void MarkConflicted(const uint256& hashBlock, const uint256& hashTx);
@@ -7,11 +7,22 @@
 
 #include "zmqconfig.h"
 
+#include <memory>
+#include <vector>
+
 class CBlockIndex;
 class CZMQAbstractNotifier;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
+/** A transaction notification as queued for the publisher thread */
+struct CZMQTransactionNotification
+{
+    uint256 hash;
+    //! Network serialization, only filled in when a notifier publishes raw transactions
+    std::shared_ptr<const std::vector<unsigned char> > pvchRaw;
+};
+
 class CZMQAbstractNotifier
 {
 public:
@@ -32,8 +43,17 @@ public:
     virtual bool Initialize(void *pcontext) = 0;
     virtual void Shutdown() = 0;
 
-    virtual bool NotifyBlock(const CBlockIndex *pindex);
-    virtual bool NotifyTransaction(const CTransaction &transaction);
+    /** Whether NotifyTransaction needs CZMQTransactionNotification::pvchRaw */
+    virtual bool NeedsRawTransaction() const { return false; }
+
+    // Called on the publisher thread. pblock is null if the connected block wasn't
+    // handed over by validation and has to be read from disk.
+    virtual bool NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock> &pblock);
+    virtual bool NotifyTransaction(const CZMQTransactionNotification &transaction);
+
+    // Called on the publisher thread for notifications dropped because the queue was full
+    virtual void BlocksDropped(unsigned int nCount) {}
+    virtual void TransactionsDropped(unsigned int nCount) {}
 
 protected:
     void *psocket;
@@ -7,6 +7,7 @@
 
 #include "version.h"
 #include "validation.h"
+#include "rpc/server.h"
 #include "streams.h"
 #include "util.h"
 
@@ -15,7 +16,9 @@ void zmqError(const char *str)
     LogPrint("zmq", "zmq: Error: %s, errno=%s\n", str, zmq_strerror(errno));
 }
 
-CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(NULL)
+CZMQNotificationInterface::CZMQNotificationInterface() :
+    pcontext(NULL), fRawTransactions(false), nMaxQueue(DEFAULT_ZMQ_QUEUE_SIZE), nBlocksDropped(0), nTransactionsDropped(0),
+    fStopPublisher(false), pindexConnected(NULL)
 {
 }
 
@@ -107,6 +110,11 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    for (CZMQAbstractNotifier *notifier : notifiers)
+        fRawTransactions |= notifier->NeedsRawTransaction();
+    nMaxQueue = std::max((int64_t)1, GetArg("-zmqqueuesize", DEFAULT_ZMQ_QUEUE_SIZE));
+    threadPublish = std::thread(&TraceThread<std::function<void()> >, "zmqpub", std::function<void()>(std::bind(&CZMQNotificationInterface::ThreadPublish, this)));
+
     return true;
 }
 
@@ -114,6 +122,18 @@ bool CZMQNotificationInterface::Initialize()
 void CZMQNotificationInterface::Shutdown()
 {
     LogPrint("zmq", "zmq: Shutdown notification interface\n");
+    if (threadPublish.joinable())
+    {
+        // Publish what is still queued, then stop
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            fStopPublisher = true;
+        }
+        cond.notify_one();
+        threadPublish.join();
+        if (nBlocksDropped || nTransactionsDropped)
+            LogPrintf("zmq: %u block and %u transaction notifications were dropped because the publisher queue was full\n", nBlocksDropped, nTransactionsDropped);
+    }
     if (pcontext)
     {
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
@@ -128,39 +148,114 @@ void CZMQNotificationInterface::Shutdown()
     }
 }
 
-void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+void CZMQNotificationInterface::Enqueue(Notification&& notification)
 {
-    if (fInitialDownload || pindexNew == pindexFork) // In IBD or blocks were disconnected without any new ones
+    std::lock_guard<std::mutex> lock(cs);
+    if (fStopPublisher)
         return;
+    if (queue.size() >= nMaxQueue)
+    {
+        if (notification.ptx)
+            nTransactionsDropped++;
+        else
+            nBlocksDropped++;
+        return;
+    }
+    notification.nBlocksDroppedBefore = nBlocksDropped;
+    notification.nTransactionsDroppedBefore = nTransactionsDropped;
+    queue.push_back(std::move(notification));
+    cond.notify_one();
+}
+
+// Sends everything queued, serializing blocks here instead of on the validation thread
+void CZMQNotificationInterface::ThreadPublish()
+{
+    uint64_t nBlocksDroppedSeen = 0;
+    uint64_t nTransactionsDroppedSeen = 0;
 
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
+    std::unique_lock<std::mutex> lock(cs);
+    while (true)
     {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(pindexNew))
+        cond.wait(lock, [this] { return fStopPublisher || !queue.empty(); });
+        if (queue.empty())
+            break;
+        Notification notification = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+
+        unsigned int nNewBlocksDropped = notification.nBlocksDroppedBefore - nBlocksDroppedSeen;
+        unsigned int nNewTransactionsDropped = notification.nTransactionsDroppedBefore - nTransactionsDroppedSeen;
+        if (nNewBlocksDropped || nNewTransactionsDropped)
         {
-            i++;
+            LogPrint("zmq", "zmq: Publisher queue full, dropped %u block and %u transaction notifications\n", nNewBlocksDropped, nNewTransactionsDropped);
+            for (CZMQAbstractNotifier *notifier : notifiers)
+            {
+                if (nNewBlocksDropped)
+                    notifier->BlocksDropped(nNewBlocksDropped);
+                if (nNewTransactionsDropped)
+                    notifier->TransactionsDropped(nNewTransactionsDropped);
+            }
+            nBlocksDroppedSeen = notification.nBlocksDroppedBefore;
+            nTransactionsDroppedSeen = notification.nTransactionsDroppedBefore;
         }
-        else
+
+        for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
         {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
+            CZMQAbstractNotifier *notifier = *i;
+            bool fSent = notification.ptx ? notifier->NotifyTransaction(*notification.ptx) : notifier->NotifyBlock(notification.pindex, notification.pblock);
+            if (fSent)
+            {
+                i++;
+            }
+            else
+            {
+                notifier->Shutdown();
+                i = notifiers.erase(i);
+            }
         }
+
+        lock.lock();
     }
 }
 
+void CZMQNotificationInterface::BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex *pindex)
+{
+    std::lock_guard<std::mutex> lock(cs);
+    pblockConnected = block;
+    pindexConnected = pindex;
+}
+
+void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+{
+    if (fInitialDownload || pindexNew == pindexFork) // In IBD or blocks were disconnected without any new ones
+        return;
+
+    Notification notification = Notification();
+    notification.pindex = pindexNew;
+    {
+        // Hand the block validation already has in memory to the publisher, rather than reading it back from disk
+        std::lock_guard<std::mutex> lock(cs);
+        if (pindexConnected == pindexNew)
+            notification.pblock = pblockConnected;
+        pblockConnected.reset();
+        pindexConnected = NULL;
+    }
+    Enqueue(std::move(notification));
+}
+
 void CZMQNotificationInterface::SyncTransaction(const CTransaction& tx, const CBlockIndex* pindex, int posInBlock)
 {
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
+    std::shared_ptr<CZMQTransactionNotification> ptx = std::make_shared<CZMQTransactionNotification>();
+    ptx->hash = tx.GetHash();
+    if (fRawTransactions)
     {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransaction(tx))
-        {
-            i++;
-        }
-        else
-        {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
-        }
+        // Serialized here since tx doesn't outlive this call, and then handed to zmq without further copies
+        std::shared_ptr<std::vector<unsigned char> > pvchRaw = std::make_shared<std::vector<unsigned char> >();
+        CVectorWriter(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags(), *pvchRaw, 0, tx);
+        ptx->pvchRaw = pvchRaw;
     }
+
+    Notification notification = Notification();
+    notification.ptx = ptx;
+    Enqueue(std::move(notification));
 }
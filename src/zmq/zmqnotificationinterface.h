@@ -6,11 +6,22 @@
 #define BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
 #include "validationinterface.h"
-#include <string>
+#include <condition_variable>
+#include <deque>
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 
+class CBlock;
 class CBlockIndex;
 class CZMQAbstractNotifier;
+struct CZMQTransactionNotification;
+
+/** Default for -zmqqueuesize, notifications waiting for the publisher thread before new ones are dropped */
+static const unsigned int DEFAULT_ZMQ_QUEUE_SIZE = 10000;
 
 class CZMQNotificationInterface : public CValidationInterface
 {
@@ -25,13 +36,43 @@ protected:
 
     // CValidationInterface
     void SyncTransaction(const CTransaction& tx, const CBlockIndex *pindex, int posInBlock);
+    void BlockConnected(const std::shared_ptr<const CBlock>& block, const CBlockIndex *pindex);
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload);
 
 private:
     CZMQNotificationInterface();
 
+    /** A block or transaction waiting for the publisher thread */
+    struct Notification
+    {
+        const CBlockIndex *pindex;
+        std::shared_ptr<const CBlock> pblock;
+        std::shared_ptr<const CZMQTransactionNotification> ptx;
+        //! Drop counters when this was queued, to put the sequence gaps where messages are missing
+        uint64_t nBlocksDroppedBefore;
+        uint64_t nTransactionsDroppedBefore;
+    };
+
+    void Enqueue(Notification&& notification);
+    void ThreadPublish();
+
     void *pcontext;
+    //! Only used by the publisher thread while it runs
     std::list<CZMQAbstractNotifier*> notifiers;
+    //! Whether any notifier needs transactions serialized
+    bool fRawTransactions;
+
+    std::mutex cs;
+    std::condition_variable cond;
+    std::deque<Notification> queue;
+    size_t nMaxQueue;
+    uint64_t nBlocksDropped;
+    uint64_t nTransactionsDropped;
+    bool fStopPublisher;
+    std::thread threadPublish;
+    //! The last block passed to BlockConnected, published if it becomes the tip
+    std::shared_ptr<const CBlock> pblockConnected;
+    const CBlockIndex *pindexConnected;
 };
 
 #endif // BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
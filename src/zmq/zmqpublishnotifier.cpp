@@ -56,6 +56,64 @@ static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
     return 0;
 }
 
+typedef std::shared_ptr<const std::vector<unsigned char> > SharedBuffer;
+
+// Releases the reference zmq held on a buffer sent with zmq_msg_init_data, called from a zmq I/O thread
+static void zmq_free_shared_buffer(void * /*data*/, void *hint)
+{
+    delete static_cast<SharedBuffer*>(hint);
+}
+
+// Same as zmq_send_multipart for command, data and sequence number, but without copying the data
+static int zmq_send_shared(void *sock, const char *command, const SharedBuffer &pdata, const void *msgseq, size_t seqsize)
+{
+    zmq_msg_t msg;
+
+    if (zmq_msg_init_size(&msg, strlen(command)) != 0)
+    {
+        zmqError("Unable to initialize ZMQ msg");
+        return -1;
+    }
+    memcpy(zmq_msg_data(&msg), command, strlen(command));
+    if (zmq_msg_send(&msg, sock, ZMQ_SNDMORE) == -1)
+    {
+        zmqError("Unable to send ZMQ msg");
+        zmq_msg_close(&msg);
+        return -1;
+    }
+    zmq_msg_close(&msg);
+
+    SharedBuffer *hint = new SharedBuffer(pdata);
+    if (zmq_msg_init_data(&msg, const_cast<unsigned char*>(pdata->data()), pdata->size(), zmq_free_shared_buffer, hint) != 0)
+    {
+        zmqError("Unable to initialize ZMQ msg");
+        delete hint;
+        return -1;
+    }
+    if (zmq_msg_send(&msg, sock, ZMQ_SNDMORE) == -1)
+    {
+        zmqError("Unable to send ZMQ msg");
+        zmq_msg_close(&msg);
+        return -1;
+    }
+    zmq_msg_close(&msg);
+
+    if (zmq_msg_init_size(&msg, seqsize) != 0)
+    {
+        zmqError("Unable to initialize ZMQ msg");
+        return -1;
+    }
+    memcpy(zmq_msg_data(&msg), msgseq, seqsize);
+    if (zmq_msg_send(&msg, sock, 0) == -1)
+    {
+        zmqError("Unable to send ZMQ msg");
+        zmq_msg_close(&msg);
+        return -1;
+    }
+    zmq_msg_close(&msg);
+    return 0;
+}
+
 bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
 {
     assert(!psocket);
@@ -142,7 +200,21 @@ bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* d
     return true;
 }
 
-bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const SharedBuffer &pdata)
+{
+    assert(psocket);
+
+    unsigned char msgseq[sizeof(uint32_t)];
+    WriteLE32(&msgseq[0], nSequence);
+    if (zmq_send_shared(psocket, command, pdata, msgseq, sizeof(uint32_t)) == -1)
+        return false;
+
+    nSequence++;
+
+    return true;
+}
+
+bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock> &/*pblock*/)
 {
     uint256 hash = pindex->GetBlockHash();
     LogPrint("zmq", "zmq: Publish hashblock %s\n", hash.GetHex());
@@ -152,9 +224,9 @@ bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
     return SendMessage(MSG_HASHBLOCK, data, 32);
 }
 
-bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
+bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CZMQTransactionNotification &transaction)
 {
-    uint256 hash = transaction.GetHash();
+    uint256 hash = transaction.hash;
     LogPrint("zmq", "zmq: Publish hashtx %s\n", hash.GetHex());
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
@@ -162,32 +234,37 @@ bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &t
     return SendMessage(MSG_HASHTX, data, 32);
 }
 
-bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock> &pblock)
 {
     LogPrint("zmq", "zmq: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
-    const Consensus::Params& consensusParams = Params().GetConsensus();
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
+    std::shared_ptr<std::vector<unsigned char> > pdata = std::make_shared<std::vector<unsigned char> >();
+    CVectorWriter writer(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags(), *pdata, 0);
+    if (pblock)
     {
-        LOCK(cs_main);
+        writer << *pblock;
+    }
+    else
+    {
+        const Consensus::Params& consensusParams = Params().GetConsensus();
         CBlock block;
-        if(!ReadBlockFromDisk(block, pindex, consensusParams))
         {
-            zmqError("Can't read block from disk");
-            return false;
+            LOCK(cs_main);
+            if(!ReadBlockFromDisk(block, pindex, consensusParams))
+            {
+                zmqError("Can't read block from disk");
+                return false;
+            }
         }
-
-        ss << block;
+        writer << block;
     }
 
-    return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+    return SendMessage(MSG_RAWBLOCK, pdata);
 }
 
-bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
+bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CZMQTransactionNotification &transaction)
 {
-    uint256 hash = transaction.GetHash();
-    LogPrint("zmq", "zmq: Publish rawtx %s\n", hash.GetHex());
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-    ss << transaction;
-    return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
+    LogPrint("zmq", "zmq: Publish rawtx %s\n", transaction.hash.GetHex());
+    assert(transaction.pvchRaw);
+    return SendMessage(MSG_RAWTX, transaction.pvchRaw);
 }
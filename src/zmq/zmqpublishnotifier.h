@@ -23,6 +23,11 @@ public:
           * message sequence number
     */
     bool SendMessage(const char *command, const void* data, size_t size);
+    /* same, but hands the data to zmq without copying it */
+    bool SendMessage(const char *command, const std::shared_ptr<const std::vector<unsigned char> > &pdata);
+
+    /* skip sequence numbers of dropped messages, so subscribers can tell they missed some */
+    void SkipMessages(unsigned int nCount) { nSequence += nCount; }
 
     bool Initialize(void *pcontext);
     void Shutdown();
@@ -31,25 +36,30 @@ public:
 class CZMQPublishHashBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex);
+    bool NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock> &pblock);
+    void BlocksDropped(unsigned int nCount) { SkipMessages(nCount); }
 };
 
 class CZMQPublishHashTransactionNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyTransaction(const CTransaction &transaction);
+    bool NotifyTransaction(const CZMQTransactionNotification &transaction);
+    void TransactionsDropped(unsigned int nCount) { SkipMessages(nCount); }
 };
 
 class CZMQPublishRawBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex);
+    bool NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock> &pblock);
+    void BlocksDropped(unsigned int nCount) { SkipMessages(nCount); }
 };
 
 class CZMQPublishRawTransactionNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyTransaction(const CTransaction &transaction);
+    bool NeedsRawTransaction() const { return true; }
+    bool NotifyTransaction(const CZMQTransactionNotification &transaction);
+    void TransactionsDropped(unsigned int nCount) { SkipMessages(nCount); }
 };
 
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H